@@ -0,0 +1,114 @@
+#include "Beeper.h"
+#include "VirtualMachine.h"
+
+namespace
+{
+	const float g_Frequency{ 440.f };
+	const float g_Volume{ 0.25f };
+	//on/off ramps take 1 ms
+	const uint32_t g_RampsPerSecond{ 1000 };
+
+	//polynomial band limited step correction around a discontinuity of a naive square wave
+	float PolyBlep(float phase, const float phaseStep)
+	{
+		if (phase < phaseStep)
+		{
+			phase /= phaseStep;
+			return phase + phase - phase * phase - 1.f;
+		}
+		if (phase > 1.f - phaseStep)
+		{
+			phase = (phase - 1.f) / phaseStep;
+			return phase * phase + phase + phase + 1.f;
+		}
+		return 0.f;
+	}
+}
+
+Beeper::Beeper(const uint32_t sampleRate, const uint32_t leadSamples)
+	:m_SampleRate{ sampleRate }
+	, m_LeadSamples{ leadSamples }
+	, m_PhaseStep{ g_Frequency / float(sampleRate) }
+	, m_GainStep{ g_Volume * float(g_RampsPerSecond) / float(sampleRate) }
+	, m_Ring{}
+	, m_EmulatedSamples{}
+	, m_SampleRemainder{}
+	, m_IsSentOn{}
+	, m_PlayedSamples{}
+	, m_TimeOffset{}
+	, m_IsSynced{}
+	, m_NextEvent{}
+	, m_NextEventTime{}
+	, m_HasNextEvent{}
+	, m_IsOn{}
+	, m_Phase{}
+	, m_Gain{}
+{
+}
+
+void Beeper::PublishFrame(const VirtualMachine& vm)
+{
+	const bool isOn = vm.m_Cpu.st > 0;
+	if (isOn != m_IsSentOn && m_Ring.Push(SoundEvent{ m_EmulatedSamples, isOn }))
+		m_IsSentOn = isOn;
+
+	//exact frame length in samples on average, 800 per frame at 48 kHz
+	m_SampleRemainder += m_SampleRate;
+	m_EmulatedSamples += m_SampleRemainder / m_FramesPerSecond;
+	m_SampleRemainder %= m_FramesPerSecond;
+}
+
+bool Beeper::FetchNextEvent(const uint64_t blockStart)
+{
+	if (!m_Ring.Pop(m_NextEvent))
+		return false;
+	//emulation and audio clocks drift apart (sleep based pacing, stalls, headless runs). A beep that would start too
+	//late or too far ahead is moved to leadSamples from now, its stop keeps the offset so the length stays exact
+	const int64_t time = int64_t(m_NextEvent.sampleTime) + m_TimeOffset;
+	const int64_t earliest = int64_t(blockStart);
+	const int64_t latest = int64_t(blockStart) + 2 * int64_t(m_LeadSamples);
+	if (!m_IsSynced || (m_NextEvent.isOn && (time < earliest || time > latest)))
+	{
+		m_TimeOffset = int64_t(blockStart) + int64_t(m_LeadSamples) - int64_t(m_NextEvent.sampleTime);
+		m_IsSynced = true;
+	}
+	m_NextEventTime = uint64_t(int64_t(m_NextEvent.sampleTime) + m_TimeOffset);
+	return true;
+}
+
+void Beeper::Render(float* pSamples, const uint32_t count)
+{
+	const uint64_t blockStart = m_PlayedSamples;
+	for (uint32_t sampleIdx = 0; sampleIdx < count; ++sampleIdx)
+	{
+		const uint64_t now = blockStart + sampleIdx;
+		if (!m_HasNextEvent)
+			m_HasNextEvent = FetchNextEvent(blockStart);
+		while (m_HasNextEvent && m_NextEventTime <= now)
+		{
+			m_IsOn = m_NextEvent.isOn;
+			m_HasNextEvent = FetchNextEvent(blockStart);
+		}
+
+		if (m_IsOn)
+			m_Gain = m_Gain + m_GainStep < g_Volume ? m_Gain + m_GainStep : g_Volume;
+		else
+			m_Gain = m_Gain - m_GainStep > 0.f ? m_Gain - m_GainStep : 0.f;
+
+		float sample = 0.f;
+		if (m_Gain > 0.f)
+		{
+			float halfPhase = m_Phase + 0.5f;
+			if (halfPhase >= 1.f)
+				halfPhase -= 1.f;
+			sample = m_Phase < 0.5f ? 1.f : -1.f;
+			sample += PolyBlep(m_Phase, m_PhaseStep) - PolyBlep(halfPhase, m_PhaseStep);
+			sample *= m_Gain;
+		}
+		m_Phase += m_PhaseStep;
+		if (m_Phase >= 1.f)
+			m_Phase -= 1.f;
+		pSamples[sampleIdx] = sample;
+	}
+	m_PlayedSamples = blockStart + count;
+}
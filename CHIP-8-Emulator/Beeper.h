@@ -0,0 +1,56 @@
+#pragma once
+#include "FrameSink.h"
+#include "SoundEventRing.h"
+#include <cstdint>
+//Sound timer beeper, split between two threads that only talk through a SoundEventRing.
+//Emulation thread (PublishFrame): every presented frame advances emulated time by sampleRate / 60 samples, the
+//frames where the sound timer starts or stops running become on/off events stamped with that sample time.
+//Audio thread (Render): maps event times onto the output clock leadSamples ahead, so edges land on exact samples,
+//and plays a band limited (PolyBLEP) square wave with a short gain ramp instead of hard clicks.
+//No SDL in here, any audio backend (or a test) can drive Render.
+class Beeper final : public FrameSink
+{
+public:
+	Beeper(const uint32_t sampleRate, const uint32_t leadSamples);
+	Beeper(const Beeper& old) = delete;
+	Beeper(Beeper&& old) = delete;
+	Beeper& operator=(const Beeper& other) = delete;
+	Beeper& operator=(const Beeper&& other) = delete;
+
+	void PublishFrame(const VirtualMachine& vm) override;
+	//fills pSamples with mono float samples, called from the audio thread
+	void Render(float* pSamples, const uint32_t count);
+
+	uint32_t GetSampleRate() const { return m_SampleRate; }
+	uint32_t GetLeadSamples() const { return m_LeadSamples; }
+
+	//the sound timer ticks at 60 Hz, one tick per presented frame
+	const static uint32_t m_FramesPerSecond{ 60 };
+private:
+	const uint32_t m_SampleRate;
+	const uint32_t m_LeadSamples;
+	const float m_PhaseStep;
+	const float m_GainStep;
+
+	SoundEventRing m_Ring;
+
+	//emulation thread
+	uint64_t m_EmulatedSamples;
+	uint32_t m_SampleRemainder;
+	//state last pushed, a push that failed on a full ring is retried next frame
+	bool m_IsSentOn;
+
+	//audio thread
+	uint64_t m_PlayedSamples;
+	//output time = emulated time + offset, re-picked when a beep would start too late or too far ahead
+	int64_t m_TimeOffset;
+	bool m_IsSynced;
+	SoundEvent m_NextEvent;
+	uint64_t m_NextEventTime;
+	bool m_HasNextEvent;
+	bool m_IsOn;
+	float m_Phase;
+	float m_Gain;
+
+	bool FetchNextEvent(const uint64_t blockStart);
+};
@@ -1,30 +1,827 @@
 // CHIP-8-Emulator.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
 #include "VirtualMachine.h"
+#include "SDLFrontend.h"
+#include "SDLAudio.h"
+#include "Beeper.h"
+#include "TerminalFrontend.h"
+#include "VideoExporter.h"
+#include "FrameHashLog.h"
+#include "InputMovie.h"
+#include "Conformance.h"
+#include "StateExplorer.h"
+#include "SharedFrameExport.h"
+#include "RunAhead.h"
+#include "FramePacer.h"
+#include "RomArchive.h"
+#include "RomDatabase.h"
+#include "Disassembler.h"
+#include "Debugger.h"
+#include "PerfCounters.h"
+#include "VmPool.h"
+#include "VmScheduler.h"
+#include "FrameTelemetry.h"
+#include "InputEventQueue.h"
+#ifdef CHIP8_EMBEDDED_ROMS
+//generated with --pack EmbeddedRoms.h
+#include "EmbeddedRoms.h"
+#endif
+#include <algorithm>
 #include <iostream>
 #include <SDL.h>
+#include <csignal>
+#include <cstdlib>
 #include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	//terminal and headless mode have no window to close, ctrl+c ends the loop so everything gets flushed
+	volatile std::sig_atomic_t g_Interrupted = 0;
+	void OnInterrupt(int) { g_Interrupted = 1; }
+
+	enum class FrontendType { SDL, Terminal, Headless };
+
+	struct LaunchOptions
+	{
+		FrontendType frontend{ FrontendType::SDL };
+		//playlist, Tab or --cycle switch to the next one. Names are looked up in the ROM archive first, then on disk.
+		//Empty --> every ROM of the archive, ../Roms/brix.rom without one. Directories to pack in --pack mode
+		std::vector<std::string> romPaths{};
+		std::string archivePath{};
+		//not empty --> only pack the ROM directories into this archive
+		std::string packPath{};
+		//not empty --> only write the control flow graphs of the playlist (directories expanded) as JSON, "-" for stdout
+		std::string disassemblyPath{};
+		//0 --> stay on a ROM until asked to switch
+		uint64_t cycleFrames{ 0 };
+		//0 --> run until quit
+		uint64_t maxFrames{ 0 };
+		std::string videoPath{};
+		uint32_t videoInterval{ 1 };
+		std::string hashLogPath{};
+		FrameHashLog::Mode hashLogMode{ FrameHashLog::Mode::Record };
+		std::string moviePath{};
+		//not empty --> only replay every ROM of the playlist (default ../Roms) with <dir>/<rom>.movie and check or record <dir>/<rom>.hashes
+		std::string goldenPath{};
+		FrameHashLog::Mode goldenMode{ FrameHashLog::Mode::Verify };
+		//0 --> normal run, otherwise only run the opcode self check with this many random steps
+		uint64_t conformanceSteps{ 0 };
+		//--quirks and --ipf win over the ROM database
+		InstructionLib::QuirkProfile quirkProfile{ InstructionLib::QuirkProfile::Modern };
+		bool isQuirkProfileForced{ false };
+		//0 --> from the ROM database, 1 for unknown ROMs
+		uint16_t instructionsPerFrame{ 0 };
+		//empty --> roms.c8db from the archive, then ../Roms/roms.c8db
+		std::string romDatabasePath{};
+		//0 --> normal run, otherwise only search the input space of the ROM this many frames deep
+		uint32_t exploreDepth{ 0 };
+		//name of the shared memory segment frames are exported to, empty --> no export
+		std::string sharedFrameName{};
+		//frames presented ahead of the real machine, 0 --> off
+		uint32_t runAheadFrames{ 0 };
+		//sound timer beeper, on by default for the SDL window only
+		bool isAudioRequested{ false };
+		bool isMuted{ false };
+		//presented frames per second, timers tick once per frame
+		double framesPerSecond{ 60.0 };
+		//command line debugger on stdin/stderr, stops before the first instruction
+		bool isDebuggerRequested{ false };
+		//host performance counters around the emulation of every frame, optionally logged per frame
+		bool isPerfRequested{ false };
+		std::string perfCsvPath{};
+		//Prometheus text file the stage latencies are written to every telemetryInterval seconds, empty --> off
+		std::string telemetryPath{};
+		double telemetryInterval{ 10.0 };
+		//0 --> normal run, otherwise only step this many copies of the ROM round robin on this thread
+		uint32_t benchInstances{ 0 };
+		//run them through the coroutine scheduler instead, vms waiting for a key are not stepped
+		bool isBenchScheduled{ false };
+	};
+
+	LaunchOptions ParseArguments(int argc, char* argv[])
+	{
+		LaunchOptions options{};
+		for (int i = 1; i < argc; ++i)
+		{
+			const bool hasValue = i + 1 < argc;
+			if (std::strcmp(argv[i], "--terminal") == 0)
+				options.frontend = FrontendType::Terminal;
+			else if (std::strcmp(argv[i], "--headless") == 0)
+				options.frontend = FrontendType::Headless;
+			else if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+				options.maxFrames = std::strtoull(argv[++i], nullptr, 10);
+			else if (std::strcmp(argv[i], "--video") == 0 && hasValue)
+				options.videoPath = argv[++i];
+			else if (std::strcmp(argv[i], "--video-every") == 0 && hasValue)
+				options.videoInterval = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+			else if (std::strcmp(argv[i], "--hash-record") == 0 && hasValue)
+			{
+				options.hashLogPath = argv[++i];
+				options.hashLogMode = FrameHashLog::Mode::Record;
+			}
+			else if (std::strcmp(argv[i], "--hash-verify") == 0 && hasValue)
+			{
+				options.hashLogPath = argv[++i];
+				options.hashLogMode = FrameHashLog::Mode::Verify;
+			}
+			else if (std::strcmp(argv[i], "--movie") == 0 && hasValue)
+				options.moviePath = argv[++i];
+			else if (std::strcmp(argv[i], "--golden") == 0 && hasValue)
+			{
+				options.goldenPath = argv[++i];
+				options.goldenMode = FrameHashLog::Mode::Verify;
+			}
+			else if (std::strcmp(argv[i], "--golden-record") == 0 && hasValue)
+			{
+				options.goldenPath = argv[++i];
+				options.goldenMode = FrameHashLog::Mode::Record;
+			}
+			else if (std::strcmp(argv[i], "--quirks") == 0 && hasValue)
+			{
+				if (!InstructionLib::ParseQuirkProfile(argv[++i], options.quirkProfile))
+					options.quirkProfile = InstructionLib::QuirkProfile::Modern;
+				options.isQuirkProfileForced = true;
+			}
+			else if (std::strcmp(argv[i], "--conformance") == 0)
+				options.conformanceSteps = hasValue ? std::strtoull(argv[++i], nullptr, 10) : 1000000;
+			else if (std::strcmp(argv[i], "--shm") == 0 && hasValue)
+				options.sharedFrameName = argv[++i];
+			else if (std::strcmp(argv[i], "--run-ahead") == 0 && hasValue)
+				options.runAheadFrames = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+			else if (std::strcmp(argv[i], "--audio") == 0)
+				options.isAudioRequested = true;
+			else if (std::strcmp(argv[i], "--mute") == 0)
+				options.isMuted = true;
+			else if (std::strcmp(argv[i], "--fps") == 0 && hasValue)
+			{
+				options.framesPerSecond = std::strtod(argv[++i], nullptr);
+				if (options.framesPerSecond <= 0.0)
+					options.framesPerSecond = 60.0;
+			}
+			else if (std::strcmp(argv[i], "--explore") == 0)
+				options.exploreDepth = hasValue ? uint32_t(std::strtoul(argv[++i], nullptr, 10)) : 8;
+			else if (std::strcmp(argv[i], "--ipf") == 0 && hasValue)
+				options.instructionsPerFrame = uint16_t(std::strtoul(argv[++i], nullptr, 10));
+			else if (std::strcmp(argv[i], "--romdb") == 0 && hasValue)
+				options.romDatabasePath = argv[++i];
+			else if (std::strcmp(argv[i], "--archive") == 0 && hasValue)
+				options.archivePath = argv[++i];
+			else if (std::strcmp(argv[i], "--pack") == 0 && hasValue)
+				options.packPath = argv[++i];
+			else if (std::strcmp(argv[i], "--telemetry") == 0 && hasValue)
+				options.telemetryPath = argv[++i];
+			else if (std::strcmp(argv[i], "--telemetry-every") == 0 && hasValue)
+				options.telemetryInterval = std::strtod(argv[++i], nullptr);
+			else if (std::strcmp(argv[i], "--perf") == 0)
+				options.isPerfRequested = true;
+			else if (std::strcmp(argv[i], "--perf-csv") == 0 && hasValue)
+			{
+				options.isPerfRequested = true;
+				options.perfCsvPath = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--debug") == 0)
+				options.isDebuggerRequested = true;
+			else if (std::strcmp(argv[i], "--bench-instances") == 0)
+				options.benchInstances = hasValue ? uint32_t(std::strtoul(argv[++i], nullptr, 10)) : 10000;
+			else if (std::strcmp(argv[i], "--bench-scheduled") == 0)
+				options.isBenchScheduled = true;
+			else if (std::strcmp(argv[i], "--disasm") == 0 && hasValue)
+				options.disassemblyPath = argv[++i];
+			else if (std::strcmp(argv[i], "--cycle") == 0 && hasValue)
+				options.cycleFrames = std::strtoull(argv[++i], nullptr, 10);
+			else
+				options.romPaths.push_back(argv[i]);
+		}
+		return options;
+	}
+
+	//where ROMs and their settings come from, either may be nullptr
+	struct RomLibrary
+	{
+		RomArchive* pArchive;
+		RomDatabase* pDatabase;
+	};
+
+	const std::string g_RomDatabaseName{ "roms.c8db" };
+
+	//--archive, or the archive compiled in with CHIP8_EMBEDDED_ROMS. The database comes from --romdb, the archive or
+	//next to the bundled ROMs, in that order
+	RomLibrary OpenRomLibrary(const LaunchOptions& options)
+	{
+		RomLibrary library{ new RomArchive(), new RomDatabase() };
+		if (!options.archivePath.empty())
+			library.pArchive->Open(options.archivePath);
+#ifdef CHIP8_EMBEDDED_ROMS
+		else
+			library.pArchive->OpenMemory(g_EmbeddedRomArchive, g_EmbeddedRomArchiveSize);
+#endif
+		if (!library.pArchive->IsOpen())
+		{
+			delete library.pArchive;
+			library.pArchive = nullptr;
+		}
+
+		RomEntry databaseEntry{};
+		bool isDatabaseLoaded = false;
+		if (!options.romDatabasePath.empty())
+		{
+			isDatabaseLoaded = library.pDatabase->Load(options.romDatabasePath);
+			if (!isDatabaseLoaded)
+				std::cerr << "Cant open ROM database " << options.romDatabasePath << std::endl;
+		}
+		else if (library.pArchive && library.pArchive->FindByName(g_RomDatabaseName, databaseEntry))
+			isDatabaseLoaded = library.pDatabase->Load(reinterpret_cast<const char*>(databaseEntry.pData), databaseEntry.size);
+		else
+			isDatabaseLoaded = library.pDatabase->Load("../Roms/" + g_RomDatabaseName);
+		if (!isDatabaseLoaded)
+		{
+			delete library.pDatabase;
+			library.pDatabase = nullptr;
+		}
+		return library;
+	}
+
+	void CloseRomLibrary(RomLibrary& library)
+	{
+		delete library.pDatabase;
+		library.pDatabase = nullptr;
+		delete library.pArchive;
+		library.pArchive = nullptr;
+	}
+
+	std::vector<std::string> BuildPlaylist(const LaunchOptions& options, const RomLibrary& library)
+	{
+		if (!options.romPaths.empty())
+			return options.romPaths;
+		std::vector<std::string> playlist;
+		for (uint32_t entryIdx = 0; library.pArchive && entryIdx < library.pArchive->GetEntryCount(); ++entryIdx)
+		{
+			const std::string_view name = library.pArchive->GetEntry(entryIdx).name;
+			if (name != g_RomDatabaseName)
+				playlist.emplace_back(name);
+		}
+		if (playlist.empty())
+			playlist.push_back("../Roms/brix.rom");
+		return playlist;
+	}
+
+	//loads from the archive or disk, then applies what the ROM database knows about the ROM. The image is read and
+	//checked before the vm is touched, a ROM that cant be loaded leaves the running one (and its profile) alone
+	bool LoadRom(VirtualMachine& vm, const LaunchOptions& options, const RomLibrary& library, const std::string& name)
+	{
+		RomEntry entry{};
+		std::vector<uint8_t> fileData;
+		if (!(library.pArchive && library.pArchive->FindByName(name, entry)))
+		{
+			std::ifstream file(name, std::ios::binary | std::ios::in);
+			if (!file.is_open())
+			{
+				std::cerr << "Cant open ROM " << name << std::endl;
+				return false;
+			}
+			fileData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			entry.pData = fileData.data();
+			entry.size = uint32_t(fileData.size());
+		}
+		if (entry.size == 0)
+		{
+			std::cerr << "ROM " << name << " is empty" << std::endl;
+			return false;
+		}
+
+		const RomDatabase::Settings* pSettings = library.pDatabase ? library.pDatabase->Find(RomArchive::HashContent(entry.pData, entry.size)) : nullptr;
+		//profile first, it decides how much memory the ROM can fill
+		vm.SetQuirkProfile(pSettings && !options.isQuirkProfileForced ? pSettings->quirkProfile : options.quirkProfile);
+		if (!vm.LoadROM(entry.pData, entry.size))
+			return false;
+		vm.SetInstructionsPerFrame(options.instructionsPerFrame != 0 ? options.instructionsPerFrame : pSettings ? pSettings->instructionsPerFrame : 1);
+		if (!pSettings)
+			return true;
+		vm.SetIdleLoops(pSettings->idleLoops, pSettings->idleLoopCount);
+		std::memcpy(vm.m_KeyMap, pSettings->keyMap, sizeof(vm.m_KeyMap));
+		return true;
+	}
+
+	int RunExplorer(const LaunchOptions& options, const RomLibrary& library)
+	{
+		//hashes take 16 bytes a state at most, deltas are usually far smaller than a full state
+		const uint64_t maxStates = 1ull << 22;
+		VirtualMachine* pVM = new VirtualMachine();
+		if (!LoadRom(*pVM, options, library, BuildPlaylist(options, library).front()))
+		{
+			delete pVM;
+			return 1;
+		}
+		const uint32_t threadCount = std::thread::hardware_concurrency();
+		StateExplorer* pExplorer = new StateExplorer(*pVM, threadCount, maxStates);
+		const StateExplorer::Result result = pExplorer->Run(options.exploreDepth);
+		std::cout << result.uniqueStates << " unique states from " << result.steppedStates << " steps, depth " << result.reachedDepth
+			<< " in " << result.seconds << " s (" << uint64_t(result.steppedStates / (result.seconds > 0 ? result.seconds : 1)) << " states/sec, "
+			<< threadCount << " threads)" << (result.isStateLimitHit ? ", stopped at the state limit" : "") << std::endl;
+		delete pExplorer;
+		pExplorer = nullptr;
+		delete pVM;
+		pVM = nullptr;
+		return 0;
+	}
+
+	//dense hosting: every instance runs one frame in turn, so each frame starts with the instance's state out of L1 (and with
+	//enough instances out of L2). Reports time per instance frame and, where the host has them, cache misses per instruction
+	int RunInstanceBenchmark(const LaunchOptions& options, const RomLibrary& library)
+	{
+		VirtualMachine* pTemplateVM = new VirtualMachine();
+		if (!LoadRom(*pTemplateVM, options, library, BuildPlaylist(options, library).front()))
+		{
+			delete pTemplateVM;
+			return 1;
+		}
+		//create, destroy and create again: the first round maps and faults in the arenas, the timed second one only reuses slots
+		VmPool* pPool = new VmPool(options.benchInstances);
+		std::vector<VirtualMachine*> vms(options.benchInstances);
+		std::chrono::steady_clock::duration createTime{};
+		std::chrono::steady_clock::duration destroyTime{};
+		for (uint32_t round = 0; round < 2; ++round)
+		{
+			const auto createStart = std::chrono::steady_clock::now();
+			for (VirtualMachine*& pVM : vms)
+				pVM = pPool->Create();
+			const auto createEnd = std::chrono::steady_clock::now();
+			createTime = createEnd - createStart;
+			if (round == 1)
+				break;
+			for (VirtualMachine* pVM : vms)
+				pPool->Destroy(pVM);
+			destroyTime = std::chrono::steady_clock::now() - createEnd;
+		}
+		for (uint32_t vmIdx = 0; vmIdx < options.benchInstances; ++vmIdx)
+		{
+			if (!vms[vmIdx])
+			{
+				std::cerr << "Cant create " << options.benchInstances << " vms" << std::endl;
+				delete pPool;
+				delete pTemplateVM;
+				return 1;
+			}
+			vms[vmIdx]->ForkFrom(*pTemplateVM);
+			//own CXKK sequence per instance, otherwise all of them take the same branches
+			vms[vmIdx]->m_Cpu.randomState = (vmIdx * 0x9E3779B9u) | 1;
+		}
+		std::cout << "Created " << vms.size() << " vms in " << std::chrono::duration<double, std::milli>(createTime).count() << " ms, destroyed in "
+			<< std::chrono::duration<double, std::milli>(destroyTime).count() << " ms (" << (pPool->IsHugePageBacked() ? "huge pages" : "normal pages")
+			<< ", NUMA node " << pPool->GetNumaNode() << ")" << std::endl;
+		const uint64_t frames = options.maxFrames != 0 ? options.maxFrames : 60;
+		uint64_t startInstructions = 0;
+		for (const VirtualMachine* pVM : vms)
+			startInstructions += pVM->GetExecutedInstructions();
+
+#if defined(__cpp_impl_coroutine)
+		VmScheduler* pScheduler = nullptr;
+		if (options.isBenchScheduled)
+		{
+			pScheduler = new VmScheduler();
+			for (VirtualMachine* pVM : vms)
+				pScheduler->Add(*pVM);
+		}
+#else
+		if (options.isBenchScheduled)
+			std::cerr << "--bench-scheduled needs a C++20 build, stepping every vm" << std::endl;
+#endif
+
+		PerfCounters* pPerfCounters = new PerfCounters(options.perfCsvPath);
+		uint64_t steppedInstanceFrames = 0;
+		const auto start = std::chrono::steady_clock::now();
+		pPerfCounters->BeginFrame();
+		for (uint64_t frame = 0; frame < frames; ++frame)
+		{
+#if defined(__cpp_impl_coroutine)
+			if (pScheduler)
+			{
+				steppedInstanceFrames += pScheduler->RunFrame();
+				continue;
+			}
+#endif
+			for (VirtualMachine* pVM : vms)
+				pVM->Step();
+			steppedInstanceFrames += vms.size();
+		}
+#if defined(__cpp_impl_coroutine)
+		//applies the frames sleeping vms skipped, inside the timing: it is part of what the scheduler costs
+		delete pScheduler;
+		pScheduler = nullptr;
+#endif
+		const auto end = std::chrono::steady_clock::now();
+		uint64_t executedInstructions = 0;
+		for (const VirtualMachine* pVM : vms)
+			executedInstructions += pVM->GetExecutedInstructions();
+		executedInstructions -= startInstructions;
+		pPerfCounters->EndFrame(executedInstructions);
+
+		const double instanceFrames = double(frames) * double(vms.size());
+		const double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+		std::cout << vms.size() << " instances x " << frames << " frames: " << nanoseconds / (instanceFrames > 0 ? instanceFrames : 1) << " ns per instance frame, "
+			<< double(executedInstructions) / (nanoseconds > 0 ? nanoseconds : 1) * 1000.0 << " M instructions/sec; "
+			<< sizeof(VirtualMachine) << " bytes per vm (" << sizeof(CpuState) << " register bytes, " << PagedMemory::m_PageSize << " byte pages shared until written), "
+			<< 100.0 * double(steppedInstanceFrames) / (instanceFrames > 0 ? instanceFrames : 1) << " % of the instance frames stepped" << std::endl;
+		pPerfCounters->PrintReport(std::cout);
+
+		delete pPerfCounters;
+		pPerfCounters = nullptr;
+		delete pPool;
+		pPool = nullptr;
+		delete pTemplateVM;
+		pTemplateVM = nullptr;
+		return 0;
+	}
+
+	bool ReadRomImage(const RomLibrary& library, const std::string& name, std::vector<uint8_t>& data)
+	{
+		RomEntry entry{};
+		if (library.pArchive && library.pArchive->FindByName(name, entry))
+		{
+			data.assign(entry.pData, entry.pData + entry.size);
+			return true;
+		}
+		std::ifstream file(name, std::ios::binary);
+		if (!file)
+			return false;
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	//ROM files of the directories in paths (not recursive, the ROM database left out), other paths as they are. Sorted
+	std::vector<std::string> ExpandDirectories(const std::vector<std::string>& paths)
+	{
+		std::vector<std::string> names;
+		for (const std::string& path : paths)
+		{
+			std::error_code error;
+			if (!std::filesystem::is_directory(path, error))
+			{
+				names.push_back(path);
+				continue;
+			}
+			for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(path, error))
+			{
+				if (file.is_regular_file() && file.path().filename() != g_RomDatabaseName)
+					names.push_back(file.path().string());
+			}
+		}
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+
+	int RunDisassembler(const LaunchOptions& options, const RomLibrary& library)
+	{
+		const std::vector<std::string> names = ExpandDirectories(BuildPlaylist(options, library));
+
+		//profile per ROM like LoadRom: --quirks, then the ROM database
+		std::vector<Disassembler::RomImage> roms;
+		for (const std::string& name : names)
+		{
+			Disassembler::RomImage rom{ name, {}, options.quirkProfile };
+			if (!ReadRomImage(library, name, rom.data))
+			{
+				std::cerr << "Cant open ROM " << name << std::endl;
+				continue;
+			}
+			const RomDatabase::Settings* pSettings = library.pDatabase ? library.pDatabase->Find(RomArchive::HashContent(rom.data.data(), rom.data.size())) : nullptr;
+			if (pSettings && !options.isQuirkProfileForced)
+				rom.profile = pSettings->quirkProfile;
+			roms.push_back(std::move(rom));
+		}
+
+		const uint32_t threadCount = std::thread::hardware_concurrency();
+		const auto start = std::chrono::steady_clock::now();
+		const std::vector<Disassembler::ControlFlowGraph> graphs = Disassembler::AnalyzeAll(roms, threadCount != 0 ? threadCount : 1);
+		const auto end = std::chrono::steady_clock::now();
+
+		std::ofstream file;
+		if (options.disassemblyPath != "-")
+		{
+			file.open(options.disassemblyPath);
+			if (!file)
+			{
+				std::cerr << "Cant open " << options.disassemblyPath << std::endl;
+				return 1;
+			}
+		}
+		std::ostream& stream = file.is_open() ? static_cast<std::ostream&>(file) : std::cout;
+		stream << '[';
+		uint64_t instructionCount = 0;
+		for (size_t graphIdx = 0; graphIdx < graphs.size(); ++graphIdx)
+		{
+			stream << (graphIdx ? ",\n" : "\n");
+			Disassembler::WriteJson(stream, graphs[graphIdx]);
+			instructionCount += graphs[graphIdx].instructions.size();
+		}
+		stream << "\n]\n";
+		std::cerr << "Analyzed " << graphs.size() << " ROMs (" << instructionCount << " instructions) in "
+			<< std::chrono::duration<double, std::milli>(end - start).count() << " ms on " << threadCount << " threads" << std::endl;
+		return stream ? 0 : 1;
+	}
+
+	//regression run over the bundled ROMs: each replays its golden movie headless with the database settings, every frame's
+	//hash is compared against (or recorded into) its golden hash log. Returns 1 when any ROM differs or misses its files
+	int RunGoldenRuns(const LaunchOptions& options, const RomLibrary& library)
+	{
+		const std::vector<std::string> names = ExpandDirectories(options.romPaths.empty() ? std::vector<std::string>{ "../Roms" } : options.romPaths);
+		const uint64_t frames = options.maxFrames != 0 ? options.maxFrames : 1200;
+		const bool isRecording = options.goldenMode == FrameHashLog::Mode::Record;
+		uint32_t failedCount = 0;
+		for (const std::string& name : names)
+		{
+			const std::string stem = std::filesystem::path(name).stem().string();
+			const std::string goldenBase = (std::filesystem::path(options.goldenPath) / stem).string();
+			VirtualMachine* pVM = new VirtualMachine();
+			InputEventQueue* pInputQueue = new InputEventQueue();
+			InputMovie* pMovie = new InputMovie();
+			FrameHashLog* pHashLog = new FrameHashLog(goldenBase + ".hashes", options.goldenMode);
+			bool isPassed = pMovie->Load(goldenBase + ".movie") && LoadRom(*pVM, options, library, name);
+			if (isPassed)
+			{
+				pVM->SetInputQueue(pInputQueue);
+				pVM->AddFrameSink(pHashLog);
+				for (uint64_t frame = 0; frame < frames; ++frame)
+				{
+					pMovie->Apply(frame, *pVM, pInputQueue);
+					pVM->Update();
+				}
+				isPassed = pHashLog->Finish();
+			}
+			std::cout << (isPassed ? (isRecording ? "recorded " : "ok       ") : "FAILED   ") << name << std::endl;
+			failedCount += isPassed ? 0 : 1;
+			delete pHashLog;
+			pHashLog = nullptr;
+			delete pMovie;
+			pMovie = nullptr;
+			delete pVM;
+			pVM = nullptr;
+			delete pInputQueue;
+			pInputQueue = nullptr;
+		}
+		std::cout << names.size() - failedCount << " of " << names.size() << " ROMs " << (isRecording ? "recorded" : "match their golden hashes")
+			<< " over " << frames << " frames" << std::endl;
+		return failedCount == 0 && !names.empty() ? 0 : 1;
+	}
+
+	//only the vm is reinitialized, windows, textures, audio devices and other sinks keep running
+	void SwapROM(VirtualMachine& vm, const LaunchOptions& options, const RomLibrary& library, const std::string& path)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		if (!LoadRom(vm, options, library, path))
+			return;
+		const auto end = std::chrono::steady_clock::now();
+		std::cerr << "Loaded " << path << " in " << std::chrono::duration<double, std::micro>(end - start).count() << " us ("
+			<< vm.GetInstructionsPerFrame() << " instructions per frame)" << std::endl;
+	}
+
+	VideoExporter::Format GetVideoFormat(const std::string& path)
+	{
+		const std::string pgmExtension{ ".pgm" };
+		const bool isPGM = path.size() >= pgmExtension.size() && path.compare(path.size() - pgmExtension.size(), pgmExtension.size(), pgmExtension) == 0;
+		return isPGM ? VideoExporter::Format::PGM : VideoExporter::Format::Y4M;
+	}
+}
+
 int main(int argc, char* argv[])
 {
-	VirtualMachine* pVM = new VirtualMachine(12,12);
-	pVM->ClearScreen();
-	bool quit = false;
-	int ticks = 6;
-	pVM->LoadROM("../Roms/brix.rom");
+	const LaunchOptions options = ParseArguments(argc, argv);
+	if (options.conformanceSteps != 0)
+	{
+		const bool casesPassed = Conformance::RunOpcodeCases();
+		const bool differentialPassed = Conformance::RunDifferential(options.conformanceSteps, 0xC8C8);
+		return casesPassed && differentialPassed ? 0 : 1;
+	}
+	if (!options.packPath.empty())
+		return RomArchive::Pack(options.packPath, options.romPaths.empty() ? std::vector<std::string>{ "../Roms" } : options.romPaths) ? 0 : 1;
+	//one mapping for every ROM of a sweep instead of a file open per ROM
+	RomLibrary library = OpenRomLibrary(options);
+	if (!options.disassemblyPath.empty())
+	{
+		const int disassemblyResult = RunDisassembler(options, library);
+		CloseRomLibrary(library);
+		return disassemblyResult;
+	}
+	if (!options.goldenPath.empty())
+	{
+		const int goldenResult = RunGoldenRuns(options, library);
+		CloseRomLibrary(library);
+		return goldenResult;
+	}
+	if (options.exploreDepth != 0)
+	{
+		const int exploreResult = RunExplorer(options, library);
+		CloseRomLibrary(library);
+		return exploreResult;
+	}
+	if (options.benchInstances != 0)
+	{
+		const int benchResult = RunInstanceBenchmark(options, library);
+		CloseRomLibrary(library);
+		return benchResult;
+	}
+
+	VirtualMachine* pVM = new VirtualMachine();
+	SDLFrontend* pSDLFrontend = nullptr;
+	TerminalFrontend* pTerminalFrontend = nullptr;
+	VideoExporter* pVideoExporter = nullptr;
+	FrameHashLog* pHashLog = nullptr;
+	InputMovie* pMovie = nullptr;
+	SharedFrameExport* pSharedExport = nullptr;
+	RunAhead* pRunAhead = nullptr;
+	SDLAudio* pAudio = nullptr;
+	Debugger* pDebugger = nullptr;
+	PerfCounters* pPerfCounters = nullptr;
+	FrameTelemetry* pTelemetry = nullptr;
+	//key changes land on the instruction they happened at instead of the frame start
+	InputEventQueue* pInputQueue = new InputEventQueue();
+	pVM->SetInputQueue(pInputQueue);
+	//before any frontend or sink exists, a bad movie has nothing to tear down yet
+	if (!options.moviePath.empty())
+	{
+		pMovie = new InputMovie();
+		if (!pMovie->Load(options.moviePath))
+		{
+			delete pVM;
+			pVM = nullptr;
+			delete pInputQueue;
+			pInputQueue = nullptr;
+			delete pMovie;
+			pMovie = nullptr;
+			CloseRomLibrary(library);
+			return 1;
+		}
+	}
+	if (options.frontend == FrontendType::Terminal)
+	{
+		pTerminalFrontend = new TerminalFrontend();
+		pVM->AddFrameSink(pTerminalFrontend);
+	}
+	else if (options.frontend == FrontendType::SDL)
+	{
+		pSDLFrontend = new SDLFrontend(12, 12);
+		pSDLFrontend->ClearScreen();
+		pVM->AddFrameSink(pSDLFrontend);
+	}
+	if (!pSDLFrontend)
+		std::signal(SIGINT, OnInterrupt);
+
+	if (!options.videoPath.empty())
+	{
+		pVideoExporter = new VideoExporter(options.videoPath, GetVideoFormat(options.videoPath), options.videoInterval);
+		pVM->AddFrameSink(pVideoExporter);
+	}
+	if (!options.hashLogPath.empty())
+	{
+		pHashLog = new FrameHashLog(options.hashLogPath, options.hashLogMode);
+		pVM->AddFrameSink(pHashLog);
+	}
+	if (!options.sharedFrameName.empty())
+	{
+		pSharedExport = new SharedFrameExport(options.sharedFrameName);
+		pVM->AddFrameSink(pSharedExport);
+	}
+	if (!options.isMuted && (options.isAudioRequested || options.frontend == FrontendType::SDL))
+	{
+		pAudio = new SDLAudio();
+		if (pAudio->IsOpen())
+			pVM->AddFrameSink(pAudio->GetBeeper());
+	}
+	if (options.runAheadFrames != 0)
+		pRunAhead = new RunAhead(options.runAheadFrames);
+	if (!options.telemetryPath.empty())
+	{
+		pTelemetry = new FrameTelemetry(options.telemetryPath, options.telemetryInterval);
+		if (pSDLFrontend)
+			pSDLFrontend->SetTelemetry(pTelemetry);
+	}
+	if (options.isPerfRequested)
+		pPerfCounters = new PerfCounters(options.perfCsvPath);
+	if (options.isDebuggerRequested)
+	{
+		pDebugger = new Debugger(std::cin, std::cerr);
+		pDebugger->RequestBreak();
+		pVM->SetDebugger(pDebugger);
+	}
+	//a movie owns the keys, the keyboard keeps writing the key states directly like before the queue existed
+	if (pSDLFrontend && !pMovie)
+		pSDLFrontend->SetInputQueue(pInputQueue);
+
+	std::vector<std::string> playlist = BuildPlaylist(options, library);
+	size_t playlistIdx = 0;
+	//teardown below still runs, the frontends and sinks exist by now
+	const bool isLoaded = LoadRom(*pVM, options, library, playlist[playlistIdx]);
+	bool quit = !isLoaded;
+	uint64_t frameCount = 0;
+	//headless batch runs go as fast as possible
+	FramePacer* pPacer = options.frontend != FrontendType::Headless ? new FramePacer(options.framesPerSecond) : nullptr;
 	while (!quit)
 	{
-		float elapsedSec = 0.f;
-		auto t_start = std::chrono::high_resolution_clock::now();
-		quit = pVM->ProcessInput();
-		pVM->Update(elapsedSec);
-		auto t_end = std::chrono::high_resolution_clock::now();
-		elapsedSec = std::chrono::duration<float, std::milli>(t_end - t_start).count();
-		if(!quit)
-			SDL_Delay(float(100)/ticks);
+		//headless runs have no frame interval worth recording, they are not paced
+		if (pTelemetry && pPacer && frameCount != 0)
+			pTelemetry->Record(FrameTelemetry::Frame, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<float>(pPacer->GetLastFrameSeconds())));
+		if (pSDLFrontend)
+		{
+			const FrameTelemetry::Clock::time_point inputStart = FrameTelemetry::Clock::now();
+			quit = pSDLFrontend->ProcessInput(*pVM);
+			if (pTelemetry)
+				pTelemetry->Record(FrameTelemetry::InputPoll, inputStart, FrameTelemetry::Clock::now());
+		}
+		quit = quit || g_Interrupted;
+		std::string droppedPath;
+		if (pSDLFrontend && pSDLFrontend->TakeDroppedFile(droppedPath))
+		{
+			playlist.push_back(droppedPath);
+			playlistIdx = playlist.size() - 1;
+			SwapROM(*pVM, options, library, playlist[playlistIdx]);
+		}
+		else if ((pSDLFrontend && pSDLFrontend->TakeNextRomRequest()) || (options.cycleFrames != 0 && frameCount != 0 && frameCount % options.cycleFrames == 0))
+		{
+			playlistIdx = (playlistIdx + 1) % playlist.size();
+			SwapROM(*pVM, options, library, playlist[playlistIdx]);
+		}
+		if (pMovie)
+			pMovie->Apply(frameCount, *pVM, pInputQueue);
+		//after keyboard and movie, injected keys are queued behind their events and win
+		if (pSharedExport)
+			pSharedExport->ApplyInput(*pVM, pInputQueue);
+		//counters cover emulation only, presentation and the frame sinks would drown the dispatch costs
+		const uint64_t frameStartInstructions = pVM->GetExecutedInstructions();
+		if (pPerfCounters)
+			pPerfCounters->BeginFrame();
+		const FrameTelemetry::Clock::time_point emulateStart = FrameTelemetry::Clock::now();
+		if (pRunAhead)
+			pRunAhead->Step(*pVM);
+		else
+			pVM->Step();
+		const FrameTelemetry::Clock::time_point publishStart = FrameTelemetry::Clock::now();
+		if (pPerfCounters)
+			pPerfCounters->EndFrame(pVM->GetExecutedInstructions() - frameStartInstructions + (pRunAhead ? pRunAhead->GetLastFutureInstructions() : 0));
+		if (pRunAhead)
+			pRunAhead->Present(*pVM);
+		else
+			pVM->PresentFrame(*pVM);
+		if (pTelemetry)
+		{
+			pTelemetry->Record(FrameTelemetry::Emulate, emulateStart, publishStart);
+			pTelemetry->Record(FrameTelemetry::Publish, publishStart, FrameTelemetry::Clock::now());
+		}
+		++frameCount;
+		if (options.maxFrames != 0 && frameCount >= options.maxFrames)
+			quit = true;
+		quit = quit || (pDebugger && pDebugger->IsQuitRequested());
+		if (!quit && pPacer)
+			pPacer->WaitForNextFrame();
 	}
+	int exitCode = isLoaded ? 0 : 1;
+	//stderr, stdout may carry the video stream
+	if (pRunAhead)
+		pRunAhead->PrintReport(std::cerr);
+	if (pPacer)
+		pPacer->PrintReport(std::cerr);
+	if (pPerfCounters)
+		pPerfCounters->PrintReport(std::cerr);
+	if (pHashLog && !pHashLog->Finish())
+		exitCode = 1;
+
 	delete pVM;
 	pVM = nullptr;
-	return 0;
+	delete pInputQueue;
+	pInputQueue = nullptr;
+	delete pMovie;
+	pMovie = nullptr;
+	delete pHashLog;
+	pHashLog = nullptr;
+	delete pSharedExport;
+	pSharedExport = nullptr;
+	delete pRunAhead;
+	pRunAhead = nullptr;
+	delete pPacer;
+	pPacer = nullptr;
+	delete pDebugger;
+	pDebugger = nullptr;
+	delete pPerfCounters;
+	pPerfCounters = nullptr;
+	//last dump once everything has been recorded
+	delete pTelemetry;
+	pTelemetry = nullptr;
+	CloseRomLibrary(library);
+	//before the window, SDLFrontend shuts all of SDL down
+	delete pAudio;
+	pAudio = nullptr;
+	delete pVideoExporter;
+	pVideoExporter = nullptr;
+	delete pTerminalFrontend;
+	pTerminalFrontend = nullptr;
+	delete pSDLFrontend;
+	pSDLFrontend = nullptr;
+	return exitCode;
 }
 
 // Run program: Ctrl + F5 or Debug > Start Without Debugging menu
@@ -0,0 +1,672 @@
+#include "Conformance.h"
+#include "VirtualMachine.h"
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+	//Deliberately naive CHIP-8 interpreter written straight from the spec, the core has to agree with it
+	struct ReferenceState
+	{
+		uint8_t memory[VirtualMachine::m_MaxMemSize];
+		uint32_t memSize;
+		//color index per pixel (bit n = plane n), always hires sized, lores only uses the top left 64x32
+		uint8_t pixels[Framebuffer::m_HiresHeight][Framebuffer::m_HiresWidth];
+		bool isHighRes;
+		uint8_t planeMask;
+		uint8_t rplFlags[16];
+		uint8_t audioPattern[16];
+		uint8_t audioPitch;
+		uint16_t stack[16];
+		uint8_t v[16];
+		uint8_t input[16];
+		uint16_t i;
+		uint16_t pc;
+		uint8_t sp;
+		uint8_t dt;
+		uint8_t st;
+		uint32_t randomState;
+		//quirks as plain runtime flags, the core gets them as template parameter
+		bool shiftUsesVy;
+		bool loadStoreIncrementsI;
+		bool jumpUsesVx;
+		bool spritesWrap;
+		bool logicResetsVF;
+		bool xoChip;
+	};
+
+	template<typename Quirks>
+	void SetReferenceQuirks(ReferenceState& s)
+	{
+		s.shiftUsesVy = Quirks::shiftUsesVy;
+		s.loadStoreIncrementsI = Quirks::loadStoreIncrementsI;
+		s.jumpUsesVx = Quirks::jumpUsesVx;
+		s.spritesWrap = Quirks::spritesWrap;
+		s.logicResetsVF = Quirks::logicResetsVF;
+		s.xoChip = Quirks::xoChip;
+	}
+
+	void SetReferenceQuirks(ReferenceState& s, const InstructionLib::QuirkProfile profile)
+	{
+		switch (profile)
+		{
+		case InstructionLib::QuirkProfile::CosmacVIP: SetReferenceQuirks<InstructionLib::QuirksCosmacVIP>(s); break;
+		case InstructionLib::QuirkProfile::SuperChip: SetReferenceQuirks<InstructionLib::QuirksSuperChip>(s); break;
+		case InstructionLib::QuirkProfile::XoChip: SetReferenceQuirks<InstructionLib::QuirksXoChip>(s); break;
+		default: SetReferenceQuirks<InstructionLib::QuirksModern>(s); break;
+		}
+	}
+
+	uint8_t& ReferenceMemory(ReferenceState& s, const int address)
+	{
+		return s.memory[address % s.memSize];
+	}
+
+	//naive per pixel scroll of the selected planes, dx > 0 moves right, dy > 0 moves down
+	void ReferenceScroll(ReferenceState& s, const int dx, const int dy)
+	{
+		const int width = s.isHighRes ? Framebuffer::m_HiresWidth : Framebuffer::m_LoresWidth;
+		const int height = s.isHighRes ? Framebuffer::m_HiresHeight : Framebuffer::m_LoresHeight;
+		//every visible pixel is written, the lores rest stays 0 and is left alone
+		uint8_t scrolled[Framebuffer::m_HiresHeight][Framebuffer::m_HiresWidth];
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				const int fromX = x - dx;
+				const int fromY = y - dy;
+				const uint8_t moved = (fromX >= 0 && fromX < width && fromY >= 0 && fromY < height) ? s.pixels[fromY][fromX] : 0;
+				scrolled[y][x] = uint8_t((s.pixels[y][x] & ~s.planeMask) | (moved & s.planeMask));
+			}
+		}
+		for (int y = 0; y < height; ++y)
+			std::memcpy(s.pixels[y], scrolled[y], size_t(width));
+	}
+
+	uint8_t ReferenceRandom(ReferenceState& s)
+	{
+		s.randomState ^= s.randomState << 13;
+		s.randomState ^= s.randomState >> 17;
+		s.randomState ^= s.randomState << 5;
+		return uint8_t(s.randomState >> 24);
+	}
+
+	void ReferenceSkip(ReferenceState& s)
+	{
+		if (s.xoChip && ReferenceMemory(s, s.pc) == 0xF0 && ReferenceMemory(s, s.pc + 1) == 0x00)
+			s.pc += 2;
+		s.pc += 2;
+	}
+
+	void ReferenceStep(ReferenceState& s)
+	{
+		if (s.dt > 0)
+			--s.dt;
+		if (s.st > 0)
+			--s.st;
+
+		const uint16_t op = uint16_t(ReferenceMemory(s, s.pc) << 8 | ReferenceMemory(s, s.pc + 1));
+		s.pc += 2;
+		const uint8_t x = (op >> 8) & 0xF;
+		const uint8_t y = (op >> 4) & 0xF;
+		const uint8_t n = op & 0xF;
+		const uint8_t kk = op & 0xFF;
+		const uint16_t nnn = op & 0xFFF;
+
+		switch (op >> 12)
+		{
+		case 0x0:
+			if (op == 0x00E0)
+			{
+				for (auto& row : s.pixels)
+					for (uint8_t& pixel : row)
+						pixel &= ~s.planeMask;
+			}
+			else if (op == 0x00EE)
+			{
+				s.pc = s.stack[s.sp];
+				s.sp = (s.sp + 15) % 16;
+			}
+			else if ((op & 0xFFF0) == 0x00C0)
+				ReferenceScroll(s, 0, n);
+			else if ((op & 0xFFF0) == 0x00D0 && s.xoChip)
+				ReferenceScroll(s, 0, -n);
+			else if (op == 0x00FB)
+				ReferenceScroll(s, 4, 0);
+			else if (op == 0x00FC)
+				ReferenceScroll(s, -4, 0);
+			else if (op == 0x00FD)
+				s.pc -= 2;
+			else if (op == 0x00FE || op == 0x00FF)
+			{
+				s.isHighRes = op == 0x00FF;
+				std::memset(s.pixels, 0, sizeof(s.pixels));
+			}
+			break;
+		case 0x1: s.pc = nnn; break;
+		case 0x2: s.sp = (s.sp + 1) % 16; s.stack[s.sp] = s.pc; s.pc = nnn; break;
+		case 0x3: if (s.v[x] == kk) ReferenceSkip(s); break;
+		case 0x4: if (s.v[x] != kk) ReferenceSkip(s); break;
+		case 0x5:
+			if (n == 0 && s.v[x] == s.v[y])
+				ReferenceSkip(s);
+			else if ((n == 2 || n == 3) && s.xoChip)
+			{
+				const int step = x <= y ? 1 : -1;
+				for (int r = x, offset = 0; ; r += step, ++offset)
+				{
+					if (n == 2)
+						ReferenceMemory(s, s.i + offset) = s.v[r];
+					else
+						s.v[r] = ReferenceMemory(s, s.i + offset);
+					if (r == y)
+						break;
+				}
+			}
+			break;
+		case 0x6: s.v[x] = kk; break;
+		case 0x7: s.v[x] = uint8_t(s.v[x] + kk); break;
+		case 0x8:
+		{
+			const unsigned a = s.v[x];
+			const unsigned b = s.v[y];
+			switch (n)
+			{
+			case 0x0: s.v[x] = uint8_t(b); break;
+			case 0x1: s.v[x] = uint8_t(a | b); if (s.logicResetsVF) s.v[0xF] = 0; break;
+			case 0x2: s.v[x] = uint8_t(a & b); if (s.logicResetsVF) s.v[0xF] = 0; break;
+			case 0x3: s.v[x] = uint8_t(a ^ b); if (s.logicResetsVF) s.v[0xF] = 0; break;
+			case 0x4: s.v[x] = uint8_t(a + b); s.v[0xF] = (a + b) > 255 ? 1 : 0; break;
+			case 0x5: s.v[x] = uint8_t(a - b); s.v[0xF] = a >= b ? 1 : 0; break;
+			case 0x6:
+			{
+				const unsigned source = s.shiftUsesVy ? b : a;
+				s.v[x] = uint8_t(source / 2);
+				s.v[0xF] = source % 2;
+			} break;
+			case 0x7: s.v[x] = uint8_t(b - a); s.v[0xF] = b >= a ? 1 : 0; break;
+			case 0xE:
+			{
+				const unsigned source = s.shiftUsesVy ? b : a;
+				s.v[x] = uint8_t(source * 2);
+				s.v[0xF] = source >= 128 ? 1 : 0;
+			} break;
+			}
+		} break;
+		case 0x9: if (n == 0 && s.v[x] != s.v[y]) ReferenceSkip(s); break;
+		case 0xA: s.i = nnn; break;
+		case 0xB: s.pc = uint16_t(s.v[s.jumpUsesVx ? x : 0] + nnn); break;
+		case 0xC: s.v[x] = ReferenceRandom(s) & kk; break;
+		case 0xD:
+		{
+			//N == 0 is a 16x16 sprite stored as 2 bytes per row
+			const int width = s.isHighRes ? Framebuffer::m_HiresWidth : Framebuffer::m_LoresWidth;
+			const int height = s.isHighRes ? Framebuffer::m_HiresHeight : Framebuffer::m_LoresHeight;
+			//every selected plane reads its own sprite, one after the other
+			const int spriteWidth = n == 0 ? 16 : 8;
+			const int spriteHeight = n == 0 ? 16 : n;
+			const int spriteSize = n == 0 ? 32 : n;
+			bool collision = false;
+			int spriteStart = s.i;
+			for (int plane = 0; plane < Framebuffer::m_PlaneCount; ++plane)
+			{
+				const uint8_t planeBit = uint8_t(1 << plane);
+				if ((s.planeMask & planeBit) == 0)
+					continue;
+				for (int row = 0; row < spriteHeight; ++row)
+				{
+					for (int col = 0; col < spriteWidth; ++col)
+					{
+						const int byteIdx = n == 0 ? row * 2 + col / 8 : row;
+						if (((ReferenceMemory(s, spriteStart + byteIdx) >> (7 - col % 8)) & 1) == 0)
+							continue;
+						int px = s.v[x] % width + col;
+						int py = s.v[y] % height + row;
+						if (!s.spritesWrap && (px >= width || py >= height))
+							continue;
+						px %= width;
+						py %= height;
+						uint8_t& pixel = s.pixels[py][px];
+						if (pixel & planeBit)
+							collision = true;
+						pixel ^= planeBit;
+					}
+				}
+				spriteStart += spriteSize;
+			}
+			s.v[0xF] = collision ? 1 : 0;
+		} break;
+		case 0xE:
+			if (kk == 0x9E && s.input[s.v[x] % 16]) ReferenceSkip(s);
+			else if (kk == 0xA1 && !s.input[s.v[x] % 16]) ReferenceSkip(s);
+			break;
+		case 0xF:
+			if (s.xoChip && op == 0xF000)
+			{
+				s.i = uint16_t(ReferenceMemory(s, s.pc) << 8 | ReferenceMemory(s, s.pc + 1));
+				s.pc += 2;
+				break;
+			}
+			if (s.xoChip && op == 0xF002)
+			{
+				for (int b = 0; b < 16; ++b) s.audioPattern[b] = ReferenceMemory(s, s.i + b);
+				break;
+			}
+			switch (kk)
+			{
+			case 0x01: if (s.xoChip) s.planeMask = x & 3; break;
+			case 0x3A: if (s.xoChip) s.audioPitch = s.v[x]; break;
+			case 0x07: s.v[x] = s.dt; break;
+			case 0x0A:
+			{
+				bool isKeyFound = false;
+				for (uint8_t key = 0; key < 16 && !isKeyFound; ++key)
+				{
+					if (s.input[key])
+					{
+						s.v[x] = key;
+						isKeyFound = true;
+					}
+				}
+				if (!isKeyFound)
+					s.pc -= 2;
+			} break;
+			case 0x15: s.dt = s.v[x]; break;
+			case 0x18: s.st = s.v[x]; break;
+			case 0x1E: s.i = uint16_t(s.i + s.v[x]); break;
+			case 0x29: s.i = uint16_t(0x50 + 5 * s.v[x]); break;
+			case 0x30: s.i = uint16_t(0xA0 + 10 * (s.v[x] % 10)); break;
+			case 0x33:
+				ReferenceMemory(s, s.i) = s.v[x] / 100;
+				ReferenceMemory(s, s.i + 1) = (s.v[x] / 10) % 10;
+				ReferenceMemory(s, s.i + 2) = s.v[x] % 10;
+				break;
+			case 0x55:
+				for (int r = 0; r <= x; ++r) ReferenceMemory(s, s.i + r) = s.v[r];
+				if (s.loadStoreIncrementsI) s.i = uint16_t(s.i + x + 1);
+				break;
+			case 0x65:
+				for (int r = 0; r <= x; ++r) s.v[r] = ReferenceMemory(s, s.i + r);
+				if (s.loadStoreIncrementsI) s.i = uint16_t(s.i + x + 1);
+				break;
+			case 0x75: for (int r = 0; r <= x; ++r) s.rplFlags[r] = s.v[r]; break;
+			case 0x85: for (int r = 0; r <= x; ++r) s.v[r] = s.rplFlags[r]; break;
+			}
+			break;
+		}
+	}
+
+	//screen, resolution and plane selection
+	void CopyPixelsToReference(const VirtualMachine& vm, ReferenceState& s)
+	{
+		for (uint16_t y = 0; y < Framebuffer::m_HiresHeight; ++y)
+		{
+			for (uint16_t x = 0; x < Framebuffer::m_HiresWidth; ++x)
+				s.pixels[y][x] = vm.m_Framebuffer.GetPixel(x, y);
+		}
+		s.isHighRes = vm.m_Framebuffer.IsHighRes();
+		s.planeMask = vm.m_Framebuffer.GetPlaneMask();
+	}
+
+	//everything but memory and the screen
+	void CopyRegistersToReference(const VirtualMachine& vm, ReferenceState& s)
+	{
+		s.planeMask = vm.m_Framebuffer.GetPlaneMask();
+		std::memcpy(s.rplFlags, vm.m_Cpu.rplFlags, sizeof(s.rplFlags));
+		std::memcpy(s.audioPattern, vm.m_Cpu.audioPattern, sizeof(s.audioPattern));
+		s.audioPitch = vm.m_Cpu.audioPitch;
+		std::memcpy(s.stack, vm.m_Cpu.stack, sizeof(s.stack));
+		std::memcpy(s.v, vm.m_Cpu.vx, sizeof(s.v));
+		std::memcpy(s.input, vm.m_Cpu.input, sizeof(s.input));
+		s.i = vm.m_Cpu.vi;
+		s.pc = vm.GetPC();
+		s.sp = vm.GetSP();
+		s.dt = vm.m_Cpu.dt;
+		s.st = vm.m_Cpu.st;
+		s.randomState = vm.m_Cpu.randomState;
+	}
+
+	//folds to a constant
+	bool IsLittleEndian()
+	{
+		const uint16_t probe = 1;
+		return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+	}
+
+	//memory and pixels are only compared when the instruction could have written them, keeps millions of steps fast
+	bool IsStateEqual(const VirtualMachine& vm, const ReferenceState& s, const bool compareMemory, const bool comparePixels)
+	{
+		if (vm.GetPC() != s.pc || vm.GetSP() != s.sp || vm.m_Cpu.vi != s.i || vm.m_Cpu.dt != s.dt || vm.m_Cpu.st != s.st || vm.m_Cpu.randomState != s.randomState)
+			return false;
+		if (std::memcmp(vm.m_Cpu.vx, s.v, sizeof(s.v)) != 0 || std::memcmp(vm.m_Cpu.stack, s.stack, sizeof(s.stack)) != 0)
+			return false;
+		if (std::memcmp(vm.m_Cpu.rplFlags, s.rplFlags, sizeof(s.rplFlags)) != 0 || vm.m_Framebuffer.IsHighRes() != s.isHighRes)
+			return false;
+		if (vm.m_Framebuffer.GetPlaneMask() != s.planeMask || vm.m_Cpu.audioPitch != s.audioPitch || std::memcmp(vm.m_Cpu.audioPattern, s.audioPattern, sizeof(s.audioPattern)) != 0)
+			return false;
+		if (compareMemory && !vm.m_Memory.IsEqual(s.memory))
+			return false;
+		if (!comparePixels)
+			return true;
+		//the reference row packed like the core's words, a word compare instead of a pixel lookup per pixel
+		for (uint16_t y = 0; y < Framebuffer::m_HiresHeight; ++y)
+		{
+			for (uint16_t word = 0; word < 2; ++word)
+			{
+				const uint8_t* pPixels = s.pixels[y] + word * 64;
+				uint64_t low = 0;
+				uint64_t high = 0;
+				for (uint16_t group = 0; group < 8; ++group)
+				{
+					//8 pixels at once: the multiply gathers bit 0 of every byte into the top byte, first pixel highest.
+					//The first pixel has to be the lowest byte, big endian hosts load them one by one
+					uint64_t bytes = 0;
+					if (IsLittleEndian())
+						std::memcpy(&bytes, pPixels + group * 8, sizeof(bytes));
+					else
+					{
+						for (uint16_t pixel = 0; pixel < 8; ++pixel)
+							bytes |= uint64_t(pPixels[group * 8 + pixel]) << (pixel * 8);
+					}
+					low = (low << 8) | (((bytes & 0x0101010101010101ull) * 0x8040201008040201ull) >> 56);
+					high = (high << 8) | ((((bytes >> 1) & 0x0101010101010101ull) * 0x8040201008040201ull) >> 56);
+				}
+				if (vm.m_Framebuffer.GetRow(0, y)[word] != low || vm.m_Framebuffer.GetRow(1, y)[word] != high)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	//patterns the core knows about, the remaining bits are randomized. XO-CHIP only ones are unknown opcodes for the other profiles
+	struct OpcodePattern { uint16_t instruction, mask; };
+	const OpcodePattern g_Patterns[]{
+		{ 0x00E0, 0xFFFF }, { 0x00EE, 0xFFFF }, { 0x00C0, 0xFFF0 }, { 0x00FB, 0xFFFF }, { 0x00FC, 0xFFFF }, { 0x00FD, 0xFFFF },
+		{ 0x00FE, 0xFFFF }, { 0x00FF, 0xFFFF }, { 0x1000, 0xF000 }, { 0x2000, 0xF000 }, { 0x3000, 0xF000 }, { 0x4000, 0xF000 },
+		{ 0x5000, 0xF00F }, { 0x6000, 0xF000 }, { 0x7000, 0xF000 }, { 0x8000, 0xF00F }, { 0x8001, 0xF00F }, { 0x8002, 0xF00F },
+		{ 0x8003, 0xF00F }, { 0x8004, 0xF00F }, { 0x8005, 0xF00F }, { 0x8006, 0xF00F }, { 0x8007, 0xF00F }, { 0x800E, 0xF00F },
+		{ 0x9000, 0xF00F }, { 0xA000, 0xF000 }, { 0xB000, 0xF000 }, { 0xC000, 0xF000 }, { 0xD000, 0xF000 }, { 0xE09E, 0xF0FF },
+		{ 0xE0A1, 0xF0FF }, { 0xF007, 0xF0FF }, { 0xF00A, 0xF0FF }, { 0xF015, 0xF0FF }, { 0xF018, 0xF0FF }, { 0xF01E, 0xF0FF },
+		{ 0xF029, 0xF0FF }, { 0xF030, 0xF0FF }, { 0xF033, 0xF0FF }, { 0xF055, 0xF0FF }, { 0xF065, 0xF0FF }, { 0xF075, 0xF0FF },
+		{ 0xF085, 0xF0FF }, { 0x00D0, 0xFFF0 }, { 0x5002, 0xF00F }, { 0x5003, 0xF00F }, { 0xF000, 0xFFFF }, { 0xF001, 0xF0FF },
+		{ 0xF002, 0xFFFF }, { 0xF03A, 0xF0FF }
+	};
+	const uint32_t g_PatternCount = sizeof(g_Patterns) / sizeof(g_Patterns[0]);
+
+	struct SplitMix
+	{
+		uint64_t state;
+		uint64_t Next()
+		{
+			uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+	};
+
+	//the page around address gets fresh random bytes, in both the core and the reference
+	void ReseedPage(VirtualMachine& vm, ReferenceState& s, SplitMix& random, const uint32_t address)
+	{
+		const uint32_t pageStart = (address % s.memSize) & ~(PagedMemory::m_PageSize - 1);
+		uint8_t* pPage = s.memory + pageStart;
+		for (uint32_t offset = 0; offset < PagedMemory::m_PageSize; offset += 8)
+		{
+			const uint64_t bytes = random.Next();
+			std::memcpy(pPage + offset, &bytes, 8);
+		}
+		vm.m_Memory.Write(pageStart, pPage, PagedMemory::m_PageSize);
+	}
+
+	struct OpcodeCase
+	{
+		const char* name;
+		uint16_t opcode;
+		void(*setup)(VirtualMachine& vm);
+		bool(*check)(const VirtualMachine& vm);
+	};
+
+	//every case runs on a fresh vm with the opcode at 0x200 and PC at 0x200
+	const OpcodeCase g_OpcodeCases[]{
+		{ "00E0 clears all pixels", 0x00E0, [](VirtualMachine& vm) { std::memset(vm.m_Framebuffer.m_Planes, 0xFF, sizeof(vm.m_Framebuffer.m_Planes)); },
+			[](const VirtualMachine& vm) { for (const auto& row : vm.m_Framebuffer.m_Planes[0]) if (row[0] | row[1]) return false; return true; } },
+		{ "00EE returns", 0x00EE, [](VirtualMachine& vm) { vm.SetSP(1); vm.m_Cpu.stack[1] = 0x345; },
+			[](const VirtualMachine& vm) { return vm.GetPC() == 0x345 && vm.GetSP() == 0; } },
+		{ "00CN scrolls down", 0x00C3, [](VirtualMachine& vm) { vm.m_Framebuffer.m_Planes[0][0][0] = 1ull << 63; },
+			[](const VirtualMachine& vm) { return vm.m_Framebuffer.GetPixel(0, 3) && !vm.m_Framebuffer.GetPixel(0, 0); } },
+		{ "00FB scrolls right", 0x00FB, [](VirtualMachine& vm) { vm.m_Framebuffer.m_Planes[0][1][0] = 1ull << 63 | 1; },
+			[](const VirtualMachine& vm) { return vm.m_Framebuffer.GetPixel(4, 1) && !vm.m_Framebuffer.GetPixel(0, 1) && vm.m_Framebuffer.m_Planes[0][1][1] == 0; } },
+		{ "00FB hires crosses words", 0x00FB, [](VirtualMachine& vm) { vm.m_Framebuffer.SetHighRes(true); vm.m_Framebuffer.m_Planes[0][1][0] = 1; },
+			[](const VirtualMachine& vm) { return vm.m_Framebuffer.GetPixel(67, 1) && vm.m_Framebuffer.m_Planes[0][1][0] == 0; } },
+		{ "00FC scrolls left", 0x00FC, [](VirtualMachine& vm) { vm.m_Framebuffer.SetHighRes(true); vm.m_Framebuffer.m_Planes[0][1][1] = 1ull << 63; },
+			[](const VirtualMachine& vm) { return vm.m_Framebuffer.GetPixel(60, 1) && vm.m_Framebuffer.m_Planes[0][1][1] == 0; } },
+		{ "00FD parks PC", 0x00FD, [](VirtualMachine&) {}, [](const VirtualMachine& vm) { return vm.GetPC() == 0x200; } },
+		{ "00FF enables hires and clears", 0x00FF, [](VirtualMachine& vm) { vm.m_Framebuffer.m_Planes[0][0][0] = 1; },
+			[](const VirtualMachine& vm) { return vm.m_Framebuffer.IsHighRes() && vm.m_Framebuffer.GetWidth() == 128 && vm.m_Framebuffer.m_Planes[0][0][0] == 0; } },
+		{ "00FE disables hires", 0x00FE, [](VirtualMachine& vm) { vm.m_Framebuffer.SetHighRes(true); },
+			[](const VirtualMachine& vm) { return !vm.m_Framebuffer.IsHighRes() && vm.m_Framebuffer.GetHeight() == 32; } },
+		{ "1NNN jumps", 0x1ABC, [](VirtualMachine&) {}, [](const VirtualMachine& vm) { return vm.GetPC() == 0xABC; } },
+		{ "2NNN calls", 0x2ABC, [](VirtualMachine&) {},
+			[](const VirtualMachine& vm) { return vm.GetPC() == 0xABC && vm.GetSP() == 1 && vm.m_Cpu.stack[1] == 0x202; } },
+		{ "3XKK skips on equal", 0x3312, [](VirtualMachine& vm) { vm.m_Cpu.vx[3] = 0x12; }, [](const VirtualMachine& vm) { return vm.GetPC() == 0x204; } },
+		{ "3XKK no skip", 0x3312, [](VirtualMachine& vm) { vm.m_Cpu.vx[3] = 0x13; }, [](const VirtualMachine& vm) { return vm.GetPC() == 0x202; } },
+		{ "4XKK skips on not equal", 0x4312, [](VirtualMachine& vm) { vm.m_Cpu.vx[3] = 0x13; }, [](const VirtualMachine& vm) { return vm.GetPC() == 0x204; } },
+		{ "5XY0 skips on equal", 0x5340, [](VirtualMachine& vm) { vm.m_Cpu.vx[3] = 7; vm.m_Cpu.vx[4] = 7; }, [](const VirtualMachine& vm) { return vm.GetPC() == 0x204; } },
+		{ "6XKK loads", 0x6A42, [](VirtualMachine&) {}, [](const VirtualMachine& vm) { return vm.m_Cpu.vx[0xA] == 0x42; } },
+		{ "7XKK adds without carry", 0x7A02, [](VirtualMachine& vm) { vm.m_Cpu.vx[0xA] = 0xFF; vm.m_Cpu.vx[0xF] = 5; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[0xA] == 0x01 && vm.m_Cpu.vx[0xF] == 5; } },
+		{ "8XY0 copies", 0x8120, [](VirtualMachine& vm) { vm.m_Cpu.vx[2] = 9; }, [](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 9; } },
+		{ "8XY1 or", 0x8121, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0xF0; vm.m_Cpu.vx[2] = 0x0F; }, [](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0xFF; } },
+		{ "8XY2 and", 0x8122, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0xF3; vm.m_Cpu.vx[2] = 0x3F; }, [](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0x33; } },
+		{ "8XY3 xor", 0x8123, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0xF3; vm.m_Cpu.vx[2] = 0x3F; }, [](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0xCC; } },
+		{ "8XY4 carry", 0x8124, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0xFF; vm.m_Cpu.vx[2] = 0x02; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0x01 && vm.m_Cpu.vx[0xF] == 1; } },
+		{ "8XY4 no carry", 0x8124, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0x02; vm.m_Cpu.vx[2] = 0x03; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0x05 && vm.m_Cpu.vx[0xF] == 0; } },
+		{ "8XY4 VF as X keeps flag", 0x8F14, [](VirtualMachine& vm) { vm.m_Cpu.vx[0xF] = 0xFF; vm.m_Cpu.vx[1] = 0x02; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[0xF] == 1; } },
+		{ "8XY5 no borrow on equal", 0x8125, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 5; vm.m_Cpu.vx[2] = 5; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0 && vm.m_Cpu.vx[0xF] == 1; } },
+		{ "8XY5 borrow", 0x8125, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 4; vm.m_Cpu.vx[2] = 5; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0xFF && vm.m_Cpu.vx[0xF] == 0; } },
+		{ "8XY6 shifts right", 0x8126, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0x03; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0x01 && vm.m_Cpu.vx[0xF] == 1; } },
+		{ "8XY7 reverse subtract", 0x8127, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 3; vm.m_Cpu.vx[2] = 5; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 2 && vm.m_Cpu.vx[0xF] == 1; } },
+		{ "8XYE shifts left", 0x812E, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0x81; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0x02 && vm.m_Cpu.vx[0xF] == 1; } },
+		{ "8XYE no carry", 0x812E, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0x41; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 0x82 && vm.m_Cpu.vx[0xF] == 0; } },
+		{ "9XY0 skips on not equal", 0x9340, [](VirtualMachine& vm) { vm.m_Cpu.vx[3] = 7; vm.m_Cpu.vx[4] = 8; }, [](const VirtualMachine& vm) { return vm.GetPC() == 0x204; } },
+		{ "ANNN sets I", 0xA123, [](VirtualMachine&) {}, [](const VirtualMachine& vm) { return vm.m_Cpu.vi == 0x123; } },
+		{ "BNNN jumps with V0", 0xB300, [](VirtualMachine& vm) { vm.m_Cpu.vx[0] = 0x10; }, [](const VirtualMachine& vm) { return vm.GetPC() == 0x310; } },
+		{ "CXKK masks random", 0xC10F, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0xFF; }, [](const VirtualMachine& vm) { return (vm.m_Cpu.vx[1] & 0xF0) == 0; } },
+		{ "DXYN draws", 0xD125, [](VirtualMachine& vm) { vm.m_Cpu.vi = 0x050; vm.m_Cpu.vx[1] = 2; vm.m_Cpu.vx[2] = 3; },
+			[](const VirtualMachine& vm) { const Framebuffer& fb = vm.m_Framebuffer; return fb.GetPixel(2, 3) && fb.GetPixel(5, 3) && !fb.GetPixel(6, 3) && vm.m_Cpu.vx[0xF] == 0; } },
+		{ "DXYN collides", 0xD121, [](VirtualMachine& vm) { vm.m_Cpu.vi = 0x050; vm.m_Framebuffer.m_Planes[0][0][0] = 1ull << 61; vm.m_Cpu.vx[1] = 2; vm.m_Cpu.vx[2] = 0; },
+			[](const VirtualMachine& vm) { return !vm.m_Framebuffer.GetPixel(2, 0) && vm.m_Cpu.vx[0xF] == 1; } },
+		{ "DXYN wraps", 0xD121, [](VirtualMachine& vm) { vm.m_Cpu.vi = 0x050; vm.m_Cpu.vx[1] = 62; vm.m_Cpu.vx[2] = 31; },
+			[](const VirtualMachine& vm) { const Framebuffer& fb = vm.m_Framebuffer; return fb.GetPixel(62, 31) && fb.GetPixel(1, 31) && !fb.GetPixel(2, 31); } },
+		{ "DXYN hires wraps", 0xD121, [](VirtualMachine& vm) { vm.m_Framebuffer.SetHighRes(true); vm.m_Cpu.vi = 0x050; vm.m_Cpu.vx[1] = 126; vm.m_Cpu.vx[2] = 63; },
+			[](const VirtualMachine& vm) { const Framebuffer& fb = vm.m_Framebuffer; return fb.GetPixel(127, 63) && fb.GetPixel(1, 63) && !fb.GetPixel(2, 63); } },
+		{ "DXY0 draws 16x16", 0xD120, [](VirtualMachine& vm) { vm.m_Framebuffer.SetHighRes(true); vm.m_Cpu.vi = 0x300; vm.WriteMemory(0x300, 0x80); vm.WriteMemory(0x31F, 0x01); vm.m_Cpu.vx[1] = 60; vm.m_Cpu.vx[2] = 10; },
+			[](const VirtualMachine& vm) { const Framebuffer& fb = vm.m_Framebuffer; return fb.GetPixel(60, 10) && fb.GetPixel(75, 25) && !fb.GetPixel(61, 10) && vm.m_Cpu.vx[0xF] == 0; } },
+		{ "EX9E skips when pressed", 0xE19E, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0xA; vm.m_Cpu.input[0xA] = 1; }, [](const VirtualMachine& vm) { return vm.GetPC() == 0x204; } },
+		{ "EXA1 skips when released", 0xE1A1, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0xA; }, [](const VirtualMachine& vm) { return vm.GetPC() == 0x204; } },
+		{ "FX07 reads delay timer", 0xF107, [](VirtualMachine& vm) { vm.m_Cpu.dt = 10; }, [](const VirtualMachine& vm) { return vm.m_Cpu.vx[1] == 9; } },
+		{ "FX0A waits", 0xF10A, [](VirtualMachine&) {}, [](const VirtualMachine& vm) { return vm.GetPC() == 0x200; } },
+		{ "FX0A stores key", 0xF10A, [](VirtualMachine& vm) { vm.m_Cpu.input[0xC] = 1; }, [](const VirtualMachine& vm) { return vm.GetPC() == 0x202 && vm.m_Cpu.vx[1] == 0xC; } },
+		{ "FX15 sets delay timer", 0xF115, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 30; }, [](const VirtualMachine& vm) { return vm.m_Cpu.dt == 30; } },
+		{ "FX18 sets sound timer", 0xF118, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 30; }, [](const VirtualMachine& vm) { return vm.m_Cpu.st == 30; } },
+		{ "FX1E adds to I", 0xF11E, [](VirtualMachine& vm) { vm.m_Cpu.vi = 0x100; vm.m_Cpu.vx[1] = 0x20; }, [](const VirtualMachine& vm) { return vm.m_Cpu.vi == 0x120; } },
+		{ "FX29 font address", 0xF129, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 0xA; }, [](const VirtualMachine& vm) { return vm.m_Cpu.vi == 0x050 + 5 * 0xA; } },
+		{ "FX30 large font address", 0xF130, [](VirtualMachine& vm) { vm.m_Cpu.vx[1] = 7; }, [](const VirtualMachine& vm) { return vm.m_Cpu.vi == 0x0A0 + 10 * 7; } },
+		{ "FX33 stores BCD", 0xF133, [](VirtualMachine& vm) { vm.m_Cpu.vi = 0x300; vm.m_Cpu.vx[1] = 254; },
+			[](const VirtualMachine& vm) { return vm.ReadMemory(0x300) == 2 && vm.ReadMemory(0x301) == 5 && vm.ReadMemory(0x302) == 4; } },
+		{ "FX55 stores V0..VX", 0xF255, [](VirtualMachine& vm) { vm.m_Cpu.vi = 0x300; vm.m_Cpu.vx[0] = 1; vm.m_Cpu.vx[1] = 2; vm.m_Cpu.vx[2] = 3; vm.m_Cpu.vx[3] = 4; },
+			[](const VirtualMachine& vm) { return vm.ReadMemory(0x300) == 1 && vm.ReadMemory(0x302) == 3 && vm.ReadMemory(0x303) == 0; } },
+		{ "FX65 loads V0..VX", 0xF265, [](VirtualMachine& vm) { vm.m_Cpu.vi = 0x300; vm.WriteMemory(0x300, 7); vm.WriteMemory(0x302, 9); vm.WriteMemory(0x303, 1); },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[0] == 7 && vm.m_Cpu.vx[2] == 9 && vm.m_Cpu.vx[3] == 0; } },
+		{ "FX75 saves RPL flags", 0xF175, [](VirtualMachine& vm) { vm.m_Cpu.vx[0] = 4; vm.m_Cpu.vx[1] = 5; vm.m_Cpu.vx[2] = 6; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.rplFlags[0] == 4 && vm.m_Cpu.rplFlags[1] == 5 && vm.m_Cpu.rplFlags[2] == 0; } },
+		{ "FX85 loads RPL flags", 0xF185, [](VirtualMachine& vm) { vm.m_Cpu.rplFlags[0] = 4; vm.m_Cpu.rplFlags[1] = 5; vm.m_Cpu.rplFlags[2] = 6; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[0] == 4 && vm.m_Cpu.vx[1] == 5 && vm.m_Cpu.vx[2] == 0; } },
+		//XO-CHIP, setup switches the profile which keeps the opcode already written to memory
+		{ "F000 NNNN loads a 16 bit I", 0xF000, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); vm.WriteMemory(0x202, 0xBE); vm.WriteMemory(0x203, 0xEF); },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vi == 0xBEEF && vm.GetPC() == 0x204; } },
+		{ "3XKK skips all of F000 NNNN", 0x3312, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); vm.m_Cpu.vx[3] = 0x12; vm.WriteMemory(0x202, 0xF0); vm.WriteMemory(0x203, 0x00); },
+			[](const VirtualMachine& vm) { return vm.GetPC() == 0x206; } },
+		{ "FX55 writes above 4 KB", 0xF155, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); vm.m_Cpu.vi = 0xF000; vm.m_Cpu.vx[0] = 7; vm.m_Cpu.vx[1] = 8; },
+			[](const VirtualMachine& vm) { return vm.m_MemSize == 0x10000 && vm.ReadMemory(0xF000) == 7 && vm.ReadMemory(0xF001) == 8 && vm.ReadMemory(0x000) == 0; } },
+		{ "5XY2 saves a reversed range", 0x5312, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); vm.m_Cpu.vi = 0x300; vm.m_Cpu.vx[1] = 3; vm.m_Cpu.vx[2] = 2; vm.m_Cpu.vx[3] = 1; },
+			[](const VirtualMachine& vm) { return vm.ReadMemory(0x300) == 1 && vm.ReadMemory(0x301) == 2 && vm.ReadMemory(0x302) == 3 && vm.m_Cpu.vi == 0x300; } },
+		{ "5XY3 loads a range", 0x5233, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); vm.m_Cpu.vi = 0x300; vm.WriteMemory(0x300, 5); vm.WriteMemory(0x301, 6); },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.vx[2] == 5 && vm.m_Cpu.vx[3] == 6 && vm.m_Cpu.vx[1] == 0 && vm.m_Cpu.vi == 0x300; } },
+		{ "FN01 selects planes", 0xF201, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); },
+			[](const VirtualMachine& vm) { return vm.m_Framebuffer.GetPlaneMask() == 2; } },
+		{ "DXYN draws each selected plane", 0xD121, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); vm.m_Framebuffer.SelectPlanes(3); vm.m_Cpu.vi = 0x300; vm.WriteMemory(0x300, 0x80); vm.WriteMemory(0x301, 0xC0); },
+			[](const VirtualMachine& vm) { return vm.m_Framebuffer.GetPixel(0, 0) == 3 && vm.m_Framebuffer.GetPixel(1, 0) == 2 && vm.m_Cpu.vx[0xF] == 0; } },
+		{ "00DN scrolls up selected planes", 0x00D2, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); vm.m_Framebuffer.m_Planes[0][3][0] = 1ull << 63; vm.m_Framebuffer.m_Planes[1][3][0] = 1ull << 63; },
+			[](const VirtualMachine& vm) { return vm.m_Framebuffer.GetPixel(0, 1) == 1 && vm.m_Framebuffer.GetPixel(0, 3) == 2; } },
+		{ "F002 loads the audio pattern", 0xF002, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); vm.m_Cpu.vi = 0x300; vm.WriteMemory(0x300, 0xAA); vm.WriteMemory(0x30F, 0x55); },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.audioPattern[0] == 0xAA && vm.m_Cpu.audioPattern[15] == 0x55; } },
+		{ "FX3A sets the pitch", 0xF13A, [](VirtualMachine& vm) { vm.SetQuirkProfile(InstructionLib::QuirkProfile::XoChip); vm.m_Cpu.vx[1] = 112; },
+			[](const VirtualMachine& vm) { return vm.m_Cpu.audioPitch == 112; } },
+	};
+}
+
+bool Conformance::RunOpcodeCases()
+{
+	uint32_t failCount = 0;
+	for (const OpcodeCase& opcodeCase : g_OpcodeCases)
+	{
+		std::unique_ptr<VirtualMachine> pVM{ new VirtualMachine() };
+		pVM->WriteMemory(0x200, uint8_t(opcodeCase.opcode >> 8));
+		pVM->WriteMemory(0x201, uint8_t(opcodeCase.opcode));
+		opcodeCase.setup(*pVM);
+		pVM->Update();
+		if (!opcodeCase.check(*pVM))
+		{
+			std::cerr << "FAILED " << opcodeCase.name << std::endl;
+			++failCount;
+		}
+	}
+	const uint32_t caseCount = uint32_t(sizeof(g_OpcodeCases) / sizeof(g_OpcodeCases[0]));
+	std::cout << caseCount - failCount << "/" << caseCount << " opcode cases passed" << std::endl;
+	return failCount == 0;
+}
+
+bool Conformance::RunDifferential(const uint64_t randomStepCount, const uint32_t seed)
+{
+	const InstructionLib::QuirkProfile profiles[]{ InstructionLib::QuirkProfile::Modern, InstructionLib::QuirkProfile::CosmacVIP, InstructionLib::QuirkProfile::SuperChip,
+		InstructionLib::QuirkProfile::XoChip };
+	for (const InstructionLib::QuirkProfile profile : profiles)
+	{
+		if (!RunDifferential(randomStepCount, seed, profile))
+			return false;
+	}
+	return true;
+}
+
+bool Conformance::RunDifferential(const uint64_t randomStepCount, const uint32_t seed, const InstructionLib::QuirkProfile profile)
+{
+	//sequences start from a random machine state and run until the budget is used or PC leaves memory
+	const uint32_t stepsPerSequence = 64;
+	SplitMix random{ seed };
+	std::unique_ptr<VirtualMachine> pVM{ new VirtualMachine() };
+	std::unique_ptr<ReferenceState> pReference{ new ReferenceState() };
+	pVM->SetQuirkProfile(profile);
+	SetReferenceQuirks(*pReference, profile);
+	//memory is randomized once, sequences after that reseed the few pages they are likely to read and keep the rest
+	//as the last sequence left it (core and reference are compared equal at the end of every sequence)
+	for (uint32_t address = 0; address < pVM->m_MemSize; ++address)
+		pVM->WriteMemory(uint16_t(address), uint8_t(random.Next()));
+	pReference->memSize = pVM->m_MemSize;
+	pVM->m_Memory.Read(0, pReference->memory, pVM->m_MemSize);
+
+	uint64_t executedSteps = 0;
+	uint64_t sequenceCount = 0;
+	while (executedSteps < randomStepCount)
+	{
+		VirtualMachine& vm = *pVM;
+		//a fresh screen and resolution every 16 sequences, copying it to the reference costs more than a whole sequence.
+		//lores keeps its pixels in word 0 of the first 32 rows, the rest stays 0. Only XO-CHIP draws into plane 1
+		Framebuffer& framebuffer = vm.m_Framebuffer;
+		if (sequenceCount++ % 16 == 0)
+		{
+			framebuffer.SetHighRes((random.Next() & 3) == 0);
+			for (uint8_t plane = 0; plane < (pReference->xoChip ? Framebuffer::m_PlaneCount : 1); ++plane)
+			{
+				for (uint16_t y = 0; y < framebuffer.GetHeight(); ++y)
+				{
+					framebuffer.m_Planes[plane][y][0] = random.Next();
+					framebuffer.m_Planes[plane][y][1] = framebuffer.IsHighRes() ? random.Next() : 0;
+				}
+			}
+			CopyPixelsToReference(vm, *pReference);
+		}
+		framebuffer.SelectPlanes(pReference->xoChip ? uint8_t(random.Next()) : 1);
+		for (uint8_t& flag : vm.m_Cpu.rplFlags)
+			flag = uint8_t(random.Next());
+		for (uint8_t& sample : vm.m_Cpu.audioPattern)
+			sample = uint8_t(random.Next());
+		vm.m_Cpu.audioPitch = uint8_t(random.Next());
+		for (uint8_t r = 0; r < 16; ++r)
+		{
+			vm.m_Cpu.vx[r] = uint8_t(random.Next());
+			vm.m_Cpu.stack[r] = uint16_t(random.Next() & 0xFFE);
+			vm.m_Cpu.input[r] = uint8_t(random.Next() & 1);
+		}
+		vm.m_Cpu.vi = uint16_t(random.Next());
+		vm.m_Cpu.dt = uint8_t(random.Next());
+		vm.m_Cpu.st = uint8_t(random.Next());
+		vm.SetSP(uint8_t(random.Next() % 16));
+		vm.SetPC(uint16_t(0x200 + (random.Next() & 0xDFE)));
+		vm.m_Cpu.randomState = uint32_t(random.Next()) | 1;
+		//the code about to run, what I points at (sprites, FX65) and two pages anywhere
+		ReseedPage(vm, *pReference, random, vm.GetPC());
+		ReseedPage(vm, *pReference, random, vm.m_Cpu.vi);
+		ReseedPage(vm, *pReference, random, uint32_t(random.Next()));
+		ReseedPage(vm, *pReference, random, uint32_t(random.Next()));
+		CopyRegistersToReference(vm, *pReference);
+
+		for (uint32_t step = 0; step < stepsPerSequence && executedSteps < randomStepCount; ++step)
+		{
+			ReferenceState& s = *pReference;
+			//the core halts once PC runs off the end of memory
+			if (s.pc > s.memSize - 2)
+				break;
+
+			//mostly known opcodes with random operands, some completely random words to cover the unknown ones
+			const uint64_t bits = random.Next();
+			const OpcodePattern& pattern = g_Patterns[(bits >> 32) % g_PatternCount];
+			const uint16_t op = (bits & 7) == 0 ? uint16_t(bits >> 16) : uint16_t(pattern.instruction | (uint16_t(bits >> 16) & ~pattern.mask));
+
+			vm.WriteMemory(s.pc, s.memory[s.pc] = uint8_t(op >> 8));
+			vm.WriteMemory(s.pc + 1, s.memory[s.pc + 1] = uint8_t(op));
+
+			vm.Update();
+			ReferenceStep(s);
+			++executedSteps;
+
+			const bool writesMemory = (op & 0xF0FF) == 0xF033 || (op & 0xF0FF) == 0xF055 || (op & 0xF00F) == 0x5002;
+			const bool writesPixels = (op & 0xFF00) == 0x0000 || (op & 0xF000) == 0xD000;
+			if (!IsStateEqual(vm, s, writesMemory, writesPixels))
+			{
+				std::cerr << "Core differs from reference after opcode " << std::hex << std::setw(4) << std::setfill('0') << op << std::dec
+					<< " (step " << executedSteps << ", seed " << seed << ", quirk profile " << int(profile) << ")" << std::endl;
+				return false;
+			}
+		}
+
+		if (!IsStateEqual(vm, *pReference, true, true))
+		{
+			std::cerr << "Core memory or pixels differ from reference at the end of a sequence (seed " << seed << ", quirk profile " << int(profile) << ")" << std::endl;
+			return false;
+		}
+	}
+	std::cout << executedSteps << " random steps matched the reference interpreter (quirk profile " << int(profile) << ")" << std::endl;
+	return true;
+}
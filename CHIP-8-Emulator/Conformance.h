@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include "Quirks.h"
+//Self check of the opcode handlers, run with --conformance.
+//Returns true when every opcode case passes and the optimized core matches the reference interpreter on all random steps.
+namespace Conformance
+{
+	bool RunOpcodeCases();
+	//executes randomStepCount random instructions in both the core and a plain switch based reference interpreter,
+	//comparing the full machine state after every step. Without a profile every quirk profile is checked.
+	bool RunDifferential(const uint64_t randomStepCount, const uint32_t seed);
+	bool RunDifferential(const uint64_t randomStepCount, const uint32_t seed, const InstructionLib::QuirkProfile profile);
+}
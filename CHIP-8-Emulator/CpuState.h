@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+//Everything an instruction reads or writes besides memory and pixels, in the first two cache lines of a vm.
+//Hosting many vms on one core means stepping each for a frame in turn: a frame then pulls in these lines, the
+//dispatch fields after them and the pages it touches, instead of registers spread between pixel rows and pointers.
+//Plain data, forks copy it with one assignment.
+struct alignas(64) CpuState
+{
+	//line 0: read or written by almost every instruction
+	//Program counter, holds currently executed address
+	uint16_t pc;
+	//used to store memory addresses
+	uint16_t vi;
+	//general purpose registers 0 to F
+	uint8_t vx[16];
+	//Stack pointer, points to upmost level of the stack
+	uint8_t sp;
+	//delay and sound timer registers
+	uint8_t dt;
+	uint8_t st;
+	//XO-CHIP FX3A pitch
+	uint8_t audioPitch;
+	//CXKK xorshift state, seeded per vm so runs are reproducible
+	uint32_t randomState;
+	//used to store the address that the interpreter shoud return to when finished with a subroutine. Chip-8 allows for up to 16 levels of nested subroutines.
+	uint16_t stack[16];
+
+	//line 1: touched by a few instructions and once per frame
+	//CHIP-8 key states as the frontends report them
+	uint8_t input[16];
+	//SUPER-CHIP FX75/FX85 persistent user flags (HP48 RPL flags)
+	uint8_t rplFlags[16];
+	//XO-CHIP F002 1 bit sample pattern (128 samples), played while the sound timer runs
+	uint8_t audioPattern[16];
+	//set by 00E0 and DXYN, cleared once the frame has been published to all sinks
+	bool displayUpdated;
+	bool isPaused;
+};
+static_assert(sizeof(CpuState) == 128, "CpuState is meant to fill exactly two cache lines");
+static_assert(std::is_trivially_copyable<CpuState>::value && std::is_standard_layout<CpuState>::value, "CpuState has to stay plain data");
@@ -0,0 +1,335 @@
+#include "Debugger.h"
+#include "VirtualMachine.h"
+#include "Disassembler.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+	bool ParseHex(const std::string& text, uint32_t& value)
+	{
+		if (text.empty())
+			return false;
+		char* pEnd = nullptr;
+		value = uint32_t(std::strtoul(text.c_str(), &pEnd, 16));
+		return *pEnd == '\0';
+	}
+
+	bool ParseComparison(const std::string& text, Debugger::Comparison& comparison)
+	{
+		const char* names[]{ "==", "!=", "<", "<=", ">", ">=" };
+		for (uint8_t comparisonIdx = 0; comparisonIdx < 6; ++comparisonIdx)
+		{
+			if (text == names[comparisonIdx])
+			{
+				comparison = Debugger::Comparison(comparisonIdx);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//v0-vf --> 0-15, i --> Debugger::m_RegisterI
+	bool ParseRegister(const std::string& text, uint8_t& reg)
+	{
+		uint32_t index = 0;
+		if (text == "i" || text == "I")
+			reg = Debugger::m_RegisterI;
+		else if (text.size() == 2 && (text[0] == 'v' || text[0] == 'V') && ParseHex(text.substr(1), index))
+			reg = uint8_t(index);
+		else
+			return false;
+		return true;
+	}
+
+	std::string ToHex(const uint32_t value, const int digits)
+	{
+		char text[16];
+		std::snprintf(text, sizeof(text), "0x%0*X", digits, value);
+		return text;
+	}
+
+	Disassembler::Instruction DecodeAt(const VirtualMachine& vm, const uint16_t address)
+	{
+		const uint8_t code[4]{ vm.ReadMemory(address), vm.ReadMemory(address + 1), vm.ReadMemory(address + 2), vm.ReadMemory(address + 3) };
+		return Disassembler::Decode(code, sizeof(code), address, vm.GetQuirkProfile());
+	}
+}
+
+Debugger::Debugger(std::istream& input, std::ostream& output)
+	:m_Input{ input }
+	, m_Output{ output }
+	, m_Breakpoints{}
+	, m_ReadWatches{}
+	, m_WriteWatches{}
+	, m_Conditions{}
+	, m_BreakpointCount{}
+	, m_WatchCount{}
+	, m_StepsLeft{}
+	, m_IsQuitRequested{}
+{
+}
+
+void Debugger::AddBreakpoint(const uint16_t address)
+{
+	m_Breakpoints.set(address);
+	m_Conditions.erase(address);
+	m_BreakpointCount = uint32_t(m_Breakpoints.count());
+}
+
+void Debugger::AddBreakpoint(const uint16_t address, const Condition& condition)
+{
+	//an unconditional breakpoint stays unconditional
+	if (m_Breakpoints[address] && m_Conditions.find(address) == m_Conditions.end())
+		return;
+	m_Breakpoints.set(address);
+	m_Conditions[address].push_back(condition);
+	m_BreakpointCount = uint32_t(m_Breakpoints.count());
+}
+
+void Debugger::RemoveBreakpoint(const uint16_t address)
+{
+	m_Breakpoints.reset(address);
+	m_Conditions.erase(address);
+	m_BreakpointCount = uint32_t(m_Breakpoints.count());
+}
+
+void Debugger::AddWatchpoint(const uint16_t start, const uint16_t end, const uint8_t flags)
+{
+	for (uint32_t address = start; address <= end; ++address)
+	{
+		if (flags & WatchRead)
+			m_ReadWatches.set(address);
+		if (flags & WatchWrite)
+			m_WriteWatches.set(address);
+	}
+	m_WatchCount = uint32_t((m_ReadWatches | m_WriteWatches).count());
+}
+
+void Debugger::RemoveWatchpoint(const uint16_t start, const uint16_t end)
+{
+	for (uint32_t address = start; address <= end; ++address)
+	{
+		m_ReadWatches.reset(address);
+		m_WriteWatches.reset(address);
+	}
+	m_WatchCount = uint32_t((m_ReadWatches | m_WriteWatches).count());
+}
+
+bool Debugger::OnInstruction(VirtualMachine& vm)
+{
+	//attached but nothing set: the same three compares every instruction, no lookups
+	if (m_StepsLeft == 0 && m_BreakpointCount == 0 && m_WatchCount == 0)
+		return true;
+
+	const uint16_t pc = vm.GetPC();
+	std::string reason;
+	if (m_StepsLeft != 0 && --m_StepsLeft == 0)
+		reason = "step";
+	if (m_Breakpoints[pc] && IsConditionMet(vm, pc))
+		reason = "breakpoint " + ToHex(pc, 3);
+	if (m_WatchCount != 0)
+	{
+		const DataAccess access = PredictAccess(vm);
+		const std::bitset<0x10000>& watches = access.flags & WatchWrite ? m_WriteWatches : m_ReadWatches;
+		for (uint32_t offset = 0; offset < access.length; ++offset)
+		{
+			const uint16_t address = uint16_t((access.start + offset) & vm.m_MemAddressMask);
+			if (!watches[address])
+				continue;
+			reason = std::string(access.flags & WatchWrite ? "write" : "read") + " of watched " + ToHex(address, 3) + " (" + ToHex(access.start, 3)
+				+ ", " + std::to_string(access.length) + " bytes)";
+			break;
+		}
+	}
+	if (!reason.empty())
+		Stop(vm, reason);
+	return !m_IsQuitRequested;
+}
+
+bool Debugger::IsConditionMet(const VirtualMachine& vm, const uint16_t pc) const
+{
+	const auto conditions = m_Conditions.find(pc);
+	if (conditions == m_Conditions.end())
+		return true;
+	for (const Condition& condition : conditions->second)
+	{
+		const uint16_t value = condition.reg == m_RegisterI ? vm.m_Cpu.vi : vm.m_Cpu.vx[condition.reg & 0xF];
+		bool isMet = false;
+		switch (condition.comparison)
+		{
+		case Comparison::Equal: isMet = value == condition.value; break;
+		case Comparison::NotEqual: isMet = value != condition.value; break;
+		case Comparison::Less: isMet = value < condition.value; break;
+		case Comparison::LessEqual: isMet = value <= condition.value; break;
+		case Comparison::Greater: isMet = value > condition.value; break;
+		case Comparison::GreaterEqual: isMet = value >= condition.value; break;
+		}
+		if (isMet)
+			return true;
+	}
+	return false;
+}
+
+Debugger::DataAccess Debugger::PredictAccess(const VirtualMachine& vm)
+{
+	const Disassembler::Instruction instruction = DecodeAt(vm, vm.GetPC());
+	const uint8_t x = (instruction.opcode >> 8) & 0xF;
+	const uint8_t y = (instruction.opcode >> 4) & 0xF;
+	const uint8_t n = instruction.opcode & 0xF;
+	switch (instruction.kind)
+	{
+	case Disassembler::InstructionKind::OpFX55:
+		return DataAccess{ vm.m_Cpu.vi, uint16_t(x + 1), WatchWrite };
+	case Disassembler::InstructionKind::OpFX65:
+		return DataAccess{ vm.m_Cpu.vi, uint16_t(x + 1), WatchRead };
+	case Disassembler::InstructionKind::OpFX33:
+		return DataAccess{ vm.m_Cpu.vi, 3, WatchWrite };
+	case Disassembler::InstructionKind::Op5XY2:
+		return DataAccess{ vm.m_Cpu.vi, uint16_t((x <= y ? y - x : x - y) + 1), WatchWrite };
+	case Disassembler::InstructionKind::Op5XY3:
+		return DataAccess{ vm.m_Cpu.vi, uint16_t((x <= y ? y - x : x - y) + 1), WatchRead };
+	case Disassembler::InstructionKind::OpF002:
+		return DataAccess{ vm.m_Cpu.vi, sizeof(vm.m_Cpu.audioPattern), WatchRead };
+	case Disassembler::InstructionKind::OpDXYN:
+	{
+		//one sprite per selected plane, back to back
+		const uint8_t planes = uint8_t(vm.m_Framebuffer.IsPlaneSelected(0) + vm.m_Framebuffer.IsPlaneSelected(1));
+		return DataAccess{ vm.m_Cpu.vi, uint16_t((n == 0 ? 32 : n) * planes), WatchRead };
+	}
+	default:
+		return DataAccess{ 0, 0, 0 };
+	}
+}
+
+void Debugger::Stop(VirtualMachine& vm, const std::string& reason)
+{
+	m_StepsLeft = 0;
+	m_Output << "stopped: " << reason << std::endl;
+	PrintRegisters(vm);
+	PrintDisassembly(vm, vm.GetPC(), 1);
+	std::string line;
+	while (!m_IsQuitRequested)
+	{
+		m_Output << "(c8db) " << std::flush;
+		if (!std::getline(m_Input, line))
+		{
+			//nobody left to type commands
+			m_IsQuitRequested = true;
+			break;
+		}
+		if (!RunCommand(vm, line))
+			break;
+	}
+}
+
+void Debugger::PrintRegisters(const VirtualMachine& vm) const
+{
+	char text[160];
+	int length = std::snprintf(text, sizeof(text), "PC=%03X I=%03X SP=%X DT=%02X ST=%02X ", vm.GetPC(), vm.m_Cpu.vi, vm.GetSP(), vm.m_Cpu.dt, vm.m_Cpu.st);
+	for (uint8_t reg = 0; reg < 16; ++reg)
+		length += std::snprintf(text + length, sizeof(text) - length, "V%X=%02X%s", reg, vm.m_Cpu.vx[reg], reg != 15 ? " " : "");
+	m_Output << text << std::endl;
+}
+
+void Debugger::PrintDisassembly(const VirtualMachine& vm, uint16_t address, const uint16_t count) const
+{
+	for (uint16_t line = 0; line < count; ++line)
+	{
+		const Disassembler::Instruction instruction = DecodeAt(vm, address);
+		m_Output << (address == vm.GetPC() ? "> " : "  ") << ToHex(address, 3) << "  " << ToHex(instruction.opcode, 4).substr(2)
+			<< (instruction.size == 4 ? ToHex(instruction.longOperand, 4).substr(2) : "    ") << "  " << Disassembler::Format(instruction)
+			<< (m_Breakpoints[address] ? "  [b]" : "") << std::endl;
+		address = uint16_t((address + (instruction.size ? instruction.size : 2)) & vm.m_MemAddressMask);
+	}
+}
+
+bool Debugger::RunCommand(VirtualMachine& vm, const std::string& line)
+{
+	std::istringstream stream(line);
+	std::vector<std::string> words;
+	for (std::string word; stream >> word;)
+		words.push_back(word);
+	if (words.empty())
+		return true;
+
+	const std::string& command = words[0];
+	uint32_t first = 0;
+	uint32_t second = 0;
+	const bool hasFirst = words.size() > 1 && ParseHex(words[1], first);
+	const bool hasSecond = words.size() > 2 && ParseHex(words[2], second);
+	if (command == "c")
+		return false;
+	if (command == "s")
+	{
+		m_StepsLeft = hasFirst && first != 0 ? first : 1;
+		return false;
+	}
+	if (command == "q")
+	{
+		m_IsQuitRequested = true;
+		return false;
+	}
+	if (command == "b" && hasFirst && words.size() == 2)
+		AddBreakpoint(uint16_t(first));
+	else if (command == "b" && hasFirst && words.size() == 5)
+	{
+		Condition condition{};
+		uint32_t value = 0;
+		if (!ParseRegister(words[2], condition.reg) || !ParseComparison(words[3], condition.comparison) || !ParseHex(words[4], value))
+		{
+			m_Output << "expected b <addr> <v0-vf|i> <== != < <= > >=> <value>" << std::endl;
+			return true;
+		}
+		condition.value = uint16_t(value);
+		AddBreakpoint(uint16_t(first), condition);
+	}
+	else if (command == "d" && hasFirst)
+		RemoveBreakpoint(uint16_t(first));
+	else if (command == "w" && words.size() > 2 && ParseHex(words[2], first))
+	{
+		const uint8_t flags = words[1] == "r" ? WatchRead : words[1] == "w" ? WatchWrite : words[1] == "rw" ? WatchRead | WatchWrite : 0;
+		const uint32_t end = words.size() > 3 && ParseHex(words[3], second) ? second : first;
+		if (flags == 0 || end < first || end > 0xFFFF)
+			m_Output << "expected w <r|w|rw> <addr> [end]" << std::endl;
+		else
+			AddWatchpoint(uint16_t(first), uint16_t(end), flags);
+	}
+	else if (command == "dw" && hasFirst)
+		RemoveWatchpoint(uint16_t(first), uint16_t(hasSecond && second >= first ? second : first));
+	else if (command == "r")
+		PrintRegisters(vm);
+	else if (command == "x" && hasFirst)
+	{
+		const uint32_t count = hasSecond ? second : 0x10;
+		for (uint32_t offset = 0; offset < count; offset += 16)
+		{
+			m_Output << ToHex((first + offset) & vm.m_MemAddressMask, 3) << " ";
+			for (uint32_t column = 0; column < 16 && offset + column < count; ++column)
+				m_Output << " " << ToHex(vm.ReadMemory(uint16_t(first + offset + column)), 2).substr(2);
+			m_Output << std::endl;
+		}
+	}
+	else if (command == "l")
+		PrintDisassembly(vm, uint16_t(hasFirst ? first : vm.GetPC()), uint16_t(hasSecond ? second : 8));
+	else if (command == "set" && words.size() == 3 && ParseHex(words[2], second))
+	{
+		uint8_t reg = 0;
+		if (words[1] == "pc")
+			vm.SetPC(uint16_t(second));
+		else if (words[1] == "dt")
+			vm.m_Cpu.dt = uint8_t(second);
+		else if (words[1] == "st")
+			vm.m_Cpu.st = uint8_t(second);
+		else if (ParseRegister(words[1], reg) && reg == m_RegisterI)
+			vm.m_Cpu.vi = uint16_t(second);
+		else if (ParseRegister(words[1], reg))
+			vm.m_Cpu.vx[reg & 0xF] = uint8_t(second);
+		else
+			m_Output << "unknown register " << words[1] << std::endl;
+	}
+	else
+		m_Output << "commands: c, s [count], b <addr> [reg op value], d <addr>, w <r|w|rw> <addr> [end], dw <addr> [end], r, x <addr> [count], l [addr] [count], set <reg> <value>, q" << std::endl;
+	return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+class VirtualMachine;
+//Interactive command line debugger, attached with VirtualMachine::SetDebugger (--debug).
+//Breakpoints and watchpoints are one bit per address, conditions are only looked up for addresses whose bit is set.
+//A vm without a debugger runs its plain instruction loop, the checks are compiled into a second copy of that loop.
+//Watchpoints stop before the instruction that is about to touch the watched bytes: the access is predicted from the
+//opcode and I (FX55, FX65, FX33, DXYN, 5XY2, 5XY3, F002), the instruction fetch itself never triggers one.
+//Commands are read from input when the vm stops, numbers are hex:
+//c                       continue
+//s [count]               execute count instructions, then stop
+//b <addr> [reg op val]   breakpoint, optionally only when e.g. "v3 == 4" or "i >= 300" (ops == != < <= > >=)
+//d <addr>                delete the breakpoint and its conditions
+//w <r|w|rw> <addr> [end] watch the bytes addr..end (inclusive)
+//dw <addr> [end]         delete watches
+//r                       registers, x <addr> [count] memory, l [addr] [count] disassembly
+//set <v0-vf|i|pc|dt|st> <val>, q quits the emulator
+class Debugger final
+{
+public:
+	Debugger(std::istream& input, std::ostream& output);
+	Debugger(const Debugger& old) = delete;
+	Debugger(Debugger&& old) = delete;
+	Debugger& operator=(const Debugger& other) = delete;
+	Debugger& operator=(const Debugger&& other) = delete;
+
+	enum class Comparison : uint8_t { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+	//m_RegisterI: compares I instead of a V register
+	const static uint8_t m_RegisterI{ 16 };
+	struct Condition
+	{
+		uint8_t reg;
+		Comparison comparison;
+		uint16_t value;
+	};
+	//a breakpoint without conditions always stops, with conditions it stops when any of them holds
+	void AddBreakpoint(const uint16_t address);
+	void AddBreakpoint(const uint16_t address, const Condition& condition);
+	void RemoveBreakpoint(const uint16_t address);
+
+	enum WatchFlags : uint8_t { WatchRead = 1, WatchWrite = 2 };
+	//end is inclusive
+	void AddWatchpoint(const uint16_t start, const uint16_t end, const uint8_t flags);
+	void RemoveWatchpoint(const uint16_t start, const uint16_t end);
+
+	//stop before the next instruction, e.g. right at the start of the ROM
+	void RequestBreak() { m_StepsLeft = 1; }
+	bool IsQuitRequested() const { return m_IsQuitRequested; }
+
+	//called by the vm before every instruction at its PC, false --> the instruction and the rest of the frame are not run.
+	//Commands may change PC, registers and memory while stopped
+	bool OnInstruction(VirtualMachine& vm);
+	//errors the vm cannot continue from (PC overflow), stops with reason
+	void OnFault(VirtualMachine& vm, const std::string& reason) { Stop(vm, reason); }
+	//runs one command line against vm, false when it resumes execution (c, s, q)
+	bool RunCommand(VirtualMachine& vm, const std::string& line);
+private:
+	//bytes the instruction at pc reads/writes (besides its own fetch), length 0 --> none
+	struct DataAccess
+	{
+		uint16_t start;
+		uint16_t length;
+		uint8_t flags;
+	};
+	static DataAccess PredictAccess(const VirtualMachine& vm);
+	bool IsConditionMet(const VirtualMachine& vm, const uint16_t pc) const;
+	void Stop(VirtualMachine& vm, const std::string& reason);
+	void PrintRegisters(const VirtualMachine& vm) const;
+	void PrintDisassembly(const VirtualMachine& vm, uint16_t address, const uint16_t count) const;
+
+	std::istream& m_Input;
+	std::ostream& m_Output;
+	//bit per address of the 64 KB XO-CHIP address space
+	std::bitset<0x10000> m_Breakpoints;
+	std::bitset<0x10000> m_ReadWatches;
+	std::bitset<0x10000> m_WriteWatches;
+	//only breakpoints that have conditions are in here
+	std::unordered_map<uint16_t, std::vector<Condition>> m_Conditions;
+	uint32_t m_BreakpointCount;
+	uint32_t m_WatchCount;
+	//0 --> run freely, otherwise stop once this reaches 0
+	uint32_t m_StepsLeft;
+	bool m_IsQuitRequested;
+};
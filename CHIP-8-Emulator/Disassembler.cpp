@@ -0,0 +1,518 @@
+#include "Disassembler.h"
+#include "RomArchive.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+namespace Disassembler
+{
+	namespace
+	{
+		struct OpcodePattern
+		{
+			uint16_t instruction;
+			uint16_t mask;
+			InstructionKind kind;
+			const char* pName;
+			bool isXoChipOnly;
+		};
+
+		//same patterns and order as the OpcodeManager table, the first match wins
+		const OpcodePattern g_Patterns[]{
+			{ 0x00E0, 0xFFFF, InstructionKind::Op00E0, "00E0", false },
+			{ 0x00EE, 0xFFFF, InstructionKind::Op00EE, "00EE", false },
+			{ 0x00C0, 0xFFF0, InstructionKind::Op00CN, "00CN", false },
+			{ 0x00FB, 0xFFFF, InstructionKind::Op00FB, "00FB", false },
+			{ 0x00FC, 0xFFFF, InstructionKind::Op00FC, "00FC", false },
+			{ 0x00FD, 0xFFFF, InstructionKind::Op00FD, "00FD", false },
+			{ 0x00FE, 0xFFFF, InstructionKind::Op00FE, "00FE", false },
+			{ 0x00FF, 0xFFFF, InstructionKind::Op00FF, "00FF", false },
+			{ 0x1000, 0xF000, InstructionKind::Op1NNN, "1NNN", false },
+			{ 0x2000, 0xF000, InstructionKind::Op2NNN, "2NNN", false },
+			{ 0x3000, 0xF000, InstructionKind::Op3XKK, "3XKK", false },
+			{ 0x4000, 0xF000, InstructionKind::Op4XKK, "4XKK", false },
+			{ 0x5000, 0xF00F, InstructionKind::Op5XY0, "5XY0", false },
+			{ 0x6000, 0xF000, InstructionKind::Op6XKK, "6XKK", false },
+			{ 0x7000, 0xF000, InstructionKind::Op7XKK, "7XKK", false },
+			{ 0x8000, 0xF00F, InstructionKind::Op8XY0, "8XY0", false },
+			{ 0x8001, 0xF00F, InstructionKind::Op8XY1, "8XY1", false },
+			{ 0x8002, 0xF00F, InstructionKind::Op8XY2, "8XY2", false },
+			{ 0x8003, 0xF00F, InstructionKind::Op8XY3, "8XY3", false },
+			{ 0x8004, 0xF00F, InstructionKind::Op8XY4, "8XY4", false },
+			{ 0x8005, 0xF00F, InstructionKind::Op8XY5, "8XY5", false },
+			{ 0x8006, 0xF00F, InstructionKind::Op8XY6, "8XY6", false },
+			{ 0x8007, 0xF00F, InstructionKind::Op8XY7, "8XY7", false },
+			{ 0x800E, 0xF00F, InstructionKind::Op8XYE, "8XYE", false },
+			{ 0x9000, 0xF00F, InstructionKind::Op9XY0, "9XY0", false },
+			{ 0xA000, 0xF000, InstructionKind::OpANNN, "ANNN", false },
+			{ 0xB000, 0xF000, InstructionKind::OpBNNN, "BNNN", false },
+			{ 0xC000, 0xF000, InstructionKind::OpCXKK, "CXKK", false },
+			{ 0xD000, 0xF000, InstructionKind::OpDXYN, "DXYN", false },
+			{ 0xE09E, 0xF0FF, InstructionKind::OpEX9E, "EX9E", false },
+			{ 0xE0A1, 0xF0FF, InstructionKind::OpEXA1, "EXA1", false },
+			{ 0xF007, 0xF0FF, InstructionKind::OpFX07, "FX07", false },
+			{ 0xF00A, 0xF0FF, InstructionKind::OpFX0A, "FX0A", false },
+			{ 0xF015, 0xF0FF, InstructionKind::OpFX15, "FX15", false },
+			{ 0xF018, 0xF0FF, InstructionKind::OpFX18, "FX18", false },
+			{ 0xF01E, 0xF0FF, InstructionKind::OpFX1E, "FX1E", false },
+			{ 0xF029, 0xF0FF, InstructionKind::OpFX29, "FX29", false },
+			{ 0xF030, 0xF0FF, InstructionKind::OpFX30, "FX30", false },
+			{ 0xF033, 0xF0FF, InstructionKind::OpFX33, "FX33", false },
+			{ 0xF055, 0xF0FF, InstructionKind::OpFX55, "FX55", false },
+			{ 0xF065, 0xF0FF, InstructionKind::OpFX65, "FX65", false },
+			{ 0xF075, 0xF0FF, InstructionKind::OpFX75, "FX75", false },
+			{ 0xF085, 0xF0FF, InstructionKind::OpFX85, "FX85", false },
+			{ 0x00D0, 0xFFF0, InstructionKind::Op00DN, "00DN", true },
+			{ 0x5002, 0xF00F, InstructionKind::Op5XY2, "5XY2", true },
+			{ 0x5003, 0xF00F, InstructionKind::Op5XY3, "5XY3", true },
+			{ 0xF000, 0xFFFF, InstructionKind::OpF000, "F000", true },
+			{ 0xF001, 0xF0FF, InstructionKind::OpFN01, "FN01", true },
+			{ 0xF002, 0xFFFF, InstructionKind::OpF002, "F002", true },
+			{ 0xF03A, 0xF0FF, InstructionKind::OpFX3A, "FX3A", true }
+		};
+		static_assert(sizeof(g_Patterns) / sizeof(g_Patterns[0]) == size_t(InstructionKind::Count) - 1, "every instruction kind needs a pattern");
+
+		//blocks end after these, the next instruction (if any) starts a new one
+		bool IsBlockEnd(const InstructionKind kind)
+		{
+			switch (kind)
+			{
+			case InstructionKind::Invalid:
+			case InstructionKind::Op00EE:
+			case InstructionKind::Op00FD:
+			case InstructionKind::Op1NNN:
+			case InstructionKind::Op2NNN:
+			case InstructionKind::OpBNNN:
+				return true;
+			default:
+				return IsSkip(kind);
+			}
+		}
+
+		template<typename T>
+		void SortUnique(std::vector<T>& values)
+		{
+			std::sort(values.begin(), values.end());
+			values.erase(std::unique(values.begin(), values.end()), values.end());
+		}
+
+		void WriteAddressList(std::ostream& stream, const std::vector<uint16_t>& addresses)
+		{
+			stream << '[';
+			for (size_t idx = 0; idx < addresses.size(); ++idx)
+				stream << (idx ? "," : "") << addresses[idx];
+			stream << ']';
+		}
+
+		void WriteString(std::ostream& stream, const std::string& text)
+		{
+			stream << '"';
+			for (const char character : text)
+			{
+				if (character == '"' || character == '\\')
+					stream << '\\' << character;
+				else if (uint8_t(character) < 0x20)
+				{
+					char escaped[8];
+					std::snprintf(escaped, sizeof(escaped), "\\u%04X", uint8_t(character));
+					stream << escaped;
+				}
+				else
+					stream << character;
+			}
+			stream << '"';
+		}
+	}
+
+	Instruction Decode(const uint8_t* pCode, const size_t available, const uint16_t address, const InstructionLib::QuirkProfile profile)
+	{
+		Instruction instruction{ address, 0, 0, InstructionKind::Invalid, 0 };
+		if (available < 2)
+			return instruction;
+		instruction.opcode = uint16_t(pCode[0] << 8 | pCode[1]);
+		instruction.size = 2;
+		const bool isXoChip = profile == InstructionLib::QuirkProfile::XoChip;
+		for (const OpcodePattern& pattern : g_Patterns)
+		{
+			if ((pattern.isXoChipOnly && !isXoChip) || pattern.instruction != (instruction.opcode & pattern.mask))
+				continue;
+			instruction.kind = pattern.kind;
+			break;
+		}
+		if (instruction.kind == InstructionKind::OpF000)
+		{
+			if (available < 4)
+			{
+				instruction.kind = InstructionKind::Invalid;
+				return instruction;
+			}
+			instruction.longOperand = uint16_t(pCode[2] << 8 | pCode[3]);
+			instruction.size = 4;
+		}
+		return instruction;
+	}
+
+	const char* GetKindName(const InstructionKind kind)
+	{
+		for (const OpcodePattern& pattern : g_Patterns)
+		{
+			if (pattern.kind == kind)
+				return pattern.pName;
+		}
+		return "invalid";
+	}
+
+	bool IsSkip(const InstructionKind kind)
+	{
+		switch (kind)
+		{
+		case InstructionKind::Op3XKK:
+		case InstructionKind::Op4XKK:
+		case InstructionKind::Op5XY0:
+		case InstructionKind::Op9XY0:
+		case InstructionKind::OpEX9E:
+		case InstructionKind::OpEXA1:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	std::string Format(const Instruction& instruction)
+	{
+		const uint16_t opcode = instruction.opcode;
+		const unsigned x = (opcode >> 8) & 0xF;
+		const unsigned y = (opcode >> 4) & 0xF;
+		const unsigned n = opcode & 0xF;
+		const unsigned kk = opcode & 0xFF;
+		const unsigned nnn = opcode & 0xFFF;
+		char text[32];
+		switch (instruction.kind)
+		{
+		case InstructionKind::Op00E0: std::snprintf(text, sizeof(text), "CLS"); break;
+		case InstructionKind::Op00EE: std::snprintf(text, sizeof(text), "RET"); break;
+		case InstructionKind::Op00CN: std::snprintf(text, sizeof(text), "SCD %u", n); break;
+		case InstructionKind::Op00DN: std::snprintf(text, sizeof(text), "SCU %u", n); break;
+		case InstructionKind::Op00FB: std::snprintf(text, sizeof(text), "SCR"); break;
+		case InstructionKind::Op00FC: std::snprintf(text, sizeof(text), "SCL"); break;
+		case InstructionKind::Op00FD: std::snprintf(text, sizeof(text), "EXIT"); break;
+		case InstructionKind::Op00FE: std::snprintf(text, sizeof(text), "LOW"); break;
+		case InstructionKind::Op00FF: std::snprintf(text, sizeof(text), "HIGH"); break;
+		case InstructionKind::Op1NNN: std::snprintf(text, sizeof(text), "JP 0x%03X", nnn); break;
+		case InstructionKind::Op2NNN: std::snprintf(text, sizeof(text), "CALL 0x%03X", nnn); break;
+		case InstructionKind::Op3XKK: std::snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, kk); break;
+		case InstructionKind::Op4XKK: std::snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, kk); break;
+		case InstructionKind::Op5XY0: std::snprintf(text, sizeof(text), "SE V%X, V%X", x, y); break;
+		case InstructionKind::Op5XY2: std::snprintf(text, sizeof(text), "SAVE V%X - V%X", x, y); break;
+		case InstructionKind::Op5XY3: std::snprintf(text, sizeof(text), "LOAD V%X - V%X", x, y); break;
+		case InstructionKind::Op6XKK: std::snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, kk); break;
+		case InstructionKind::Op7XKK: std::snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, kk); break;
+		case InstructionKind::Op8XY0: std::snprintf(text, sizeof(text), "LD V%X, V%X", x, y); break;
+		case InstructionKind::Op8XY1: std::snprintf(text, sizeof(text), "OR V%X, V%X", x, y); break;
+		case InstructionKind::Op8XY2: std::snprintf(text, sizeof(text), "AND V%X, V%X", x, y); break;
+		case InstructionKind::Op8XY3: std::snprintf(text, sizeof(text), "XOR V%X, V%X", x, y); break;
+		case InstructionKind::Op8XY4: std::snprintf(text, sizeof(text), "ADD V%X, V%X", x, y); break;
+		case InstructionKind::Op8XY5: std::snprintf(text, sizeof(text), "SUB V%X, V%X", x, y); break;
+		case InstructionKind::Op8XY6: std::snprintf(text, sizeof(text), "SHR V%X, V%X", x, y); break;
+		case InstructionKind::Op8XY7: std::snprintf(text, sizeof(text), "SUBN V%X, V%X", x, y); break;
+		case InstructionKind::Op8XYE: std::snprintf(text, sizeof(text), "SHL V%X, V%X", x, y); break;
+		case InstructionKind::Op9XY0: std::snprintf(text, sizeof(text), "SNE V%X, V%X", x, y); break;
+		case InstructionKind::OpANNN: std::snprintf(text, sizeof(text), "LD I, 0x%03X", nnn); break;
+		case InstructionKind::OpBNNN: std::snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn); break;
+		case InstructionKind::OpCXKK: std::snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, kk); break;
+		case InstructionKind::OpDXYN: std::snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n); break;
+		case InstructionKind::OpEX9E: std::snprintf(text, sizeof(text), "SKP V%X", x); break;
+		case InstructionKind::OpEXA1: std::snprintf(text, sizeof(text), "SKNP V%X", x); break;
+		case InstructionKind::OpFX07: std::snprintf(text, sizeof(text), "LD V%X, DT", x); break;
+		case InstructionKind::OpFX0A: std::snprintf(text, sizeof(text), "LD V%X, K", x); break;
+		case InstructionKind::OpFX15: std::snprintf(text, sizeof(text), "LD DT, V%X", x); break;
+		case InstructionKind::OpFX18: std::snprintf(text, sizeof(text), "LD ST, V%X", x); break;
+		case InstructionKind::OpFX1E: std::snprintf(text, sizeof(text), "ADD I, V%X", x); break;
+		case InstructionKind::OpFX29: std::snprintf(text, sizeof(text), "LD F, V%X", x); break;
+		case InstructionKind::OpFX30: std::snprintf(text, sizeof(text), "LD HF, V%X", x); break;
+		case InstructionKind::OpFX33: std::snprintf(text, sizeof(text), "LD B, V%X", x); break;
+		case InstructionKind::OpFX55: std::snprintf(text, sizeof(text), "LD [I], V%X", x); break;
+		case InstructionKind::OpFX65: std::snprintf(text, sizeof(text), "LD V%X, [I]", x); break;
+		case InstructionKind::OpFX75: std::snprintf(text, sizeof(text), "LD R, V%X", x); break;
+		case InstructionKind::OpFX85: std::snprintf(text, sizeof(text), "LD V%X, R", x); break;
+		case InstructionKind::OpF000: std::snprintf(text, sizeof(text), "LD I, 0x%04X", unsigned(instruction.longOperand)); break;
+		case InstructionKind::OpFN01: std::snprintf(text, sizeof(text), "PLANE %u", x); break;
+		case InstructionKind::OpF002: std::snprintf(text, sizeof(text), "AUDIO"); break;
+		case InstructionKind::OpFX3A: std::snprintf(text, sizeof(text), "PITCH V%X", x); break;
+		default: std::snprintf(text, sizeof(text), "DW 0x%04X", unsigned(opcode)); break;
+		}
+		return text;
+	}
+
+	ControlFlowGraph Analyze(const std::string& name, const uint8_t* pRom, const size_t size, const InstructionLib::QuirkProfile profile)
+	{
+		ControlFlowGraph graph{};
+		graph.name = name;
+		graph.romHash = RomArchive::HashContent(pRom, size);
+		graph.profile = profile;
+		graph.romStart = 0x200;
+		//same truncation as VirtualMachine::LoadROM
+		const uint32_t capacity = InstructionLib::GetMemorySize(profile) - graph.romStart;
+		const uint32_t romSize = uint32_t(size < capacity ? size : capacity);
+		graph.romEnd = uint16_t(graph.romStart + romSize);
+		const uint32_t romStart = graph.romStart;
+		const uint32_t romEnd = romStart + romSize;
+
+		//0: not reached, 1: first byte of an instruction, 2: later byte of one
+		std::vector<uint8_t> byteStates(romSize, 0);
+		std::vector<uint8_t> isLeader(romSize, 0);
+		std::vector<uint16_t> worklist;
+		std::vector<uint16_t> callTargets;
+		const auto isInRom = [romStart, romEnd](const uint32_t address) { return address >= romStart && address < romEnd; };
+		const auto addTarget = [&](const uint32_t address)
+		{
+			if (!isInRom(address))
+			{
+				graph.externalTargets.push_back(uint16_t(address));
+				return;
+			}
+			isLeader[address - romStart] = 1;
+			worklist.push_back(uint16_t(address));
+		};
+		const auto decodeAt = [&](const uint32_t address)
+		{
+			return Decode(pRom + (address - romStart), romEnd - address, uint16_t(address), profile);
+		};
+
+		addTarget(romStart);
+		callTargets.push_back(uint16_t(romStart));
+		while (!worklist.empty())
+		{
+			uint32_t address = worklist.back();
+			worklist.pop_back();
+			//walks straight line code until something ends the path, branches go on the worklist
+			bool isPathEnd = false;
+			while (!isPathEnd && isInRom(address) && byteStates[address - romStart] == 0)
+			{
+				const Instruction instruction = decodeAt(address);
+				if (instruction.size == 0)
+					break;
+				//the last bytes belong to another instruction already: overlapping code, keep the first decode
+				bool isOverlapping = false;
+				for (uint32_t byteIdx = 1; byteIdx < instruction.size; ++byteIdx)
+					isOverlapping = isOverlapping || !isInRom(address + byteIdx) || byteStates[address + byteIdx - romStart] != 0;
+				if (isOverlapping)
+					break;
+				byteStates[address - romStart] = 1;
+				for (uint32_t byteIdx = 1; byteIdx < instruction.size; ++byteIdx)
+					byteStates[address + byteIdx - romStart] = 2;
+				graph.instructions.push_back(instruction);
+
+				const uint32_t next = address + instruction.size;
+				const uint16_t nnn = instruction.opcode & 0x0FFF;
+				switch (instruction.kind)
+				{
+				case InstructionKind::Invalid:
+					//the core runs it as a no-op, on a walk it almost always means data was reached
+					graph.invalidInstructions.push_back(uint16_t(address));
+					isPathEnd = true;
+					break;
+				case InstructionKind::Op1NNN:
+					addTarget(nnn);
+					isPathEnd = true;
+					break;
+				case InstructionKind::Op2NNN:
+					if (isInRom(nnn))
+						callTargets.push_back(nnn);
+					addTarget(nnn);
+					if (isInRom(next))
+						isLeader[next - romStart] = 1;
+					break;
+				case InstructionKind::Op00EE:
+				case InstructionKind::Op00FD:
+					isPathEnd = true;
+					break;
+				case InstructionKind::OpBNNN:
+					graph.computedJumps.push_back(uint16_t(address));
+					isPathEnd = true;
+					break;
+				case InstructionKind::OpANNN:
+					graph.dataReferences.push_back(nnn);
+					break;
+				case InstructionKind::OpF000:
+					graph.dataReferences.push_back(instruction.longOperand);
+					break;
+				default:
+					if (IsSkip(instruction.kind) && isInRom(next))
+					{
+						//skips jump over a whole instruction, F000 NNNN included
+						const Instruction skipped = decodeAt(next);
+						isLeader[next - romStart] = 1;
+						addTarget(next + (skipped.size ? skipped.size : 2));
+					}
+					break;
+				}
+				address = next;
+			}
+		}
+
+		std::sort(graph.instructions.begin(), graph.instructions.end(), [](const Instruction& a, const Instruction& b) { return a.address < b.address; });
+		const auto isDecoded = [&](const uint32_t address) { return isInRom(address) && byteStates[address - romStart] == 1; };
+
+		//basic blocks: split at leaders, after block ending instructions and at gaps
+		std::vector<int32_t> blockAt(romSize, -1);
+		for (size_t instructionIdx = 0; instructionIdx < graph.instructions.size(); ++instructionIdx)
+		{
+			const Instruction& instruction = graph.instructions[instructionIdx];
+			const bool isNewBlock = instructionIdx == 0 || isLeader[instruction.address - romStart]
+				|| graph.blocks.back().end != instruction.address || IsBlockEnd(graph.instructions[instructionIdx - 1].kind);
+			if (isNewBlock)
+			{
+				blockAt[instruction.address - romStart] = int32_t(graph.blocks.size());
+				graph.blocks.push_back(BasicBlock{ instruction.address, instruction.address, {} });
+			}
+			graph.blocks.back().end = uint16_t(instruction.address + instruction.size);
+		}
+		//successors from the last instruction of every block
+		std::vector<size_t> blockLast(graph.blocks.size());
+		size_t instructionIdx = 0;
+		for (size_t blockIdx = 0; blockIdx < graph.blocks.size(); ++blockIdx)
+		{
+			BasicBlock& block = graph.blocks[blockIdx];
+			while (instructionIdx + 1 < graph.instructions.size() && graph.instructions[instructionIdx + 1].address < block.end)
+				++instructionIdx;
+			blockLast[blockIdx] = instructionIdx;
+			const Instruction& last = graph.instructions[instructionIdx];
+			const uint32_t next = uint32_t(last.address) + last.size;
+			const uint16_t nnn = last.opcode & 0x0FFF;
+			if (last.kind == InstructionKind::Op1NNN)
+			{
+				if (isDecoded(nnn))
+					block.successors.push_back(nnn);
+			}
+			else if (IsSkip(last.kind))
+			{
+				if (isDecoded(next))
+				{
+					block.successors.push_back(uint16_t(next));
+					const uint32_t skipTarget = next + decodeAt(next).size;
+					if (isDecoded(skipTarget))
+						block.successors.push_back(uint16_t(skipTarget));
+				}
+			}
+			else if (last.kind != InstructionKind::Invalid && last.kind != InstructionKind::Op00EE
+				&& last.kind != InstructionKind::Op00FD && last.kind != InstructionKind::OpBNNN && isDecoded(next))
+				block.successors.push_back(uint16_t(next));
+			++instructionIdx;
+		}
+
+		//functions: blocks reachable from each call target without entering callees
+		SortUnique(callTargets);
+		for (const uint16_t entry : callTargets)
+		{
+			if (!isDecoded(entry) || blockAt[entry - romStart] < 0)
+				continue;
+			Function function{ entry, {}, {} };
+			std::vector<uint8_t> isVisited(graph.blocks.size(), 0);
+			std::vector<int32_t> stack{ blockAt[entry - romStart] };
+			while (!stack.empty())
+			{
+				const int32_t blockIdx = stack.back();
+				stack.pop_back();
+				if (blockIdx < 0 || isVisited[blockIdx])
+					continue;
+				isVisited[blockIdx] = 1;
+				const BasicBlock& block = graph.blocks[blockIdx];
+				function.blocks.push_back(block.start);
+				for (const uint16_t successor : block.successors)
+					stack.push_back(blockAt[successor - romStart]);
+				const Instruction& last = graph.instructions[blockLast[blockIdx]];
+				if (last.kind == InstructionKind::Op2NNN && isDecoded(last.opcode & 0x0FFF))
+					function.callees.push_back(last.opcode & 0x0FFF);
+			}
+			SortUnique(function.blocks);
+			SortUnique(function.callees);
+			graph.functions.push_back(std::move(function));
+		}
+
+		//data: every ROM byte no walk reached
+		for (uint32_t address = romStart; address < romEnd;)
+		{
+			if (byteStates[address - romStart] != 0)
+			{
+				++address;
+				continue;
+			}
+			const uint32_t start = address;
+			while (address < romEnd && byteStates[address - romStart] == 0)
+				++address;
+			graph.dataRanges.push_back(AddressRange{ uint16_t(start), uint16_t(address) });
+		}
+		SortUnique(graph.computedJumps);
+		SortUnique(graph.dataReferences);
+		SortUnique(graph.externalTargets);
+		SortUnique(graph.invalidInstructions);
+		return graph;
+	}
+
+	std::vector<ControlFlowGraph> AnalyzeAll(const std::vector<RomImage>& roms, const uint32_t threadCount)
+	{
+		std::vector<ControlFlowGraph> graphs(roms.size());
+		std::atomic<size_t> nextRom{ 0 };
+		//every thread pulls the next ROM and writes only its own slot
+		const auto work = [&]()
+		{
+			for (size_t romIdx = nextRom.fetch_add(1); romIdx < roms.size(); romIdx = nextRom.fetch_add(1))
+				graphs[romIdx] = Analyze(roms[romIdx].name, roms[romIdx].data.data(), roms[romIdx].data.size(), roms[romIdx].profile);
+		};
+		std::vector<std::thread> threads;
+		for (uint32_t threadIdx = 1; threadIdx < threadCount && threadIdx < roms.size(); ++threadIdx)
+			threads.emplace_back(work);
+		work();
+		for (std::thread& thread : threads)
+			thread.join();
+		return graphs;
+	}
+
+	void WriteJson(std::ostream& stream, const ControlFlowGraph& graph)
+	{
+		char hash[17];
+		std::snprintf(hash, sizeof(hash), "%016llX", static_cast<unsigned long long>(graph.romHash));
+		stream << "{\"name\":";
+		WriteString(stream, graph.name);
+		stream << ",\"hash\":\"" << hash << "\",\"profile\":\"" << InstructionLib::GetQuirkProfileName(graph.profile)
+			<< "\",\"romStart\":" << graph.romStart << ",\"romEnd\":" << graph.romEnd << ",\n\"instructions\":[";
+		for (size_t idx = 0; idx < graph.instructions.size(); ++idx)
+		{
+			const Instruction& instruction = graph.instructions[idx];
+			stream << (idx ? ",\n" : "\n") << "{\"address\":" << instruction.address << ",\"opcode\":" << instruction.opcode
+				<< ",\"size\":" << unsigned(instruction.size) << ",\"kind\":\"" << GetKindName(instruction.kind) << "\",\"text\":\"" << Format(instruction) << "\"}";
+		}
+		stream << "],\n\"blocks\":[";
+		for (size_t idx = 0; idx < graph.blocks.size(); ++idx)
+		{
+			const BasicBlock& block = graph.blocks[idx];
+			stream << (idx ? ",\n" : "\n") << "{\"start\":" << block.start << ",\"end\":" << block.end << ",\"successors\":";
+			WriteAddressList(stream, block.successors);
+			stream << '}';
+		}
+		stream << "],\n\"functions\":[";
+		for (size_t idx = 0; idx < graph.functions.size(); ++idx)
+		{
+			const Function& function = graph.functions[idx];
+			stream << (idx ? ",\n" : "\n") << "{\"entry\":" << function.entry << ",\"blocks\":";
+			WriteAddressList(stream, function.blocks);
+			stream << ",\"callees\":";
+			WriteAddressList(stream, function.callees);
+			stream << '}';
+		}
+		stream << "],\n\"dataRanges\":[";
+		for (size_t idx = 0; idx < graph.dataRanges.size(); ++idx)
+			stream << (idx ? "," : "") << '[' << graph.dataRanges[idx].start << ',' << graph.dataRanges[idx].end << ']';
+		stream << "],\n\"computedJumps\":";
+		WriteAddressList(stream, graph.computedJumps);
+		stream << ",\"dataReferences\":";
+		WriteAddressList(stream, graph.dataReferences);
+		stream << ",\"externalTargets\":";
+		WriteAddressList(stream, graph.externalTargets);
+		stream << ",\"invalidInstructions\":";
+		WriteAddressList(stream, graph.invalidInstructions);
+		stream << '}';
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "Quirks.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+//Static decoding and control flow recovery of ROM images, run with --disasm.
+//Decodes the same opcode table as InstructionLib::OpcodeManager (per quirk profile), follows jumps, calls and skips
+//from 0x200 and splits what it reaches into basic blocks and functions. Everything the walk never reaches is data.
+//BNNN targets depend on a register and are only reported, self modifying code is not seen.
+namespace Disassembler
+{
+	//one per OpcodeManager handler, named like them
+	enum class InstructionKind : uint8_t
+	{
+		Invalid,
+		Op00E0, Op00EE, Op00CN, Op00DN, Op00FB, Op00FC, Op00FD, Op00FE, Op00FF,
+		Op1NNN, Op2NNN, Op3XKK, Op4XKK, Op5XY0, Op5XY2, Op5XY3, Op6XKK, Op7XKK,
+		Op8XY0, Op8XY1, Op8XY2, Op8XY3, Op8XY4, Op8XY5, Op8XY6, Op8XY7, Op8XYE,
+		Op9XY0, OpANNN, OpBNNN, OpCXKK, OpDXYN, OpEX9E, OpEXA1,
+		OpFX07, OpFX0A, OpFX15, OpFX18, OpFX1E, OpFX29, OpFX30, OpFX33, OpFX55, OpFX65, OpFX75, OpFX85,
+		OpF000, OpFN01, OpF002, OpFX3A,
+		Count
+	};
+
+	struct Instruction
+	{
+		uint16_t address;
+		uint16_t opcode;
+		//second word of F000 NNNN
+		uint16_t longOperand;
+		InstructionKind kind;
+		//2, 4 for F000 NNNN
+		uint8_t size;
+	};
+
+	//pCode points at the instruction, available = bytes readable from there
+	Instruction Decode(const uint8_t* pCode, const size_t available, const uint16_t address, const InstructionLib::QuirkProfile profile);
+	//"0x0200" style operands, Cowgod's mnemonics (plus SUPER-CHIP/XO-CHIP extensions)
+	std::string Format(const Instruction& instruction);
+	const char* GetKindName(const InstructionKind kind);
+	//conditional skips: execution continues after the next instruction or the one after that
+	bool IsSkip(const InstructionKind kind);
+
+	struct BasicBlock
+	{
+		uint16_t start;
+		//first address after the block
+		uint16_t end;
+		//blocks control can continue in, calls continue at the return address (callees are in Function)
+		std::vector<uint16_t> successors;
+	};
+
+	struct Function
+	{
+		uint16_t entry;
+		//entries of the blocks reachable from entry without following calls
+		std::vector<uint16_t> blocks;
+		std::vector<uint16_t> callees;
+	};
+
+	struct AddressRange
+	{
+		uint16_t start;
+		uint16_t end;
+	};
+
+	struct ControlFlowGraph
+	{
+		std::string name;
+		uint64_t romHash;
+		InstructionLib::QuirkProfile profile;
+		uint16_t romStart;
+		uint16_t romEnd;
+		//in address order
+		std::vector<Instruction> instructions;
+		std::vector<BasicBlock> blocks;
+		std::vector<Function> functions;
+		//ROM bytes no path reaches
+		std::vector<AddressRange> dataRanges;
+		//BNNN sites, their targets are not followed
+		std::vector<uint16_t> computedJumps;
+		//ANNN / F000 NNNN addresses, mostly sprites and tables
+		std::vector<uint16_t> dataReferences;
+		//targets outside the ROM (font, uninitialized memory) and undecodable opcodes on a reached path
+		std::vector<uint16_t> externalTargets;
+		std::vector<uint16_t> invalidInstructions;
+	};
+
+	ControlFlowGraph Analyze(const std::string& name, const uint8_t* pRom, const size_t size, const InstructionLib::QuirkProfile profile);
+
+	struct RomImage
+	{
+		std::string name;
+		std::vector<uint8_t> data;
+		InstructionLib::QuirkProfile profile;
+	};
+	//one ROM per task spread over threadCount threads, results in input order
+	std::vector<ControlFlowGraph> AnalyzeAll(const std::vector<RomImage>& roms, const uint32_t threadCount);
+
+	//JSON object per graph, the format predecoding and translation passes read
+	void WriteJson(std::ostream& stream, const ControlFlowGraph& graph);
+}
@@ -0,0 +1,92 @@
+#include "FrameHashLog.h"
+#include "VirtualMachine.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+FrameHashLog::FrameHashLog(const std::string& path, const Mode mode)
+	:m_Path{ path }
+	, m_Mode{ mode }
+	, m_IsValid{ true }
+	, m_FrameCounter{}
+	, m_LastHash{}
+	, m_RunIdx{}
+	, m_FrameInRun{}
+	, m_FirstMismatch{ UINT64_MAX }
+{
+	if (m_Mode == Mode::Record)
+		return;
+
+	std::ifstream file(m_Path);
+	if (!file.is_open())
+	{
+		std::cerr << "Cant open golden hash log " << m_Path << std::endl;
+		m_IsValid = false;
+		return;
+	}
+
+	HashRun run{};
+	while (file >> std::hex >> run.hash >> std::dec >> run.frameCount)
+		m_Runs.push_back(run);
+}
+
+void FrameHashLog::PublishFrame(const VirtualMachine& vm)
+{
+	//unchanged frames keep the previous hash, no need to rehash the pixels
+	if (m_FrameCounter == 0 || vm.IsDisplayUpdated())
+		m_LastHash = vm.GetFrameHash();
+	const uint64_t frame = m_FrameCounter++;
+
+	if (m_Mode == Mode::Record)
+	{
+		if (!m_Runs.empty() && m_Runs.back().hash == m_LastHash)
+			++m_Runs.back().frameCount;
+		else
+			m_Runs.push_back(HashRun{ m_LastHash, 1 });
+		return;
+	}
+
+	if (m_FirstMismatch != UINT64_MAX)
+		return;
+	if (m_RunIdx >= m_Runs.size() || m_Runs[m_RunIdx].hash != m_LastHash)
+	{
+		m_FirstMismatch = frame;
+		return;
+	}
+	if (++m_FrameInRun == m_Runs[m_RunIdx].frameCount)
+	{
+		++m_RunIdx;
+		m_FrameInRun = 0;
+	}
+}
+
+bool FrameHashLog::Finish()
+{
+	if (!m_IsValid)
+		return false;
+
+	if (m_Mode == Mode::Record)
+	{
+		std::ofstream file(m_Path);
+		if (!file.is_open())
+		{
+			std::cerr << "Cant write hash log " << m_Path << std::endl;
+			return false;
+		}
+		for (const HashRun& run : m_Runs)
+			file << std::hex << std::setw(16) << std::setfill('0') << run.hash << ' ' << std::dec << run.frameCount << '\n';
+		return true;
+	}
+
+	if (m_FirstMismatch != UINT64_MAX)
+	{
+		std::cerr << "Frame " << m_FirstMismatch << " differs from " << m_Path << std::endl;
+		return false;
+	}
+	if (m_RunIdx != m_Runs.size())
+	{
+		std::cerr << "Golden log " << m_Path << " has more frames than the " << m_FrameCounter << " that were played" << std::endl;
+		return false;
+	}
+	return true;
+}
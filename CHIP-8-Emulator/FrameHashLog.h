@@ -0,0 +1,42 @@
+#pragma once
+#include "FrameSink.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+//Per frame framebuffer hashes for golden output regression runs.
+//File format: one "<hash as 16 hex digits> <frame count>" line per run of identical frames.
+class FrameHashLog final : public FrameSink
+{
+public:
+	enum class Mode { Record, Verify };
+
+	FrameHashLog(const std::string& path, const Mode mode);
+	FrameHashLog(const FrameHashLog& old) = delete;
+	FrameHashLog(FrameHashLog&& old) = delete;
+	FrameHashLog& operator=(const FrameHashLog& other) = delete;
+	FrameHashLog& operator=(const FrameHashLog&& other) = delete;
+
+	void PublishFrame(const VirtualMachine& vm) override;
+	//Record: writes the log. Verify: checks the played frames against the golden log.
+	//Returns false on io error or mismatch, details go to std::cerr
+	bool Finish();
+private:
+	struct HashRun
+	{
+		uint64_t hash;
+		uint32_t frameCount;
+	};
+
+	const std::string m_Path;
+	const Mode m_Mode;
+	std::vector<HashRun> m_Runs;
+	bool m_IsValid;
+
+	uint64_t m_FrameCounter;
+	uint64_t m_LastHash;
+	//Verify: position in the golden runs
+	size_t m_RunIdx;
+	uint32_t m_FrameInRun;
+	//Verify: first frame that differs, UINT64_MAX while everything matches
+	uint64_t m_FirstMismatch;
+};
@@ -0,0 +1,114 @@
+#include "FramePacer.h"
+#include <cmath>
+#include <thread>
+#if defined(__linux__)
+#include <time.h>
+#include <cerrno>
+#endif
+
+const std::chrono::nanoseconds FramePacer::m_SpinTime{ std::chrono::microseconds(300) };
+
+FramePacer::FramePacer(const double framesPerSecond)
+	:m_FramesPerSecond{ framesPerSecond }
+	, m_ScheduleStart{ Clock::now() }
+	, m_ScheduleFrame{}
+	, m_LastFrameStart{ m_ScheduleStart }
+	, m_LastFrameTime{ std::chrono::nanoseconds(int64_t(1e9 / framesPerSecond)) }
+	, m_FrameCount{}
+	, m_LateFrames{}
+	, m_Resyncs{}
+	, m_SquaredJitterSum{}
+	, m_MaxJitter{}
+	, m_FirstFrameStart{ m_ScheduleStart }
+{
+}
+
+FramePacer::Clock::time_point FramePacer::GetDeadline(const uint64_t frame) const
+{
+	//from the frame index every time, adding a rounded period per frame would drift
+	return m_ScheduleStart + std::chrono::nanoseconds(int64_t(double(frame) * 1e9 / m_FramesPerSecond));
+}
+
+void FramePacer::SleepUntil(const Clock::time_point deadline)
+{
+#if defined(__linux__)
+	//steady_clock is CLOCK_MONOTONIC on linux, an absolute sleep is immune to the time spent getting here
+	const int64_t deadlineNs = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+	timespec wakeTime{};
+	wakeTime.tv_sec = time_t(deadlineNs / 1000000000);
+	wakeTime.tv_nsec = long(deadlineNs % 1000000000);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTime, nullptr) == EINTR)
+	{
+	}
+#else
+	std::this_thread::sleep_until(deadline);
+#endif
+}
+
+void FramePacer::WaitForNextFrame()
+{
+	++m_ScheduleFrame;
+	Clock::time_point deadline = GetDeadline(m_ScheduleFrame);
+	const Clock::time_point now = Clock::now();
+	if (now < deadline)
+	{
+		if (deadline - now > m_SpinTime)
+			SleepUntil(deadline - m_SpinTime);
+		while (Clock::now() < deadline)
+		{
+		}
+	}
+	else if (now - deadline > (GetDeadline(m_MaxCatchUpFrames) - m_ScheduleStart))
+	{
+		//too far behind to catch up unnoticed, start a new schedule at this frame
+		m_ScheduleStart = now;
+		m_ScheduleFrame = 0;
+		deadline = now;
+		++m_Resyncs;
+	}
+	else
+	{
+		//late but recoverable, the next frames start right away until the schedule is met again
+		++m_LateFrames;
+	}
+
+	const Clock::time_point frameStart = Clock::now();
+	const std::chrono::nanoseconds jitter = frameStart > deadline ? frameStart - deadline : deadline - frameStart;
+	m_SquaredJitterSum += std::chrono::duration<double, std::milli>(jitter).count() * std::chrono::duration<double, std::milli>(jitter).count();
+	if (jitter > m_MaxJitter)
+		m_MaxJitter = jitter;
+	m_LastFrameTime = frameStart - m_LastFrameStart;
+	m_LastFrameStart = frameStart;
+	if (m_FrameCount == 0)
+		m_FirstFrameStart = frameStart;
+	++m_FrameCount;
+}
+
+float FramePacer::GetLastFrameSeconds() const
+{
+	return std::chrono::duration<float>(m_LastFrameTime).count();
+}
+
+double FramePacer::GetMeasuredFramesPerSecond() const
+{
+	if (m_FrameCount < 2)
+		return 0.0;
+	return double(m_FrameCount - 1) / std::chrono::duration<double>(m_LastFrameStart - m_FirstFrameStart).count();
+}
+
+double FramePacer::GetRmsJitterMs() const
+{
+	return m_FrameCount == 0 ? 0.0 : std::sqrt(m_SquaredJitterSum / double(m_FrameCount));
+}
+
+double FramePacer::GetMaxJitterMs() const
+{
+	return std::chrono::duration<double, std::milli>(m_MaxJitter).count();
+}
+
+void FramePacer::PrintReport(std::ostream& stream) const
+{
+	stream << "frame pacer: " << m_FramesPerSecond << " Hz target, " << GetMeasuredFramesPerSecond() << " Hz measured over "
+		<< m_FrameCount << " frames, jitter " << GetRmsJitterMs() << " ms rms / " << GetMaxJitterMs() << " ms max, "
+		<< m_LateFrames << " late frames, " << m_Resyncs << " resyncs" << std::endl;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+//Paces the main loop to a fixed frame rate with an absolute deadline per frame.
+//Deadlines are start + n / rate computed from the frame index, so rounding never accumulates into drift. The
+//thread sleeps until shortly before the deadline (clock_nanosleep TIMER_ABSTIME on POSIX) and spins the rest,
+//sleep overshoot then only costs a little CPU instead of jitter. Late frames run back to back until the schedule
+//is met again, after a long hitch (debugger, suspended process) the schedule restarts instead of fast forwarding.
+class FramePacer final
+{
+public:
+	explicit FramePacer(const double framesPerSecond);
+	FramePacer(const FramePacer& old) = delete;
+	FramePacer(FramePacer&& old) = delete;
+	FramePacer& operator=(const FramePacer& other) = delete;
+	FramePacer& operator=(const FramePacer&& other) = delete;
+
+	//blocks until the next frame is due, call once per frame after doing the frame's work
+	void WaitForNextFrame();
+	//measured length of the last frame, what the loop hands to VirtualMachine::Update
+	float GetLastFrameSeconds() const;
+
+	//jitter = difference between when a frame started and its deadline
+	uint64_t GetFrameCount() const { return m_FrameCount; }
+	double GetMeasuredFramesPerSecond() const;
+	double GetRmsJitterMs() const;
+	double GetMaxJitterMs() const;
+	void PrintReport(std::ostream& stream) const;
+private:
+	using Clock = std::chrono::steady_clock;
+	//sleeping stops this long before the deadline, typical sleep overshoot on a desktop OS
+	const static std::chrono::nanoseconds m_SpinTime;
+	//behind by more than this --> restart the schedule
+	const static uint32_t m_MaxCatchUpFrames{ 6 };
+
+	const double m_FramesPerSecond;
+	Clock::time_point m_ScheduleStart;
+	//frames since m_ScheduleStart
+	uint64_t m_ScheduleFrame;
+	Clock::time_point m_LastFrameStart;
+	std::chrono::nanoseconds m_LastFrameTime;
+
+	uint64_t m_FrameCount;
+	uint64_t m_LateFrames;
+	uint64_t m_Resyncs;
+	double m_SquaredJitterSum;
+	std::chrono::nanoseconds m_MaxJitter;
+	Clock::time_point m_FirstFrameStart;
+
+	Clock::time_point GetDeadline(const uint64_t frame) const;
+	static void SleepUntil(const Clock::time_point deadline);
+};
@@ -0,0 +1,10 @@
+#pragma once
+class VirtualMachine;
+//Everything that consumes presented frames (SDL window, terminal, ...) implements this
+class FrameSink
+{
+public:
+	virtual ~FrameSink() = default;
+	//Called once per presented frame, vm.IsDisplayUpdated() tells if the pixels changed since the previous call
+	virtual void PublishFrame(const VirtualMachine& vm) = 0;
+};
@@ -0,0 +1,149 @@
+#include "FrameTelemetry.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	//Prometheus label values, in Stage order
+	const char* g_StageNames[FrameTelemetry::StageCount]{ "input_poll", "emulate", "publish", "texture_upload", "present", "frame" };
+	const double g_Quantiles[]{ 0.5, 0.99, 0.999 };
+
+	uint32_t GetHighestBit(const uint64_t value)
+	{
+		uint32_t bit = 0;
+		while (value >> (bit + 1))
+			++bit;
+		return bit;
+	}
+}
+
+FrameTelemetry::LatencyHistogram::LatencyHistogram()
+	:m_Buckets{}
+	, m_Count{}
+	, m_Sum{}
+{
+}
+
+uint32_t FrameTelemetry::LatencyHistogram::GetBucket(uint64_t nanoseconds)
+{
+	if (nanoseconds < m_LinearLimit)
+		return uint32_t(nanoseconds);
+	//top 7 bits of the value: exponent picks the row of 64, the 6 bits below the leading 1 the bucket in it
+	const uint32_t exponent = GetHighestBit(nanoseconds) - 6;
+	const uint32_t bucket = exponent * m_SubBuckets + uint32_t(nanoseconds >> exponent);
+	return bucket < m_BucketCount ? bucket : m_BucketCount - 1;
+}
+
+uint64_t FrameTelemetry::LatencyHistogram::GetBucketLimit(const uint32_t bucket)
+{
+	if (bucket < m_LinearLimit)
+		return bucket + 1;
+	const uint32_t exponent = bucket / m_SubBuckets - 1;
+	const uint64_t mantissa = bucket % m_SubBuckets + m_SubBuckets;
+	return (mantissa + 1) << exponent;
+}
+
+void FrameTelemetry::LatencyHistogram::Record(const uint64_t nanoseconds)
+{
+	//single writer: relaxed adds are enough, readers only need each counter to be whole
+	m_Buckets[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	m_Sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+	m_Count.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t FrameTelemetry::LatencyHistogram::GetQuantile(const double quantile) const
+{
+	//count from the buckets themselves, m_Count may already include a record whose bucket add is not visible yet
+	uint64_t total = 0;
+	for (const std::atomic<uint64_t>& bucket : m_Buckets)
+		total += bucket.load(std::memory_order_relaxed);
+	if (total == 0)
+		return 0;
+	uint64_t rank = uint64_t(quantile * double(total) + 0.999999);
+	rank = rank == 0 ? 1 : rank > total ? total : rank;
+	uint64_t seen = 0;
+	for (uint32_t bucket = 0; bucket < m_BucketCount; ++bucket)
+	{
+		seen += m_Buckets[bucket].load(std::memory_order_relaxed);
+		if (seen >= rank)
+			return GetBucketLimit(bucket);
+	}
+	return GetBucketLimit(m_BucketCount - 1);
+}
+
+FrameTelemetry::FrameTelemetry(const std::string& path, const double intervalSec)
+	:m_Path{ path }
+	, m_Interval{ int64_t((intervalSec > 0.0 ? intervalSec : 10.0) * 1000.0) }
+	, m_Histograms{}
+	, m_StopMutex{}
+	, m_StopCondition{}
+	, m_IsStopRequested{ false }
+	, m_DumpThread{}
+{
+	m_DumpThread = std::thread(&FrameTelemetry::DumpLoop, this);
+}
+
+FrameTelemetry::~FrameTelemetry()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_StopMutex);
+		m_IsStopRequested = true;
+	}
+	m_StopCondition.notify_one();
+	if (m_DumpThread.joinable())
+		m_DumpThread.join();
+	WriteDump();
+}
+
+void FrameTelemetry::DumpLoop()
+{
+	std::unique_lock<std::mutex> lock(m_StopMutex);
+	while (!m_StopCondition.wait_for(lock, m_Interval, [this]() { return m_IsStopRequested; }))
+	{
+		lock.unlock();
+		WriteDump();
+		lock.lock();
+	}
+}
+
+bool FrameTelemetry::WriteDump() const
+{
+	const std::string tempPath = m_Path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::trunc);
+		if (!file)
+		{
+			std::cerr << "Cant write telemetry to " << tempPath << std::endl;
+			return false;
+		}
+		file << "# HELP chip8_frame_stage_seconds Time spent per frame stage since start\n";
+		file << "# TYPE chip8_frame_stage_seconds summary\n";
+		char line[160];
+		for (uint8_t stage = 0; stage < StageCount; ++stage)
+		{
+			const LatencyHistogram& histogram = m_Histograms[stage];
+			const uint64_t count = histogram.GetCount();
+			//stages the frontend does not have (no window --> no texture upload) are left out
+			if (count == 0)
+				continue;
+			for (const double quantile : g_Quantiles)
+			{
+				std::snprintf(line, sizeof(line), "chip8_frame_stage_seconds{stage=\"%s\",quantile=\"%g\"} %.9f\n", g_StageNames[stage], quantile,
+					double(histogram.GetQuantile(quantile)) * 1e-9);
+				file << line;
+			}
+			std::snprintf(line, sizeof(line), "chip8_frame_stage_seconds_sum{stage=\"%s\"} %.9f\n", g_StageNames[stage], double(histogram.GetSum()) * 1e-9);
+			file << line;
+			std::snprintf(line, sizeof(line), "chip8_frame_stage_seconds_count{stage=\"%s\"} %llu\n", g_StageNames[stage], static_cast<unsigned long long>(count));
+			file << line;
+		}
+		if (!file)
+			return false;
+	}
+	//rename replaces the old dump in one step on POSIX, Windows refuses to rename over an existing file
+#ifdef _WIN32
+	std::remove(m_Path.c_str());
+#endif
+	return std::rename(tempPath.c_str(), m_Path.c_str()) == 0;
+}
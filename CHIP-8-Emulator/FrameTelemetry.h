@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+//Per stage frame latencies (--telemetry): the main loop records durations into one histogram per stage, a background
+//thread writes p50/p99/p999 of every stage in Prometheus text format to a file every few seconds. The file is written
+//next to the target and renamed over it, so a scraper (e.g. the node exporter textfile collector) never sees half a dump.
+//Recording is a few relaxed atomic adds, the dump thread only reads, neither side ever waits for the other.
+class FrameTelemetry final
+{
+public:
+	enum Stage : uint8_t
+	{
+		InputPoll,		//SDLFrontend::ProcessInput
+		Emulate,		//VirtualMachine::Step (run ahead frames included)
+		Publish,		//handing the frame to every sink
+		TextureUpload,	//framebuffer unpack + SDL_UpdateTexture, dirty frames only
+		Present,		//SDL_RenderPresent, includes waiting for vsync when the driver does
+		Frame,			//whole frame interval as the pacer measured it
+		StageCount
+	};
+
+	//HDR style log linear buckets: exact below 128 ns, 64 buckets per power of 2 above (< 1.6 % error) up to ~9 hours
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram();
+		void Record(const uint64_t nanoseconds);
+		uint64_t GetCount() const { return m_Count.load(std::memory_order_relaxed); }
+		uint64_t GetSum() const { return m_Sum.load(std::memory_order_relaxed); }
+		//upper edge of the bucket holding the quantile, from a snapshot that may be a few records behind
+		uint64_t GetQuantile(const double quantile) const;
+
+		const static uint32_t m_LinearLimit{ 128 };
+		const static uint32_t m_SubBuckets{ 64 };
+		const static uint32_t m_BucketCount{ 40 * m_SubBuckets };
+		static uint32_t GetBucket(uint64_t nanoseconds);
+		static uint64_t GetBucketLimit(const uint32_t bucket);
+	private:
+		std::atomic<uint64_t> m_Buckets[m_BucketCount];
+		std::atomic<uint64_t> m_Count;
+		std::atomic<uint64_t> m_Sum;
+	};
+
+	FrameTelemetry(const std::string& path, const double intervalSec);
+	//writes a last dump
+	~FrameTelemetry();
+	FrameTelemetry(const FrameTelemetry& old) = delete;
+	FrameTelemetry(FrameTelemetry&& old) = delete;
+	FrameTelemetry& operator=(const FrameTelemetry& other) = delete;
+	FrameTelemetry& operator=(const FrameTelemetry&& other) = delete;
+
+	using Clock = std::chrono::steady_clock;
+	//from one thread at a time per stage (the main loop)
+	void Record(const Stage stage, const std::chrono::nanoseconds duration) { m_Histograms[stage].Record(uint64_t(duration.count() > 0 ? duration.count() : 0)); }
+	void Record(const Stage stage, const Clock::time_point start, const Clock::time_point end) { Record(stage, end - start); }
+	const LatencyHistogram& GetHistogram(const Stage stage) const { return m_Histograms[stage]; }
+
+	bool WriteDump() const;
+private:
+	void DumpLoop();
+
+	const std::string m_Path;
+	const std::chrono::milliseconds m_Interval;
+	LatencyHistogram m_Histograms[StageCount];
+
+	std::mutex m_StopMutex;
+	std::condition_variable m_StopCondition;
+	bool m_IsStopRequested;
+	std::thread m_DumpThread;
+};
@@ -0,0 +1,88 @@
+#include "Framebuffer.h"
+#include <cstring>
+
+void Framebuffer::Clear()
+{
+	for (uint8_t plane = 0; plane < m_PlaneCount; ++plane)
+	{
+		if (IsPlaneSelected(plane))
+			std::memset(m_Planes[plane], 0, sizeof(m_Planes[plane]));
+	}
+}
+
+void Framebuffer::SetHighRes(const bool isHighRes)
+{
+	m_IsHighRes = isHighRes;
+	std::memset(m_Planes, 0, sizeof(m_Planes));
+}
+
+void Framebuffer::Reset()
+{
+	SetHighRes(false);
+	m_PlaneMask = 1;
+}
+
+void Framebuffer::ScrollDown(const uint8_t rowCount)
+{
+	const uint16_t height = GetHeight();
+	const uint16_t count = rowCount < height ? rowCount : height;
+	for (uint8_t plane = 0; plane < m_PlaneCount; ++plane)
+	{
+		if (!IsPlaneSelected(plane))
+			continue;
+		uint64_t (*pRows)[2] = m_Planes[plane];
+		std::memmove(pRows[count], pRows[0], sizeof(pRows[0]) * (height - count));
+		std::memset(pRows[0], 0, sizeof(pRows[0]) * count);
+	}
+}
+
+void Framebuffer::ScrollUp(const uint8_t rowCount)
+{
+	const uint16_t height = GetHeight();
+	const uint16_t count = rowCount < height ? rowCount : height;
+	for (uint8_t plane = 0; plane < m_PlaneCount; ++plane)
+	{
+		if (!IsPlaneSelected(plane))
+			continue;
+		uint64_t (*pRows)[2] = m_Planes[plane];
+		std::memmove(pRows[0], pRows[count], sizeof(pRows[0]) * (height - count));
+		std::memset(pRows[height - count], 0, sizeof(pRows[0]) * count);
+	}
+}
+
+void Framebuffer::ScrollRight(const uint8_t pixelCount)
+{
+	const uint16_t height = GetHeight();
+	for (uint8_t plane = 0; plane < m_PlaneCount; ++plane)
+	{
+		if (!IsPlaneSelected(plane))
+			continue;
+		for (uint16_t y = 0; y < height; ++y)
+		{
+			uint64_t* pRow = m_Planes[plane][y];
+			//lores rows live in word 0 only, low stays 0 so nothing is shifted out of view into word 1
+			if (m_IsHighRes)
+				ShiftRight128(pRow[0], pRow[1], pixelCount);
+			else
+				pRow[0] = pixelCount < 64 ? pRow[0] >> pixelCount : 0;
+		}
+	}
+}
+
+void Framebuffer::ScrollLeft(const uint8_t pixelCount)
+{
+	const uint16_t height = GetHeight();
+	for (uint8_t plane = 0; plane < m_PlaneCount; ++plane)
+	{
+		if (!IsPlaneSelected(plane))
+			continue;
+		for (uint16_t y = 0; y < height; ++y)
+		{
+			uint64_t* pRow = m_Planes[plane][y];
+			if (m_IsHighRes)
+				ShiftLeft128(pRow[0], pRow[1], pixelCount);
+			else
+				pRow[0] = pixelCount < 64 ? pRow[0] << pixelCount : 0;
+		}
+	}
+}
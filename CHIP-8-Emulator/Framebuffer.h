@@ -0,0 +1,121 @@
+#pragma once
+#include <cstdint>
+//Bit packed display, one bit per pixel and 128 bits per row (2 words, bit 63 of word 0 is the leftmost pixel).
+//Lores (64x32) only uses word 0 of the first 32 rows, hires (SUPER-CHIP 128x64) uses everything.
+//Sprites are XORed in as whole rows and scrolls are row moves plus 128 bit shifts, no per pixel loops.
+//XO-CHIP adds a second bitplane, every plane is its own packed array so a plane draw is the same word XOR.
+class Framebuffer
+{
+public:
+	const static uint16_t m_LoresWidth{ 64 };
+	const static uint16_t m_LoresHeight{ 32 };
+	const static uint16_t m_HiresWidth{ 128 };
+	const static uint16_t m_HiresHeight{ 64 };
+	const static uint8_t m_PlaneCount{ 2 };
+
+	uint16_t GetWidth() const { return m_IsHighRes ? m_HiresWidth : m_LoresWidth; }
+	uint16_t GetHeight() const { return m_IsHighRes ? m_HiresHeight : m_LoresHeight; }
+	bool IsHighRes() const { return m_IsHighRes; }
+	//color index, bit n is set when plane n is set. 0 = off, plain CHIP-8 only ever returns 0 or 1
+	uint8_t GetPixel(const uint16_t x, const uint16_t y) const
+	{
+		const uint16_t word = x >> 6;
+		const uint16_t shift = 63 - (x & 63);
+		return uint8_t(((m_Planes[0][y][word] >> shift) & 1) | (((m_Planes[1][y][word] >> shift) & 1) << 1));
+	}
+	const uint64_t* GetRow(const uint8_t plane, const uint16_t y) const { return m_Planes[plane][y]; }
+
+	//XO-CHIP FN01, bit n selects plane n for drawing, clearing and scrolling
+	uint8_t GetPlaneMask() const { return m_PlaneMask; }
+	void SelectPlanes(const uint8_t planeMask) { m_PlaneMask = planeMask & 0x3; }
+	bool IsPlaneSelected(const uint8_t plane) const { return (m_PlaneMask >> plane) & 1; }
+
+	//clears the selected planes
+	void Clear();
+	//00FE/00FF, switching resolution clears every plane
+	void SetHighRes(const bool isHighRes);
+	//power on: lores, all planes cleared, plane 0 selected
+	void Reset();
+
+	//XORs a left aligned sprite row (bit 63 = leftmost pixel) into one plane at x, y (already inside the screen).
+	//Wrap: pixels past the right edge come back on the left, otherwise they are clipped.
+	//Returns true when a set pixel got erased.
+	template<bool Wrap>
+	bool DrawSpriteRow(const uint8_t plane, const uint16_t x, const uint16_t y, const uint64_t spriteBits);
+
+	//00CN, 00DN, 00FB, 00FC on the selected planes. Amounts are in pixels of the current resolution
+	void ScrollDown(const uint8_t rowCount);
+	void ScrollUp(const uint8_t rowCount);
+	void ScrollRight(const uint8_t pixelCount);
+	void ScrollLeft(const uint8_t pixelCount);
+
+	uint64_t m_Planes[m_PlaneCount][m_HiresHeight][2];
+	uint8_t m_PlaneMask;
+	bool m_IsHighRes;
+private:
+	//(high, low) treated as one 128 bit value
+	static void ShiftRight128(uint64_t& high, uint64_t& low, const uint32_t count);
+	static void ShiftLeft128(uint64_t& high, uint64_t& low, const uint32_t count);
+};
+
+inline void Framebuffer::ShiftRight128(uint64_t& high, uint64_t& low, const uint32_t count)
+{
+	if (count == 0)
+		return;
+	if (count >= 64)
+	{
+		low = count < 128 ? high >> (count - 64) : 0;
+		high = 0;
+		return;
+	}
+	low = (low >> count) | (high << (64 - count));
+	high >>= count;
+}
+
+inline void Framebuffer::ShiftLeft128(uint64_t& high, uint64_t& low, const uint32_t count)
+{
+	if (count == 0)
+		return;
+	if (count >= 64)
+	{
+		high = count < 128 ? low << (count - 64) : 0;
+		low = 0;
+		return;
+	}
+	high = (high << count) | (low >> (64 - count));
+	low <<= count;
+}
+
+template<bool Wrap>
+inline bool Framebuffer::DrawSpriteRow(const uint8_t plane, const uint16_t x, const uint16_t y, const uint64_t spriteBits)
+{
+	uint64_t* pRow = m_Planes[plane][y];
+	if (!m_IsHighRes)
+	{
+		//a whole lores row is one word
+		uint64_t bits = spriteBits >> x;
+		//rotate instead of shift, split in two shifts so x == 0 stays defined
+		if constexpr (Wrap)
+			bits |= (spriteBits << 1) << (63 - x);
+		const bool collision = (pRow[0] & bits) != 0;
+		pRow[0] ^= bits;
+		return collision;
+	}
+
+	uint64_t high = spriteBits;
+	uint64_t low = 0;
+	ShiftRight128(high, low, x);
+	if constexpr (Wrap)
+	{
+		//x == 0 shifts by 128 which yields 0
+		uint64_t wrappedHigh = spriteBits;
+		uint64_t wrappedLow = 0;
+		ShiftLeft128(wrappedHigh, wrappedLow, m_HiresWidth - x);
+		high |= wrappedHigh;
+		low |= wrappedLow;
+	}
+	const bool collision = ((pRow[0] & high) | (pRow[1] & low)) != 0;
+	pRow[0] ^= high;
+	pRow[1] ^= low;
+	return collision;
+}
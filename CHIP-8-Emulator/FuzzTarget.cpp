@@ -0,0 +1,49 @@
+//libFuzzer entry point for the interpreter core, only compiled with CHIP8_FUZZER defined, e.g.
+//clang++ -std=c++17 -O1 -g -DCHIP8_FUZZER -fsanitize=fuzzer,address,undefined -I../ThirdParty/SDL2/include FuzzTarget.cpp VirtualMachine.cpp InstructionLib.cpp Framebuffer.cpp PagedMemory.cpp Debugger.cpp Disassembler.cpp RomArchive.cpp -o chip8_fuzzer
+#ifdef CHIP8_FUZZER
+#include "VirtualMachine.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace
+{
+	//bounded so every input finishes quickly, ROMs are mostly tight loops
+	const uint32_t g_MaxInstructions = 20000;
+	//the input script changes key states every this many instructions
+	const uint32_t g_InstructionsPerScriptStep = 256;
+}
+
+//Input layout: byte 0 = script length L, bytes 1..L = script, rest = ROM.
+//Script byte: low nibble = key, bit 4 = pressed.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* pData, size_t size)
+{
+	if (size == 0)
+		return 0;
+
+	//constructed once, LoadROM starts every input from the shared power on template instead
+	static VirtualMachine* s_pVM = new VirtualMachine();
+	VirtualMachine& vm = *s_pVM;
+
+	const size_t scriptLength = pData[0] < size - 1 ? pData[0] : size - 1;
+	const uint8_t* pScript = pData + 1;
+	const uint8_t* pRom = pScript + scriptLength;
+	const size_t romSize = size - 1 - scriptLength;
+	if (romSize == 0 || !vm.LoadROM(pRom, romSize))
+		return 0;
+
+	size_t scriptIdx = 0;
+	for (uint32_t instruction = 0; instruction < g_MaxInstructions; ++instruction)
+	{
+		//the core refuses to run once PC is past memory, nothing left to explore
+		if (vm.GetPC() >= vm.m_MemSize)
+			break;
+		if (instruction % g_InstructionsPerScriptStep == 0 && scriptIdx < scriptLength)
+		{
+			const uint8_t step = pScript[scriptIdx++];
+			vm.m_Cpu.input[step & 0x0F] = (step >> 4) & 1;
+		}
+		vm.Update();
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+//key change at an emulated cycle (see VirtualMachine::GetCycle), key is the CHIP-8 key after the ROM's key map
+struct InputEvent
+{
+	uint64_t cycle;
+	uint8_t key;
+	bool isPressed;
+};
+
+//Single producer single consumer ring from a frontend (or movie) to the vm, which applies every event right before
+//the instruction of its cycle. Fixed size and lock free like SoundEventRing, the producer may live on another thread.
+class InputEventQueue final
+{
+public:
+	InputEventQueue()
+		:m_Events{}
+		, m_LastCycle{ 0 }
+		, m_Head{ 0 }
+		, m_Tail{ 0 }
+	{
+	}
+	InputEventQueue(const InputEventQueue& old) = delete;
+	InputEventQueue(InputEventQueue&& old) = delete;
+	InputEventQueue& operator=(const InputEventQueue& other) = delete;
+	InputEventQueue& operator=(const InputEventQueue&& other) = delete;
+
+	//producer only (one thread, it may feed several sources). Events are applied in push order, one stamped before the
+	//last pushed event goes at that event's cycle. False when the vm fell behind and the ring is full
+	bool Push(const InputEvent& event)
+	{
+		const uint32_t head = m_Head.load(std::memory_order_relaxed);
+		if (head - m_Tail.load(std::memory_order_acquire) == m_Capacity)
+			return false;
+		m_LastCycle = event.cycle > m_LastCycle ? event.cycle : m_LastCycle;
+		m_Events[head & (m_Capacity - 1)] = InputEvent{ m_LastCycle, event.key, event.isPressed };
+		m_Head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	//consumer only, the oldest event without removing it, false when empty
+	bool Peek(InputEvent& event) const
+	{
+		const uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+		if (tail == m_Head.load(std::memory_order_acquire))
+			return false;
+		event = m_Events[tail & (m_Capacity - 1)];
+		return true;
+	}
+
+	//consumer only, drops the event Peek returned
+	void Pop()
+	{
+		m_Tail.store(m_Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+private:
+	//power of 2, a movie line queues 16 events, a human a few per frame
+	const static uint32_t m_Capacity{ 256 };
+	InputEvent m_Events[m_Capacity];
+	//producer side
+	uint64_t m_LastCycle;
+	//own cache lines, producer and consumer only write their own index
+	alignas(64) std::atomic<uint32_t> m_Head;
+	alignas(64) std::atomic<uint32_t> m_Tail;
+};
@@ -0,0 +1,51 @@
+#include "InputMovie.h"
+#include "VirtualMachine.h"
+#include "InputEventQueue.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+bool InputMovie::Load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		std::cerr << "Cant open input movie " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream lineStream(line);
+		KeyState keyState{};
+		if (!(lineStream >> keyState.frame >> std::hex >> keyState.keyMask))
+			continue;
+		if (!(lineStream >> std::dec >> keyState.instruction))
+			keyState.instruction = 0;
+		m_KeyStates.push_back(keyState);
+	}
+	std::stable_sort(m_KeyStates.begin(), m_KeyStates.end(), [](const KeyState& a, const KeyState& b)
+		{
+			return a.frame < b.frame || (a.frame == b.frame && a.instruction < b.instruction);
+		});
+	m_NextIdx = 0;
+	return true;
+}
+
+void InputMovie::Apply(const uint64_t frame, VirtualMachine& vm, InputEventQueue* pInputQueue)
+{
+	for (; m_NextIdx < m_KeyStates.size() && m_KeyStates[m_NextIdx].frame <= frame; ++m_NextIdx)
+	{
+		const KeyState& keyState = m_KeyStates[m_NextIdx];
+		//lines of earlier frames (e.g. the movie started late) only matter for the state they leave
+		const bool isQueued = pInputQueue && keyState.instruction != 0 && keyState.frame == frame;
+		for (uint8_t key = 0; key < 16; ++key)
+		{
+			const bool isPressed = (keyState.keyMask >> key) & 1;
+			if (!isQueued || !pInputQueue->Push(InputEvent{ vm.GetCycle() + keyState.instruction, key, isPressed }))
+				vm.m_Cpu.input[key] = isPressed;
+		}
+	}
+}
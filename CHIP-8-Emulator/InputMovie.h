@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+class VirtualMachine;
+class InputEventQueue;
+//Scripted key states for reproducible runs.
+//File format: "<frame> <key mask as hex> [instruction]" per line (bit N --> key N held), '#' starts a comment.
+//A line's key state holds from its frame until the next line. With an instruction the keys change right before that
+//instruction of the frame (through the vm's input queue), mid frame presses replay exactly.
+class InputMovie
+{
+public:
+	bool Load(const std::string& path);
+	//sets vm.m_Cpu.input for the frame that is about to run and queues its mid frame changes, frames have to be applied in
+	//increasing order. Without a queue mid frame changes apply at the frame start
+	void Apply(const uint64_t frame, VirtualMachine& vm, InputEventQueue* pInputQueue);
+private:
+	struct KeyState
+	{
+		uint64_t frame;
+		uint16_t keyMask;
+		//0 --> before the frame
+		uint16_t instruction;
+	};
+	std::vector<KeyState> m_KeyStates;
+	size_t m_NextIdx{ 0 };
+};
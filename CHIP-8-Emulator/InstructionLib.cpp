@@ -0,0 +1,31 @@
+#include "InstructionLib.h"
+
+namespace InstructionLib
+{
+	//every profile a ROM can pick is compiled here once
+	template class OpcodeManager<QuirksModern>;
+	template class OpcodeManager<QuirksCosmacVIP>;
+	template class OpcodeManager<QuirksSuperChip>;
+	template class OpcodeManager<QuirksXoChip>;
+
+	OpcodeManagerBase* GetOpcodeManager(const QuirkProfile profile)
+	{
+		//handlers keep no state, so every vm of a profile can share one table
+		static OpcodeManager<QuirksModern> s_Modern{ QuirkProfile::Modern };
+		static OpcodeManager<QuirksCosmacVIP> s_CosmacVIP{ QuirkProfile::CosmacVIP };
+		static OpcodeManager<QuirksSuperChip> s_SuperChip{ QuirkProfile::SuperChip };
+		static OpcodeManager<QuirksXoChip> s_XoChip{ QuirkProfile::XoChip };
+		switch (profile)
+		{
+		case QuirkProfile::CosmacVIP:
+			return &s_CosmacVIP;
+		case QuirkProfile::SuperChip:
+			return &s_SuperChip;
+		case QuirkProfile::XoChip:
+			return &s_XoChip;
+		case QuirkProfile::Modern:
+		default:
+			return &s_Modern;
+		}
+	}
+}
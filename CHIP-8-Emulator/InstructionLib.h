@@ -1,26 +1,47 @@
 #pragma once
 #include "VirtualMachine.h"
-#include <functional>
+#include "Quirks.h"
 #include <vector>
 #include <cstdint>
+#include <cstring>
 
 namespace InstructionLib
 {
-	class OpcodeManager
+	//What the vm holds on to, the quirk profile is fixed per instance of the derived template
+	class OpcodeManagerBase
+	{
+	public:
+		virtual ~OpcodeManagerBase() = default;
+		virtual void ExecuteOpcode(VirtualMachine& vm, const uint16_t& opC) = 0;
+		virtual QuirkProfile GetQuirkProfile() const = 0;
+	};
+
+	//Common profiles are instantiated in InstructionLib.cpp, one shared instance per profile that is never deleted
+	OpcodeManagerBase* GetOpcodeManager(const QuirkProfile profile);
+
+	template<typename Quirks>
+	class OpcodeManager final : public OpcodeManagerBase
 	{
 		struct Opcode
 		{
 			const uint16_t instruction;
 			const uint16_t mask;
 			//Needs to know what instance the function is part of
-			const std::function<void(OpcodeManager*, VirtualMachine&, const uint16_t&)> executableMethod;
+			void(OpcodeManager::* const executableMethod)(VirtualMachine&, const uint16_t&);
 		};
 
 	public:
-		OpcodeManager()
-			:m_Instructions{ 
+		explicit OpcodeManager(const QuirkProfile profile)
+			:m_Profile{ profile }
+			, m_Instructions{ 
 			Opcode{ 0x00E0, 0xFFFF, &OpcodeManager::Instruction00E0 },
 			Opcode{ 0x00EE, 0xFFFF, &OpcodeManager::Instruction00EE },
+			Opcode{ 0x00C0, 0xFFF0, &OpcodeManager::Instruction00CN },
+			Opcode{ 0x00FB, 0xFFFF, &OpcodeManager::Instruction00FB },
+			Opcode{ 0x00FC, 0xFFFF, &OpcodeManager::Instruction00FC },
+			Opcode{ 0x00FD, 0xFFFF, &OpcodeManager::Instruction00FD },
+			Opcode{ 0x00FE, 0xFFFF, &OpcodeManager::Instruction00FE },
+			Opcode{ 0x00FF, 0xFFFF, &OpcodeManager::Instruction00FF },
 			Opcode{ 0x1000, 0xF000, &OpcodeManager::Instruction1NNN },
 			Opcode{ 0x2000, 0xF000, &OpcodeManager::Instruction2NNN },
 			Opcode{ 0x3000, 0xF000, &OpcodeManager::Instruction3XKK },
@@ -50,33 +71,101 @@ namespace InstructionLib
 			Opcode{ 0xF018, 0xF0FF, &OpcodeManager::InstructionFX18 },
 			Opcode{ 0xF01E, 0xF0FF, &OpcodeManager::InstructionFX1E },
 			Opcode{ 0xF029, 0xF0FF, &OpcodeManager::InstructionFX29 },
+			Opcode{ 0xF030, 0xF0FF, &OpcodeManager::InstructionFX30 },
 			Opcode{ 0xF033, 0xF0FF, &OpcodeManager::InstructionFX33 },
 			Opcode{ 0xF055, 0xF0FF, &OpcodeManager::InstructionFX55 },
-			Opcode{ 0xF065, 0xF0FF, &OpcodeManager::InstructionFX65 }
+			Opcode{ 0xF065, 0xF0FF, &OpcodeManager::InstructionFX65 },
+			Opcode{ 0xF075, 0xF0FF, &OpcodeManager::InstructionFX75 },
+			Opcode{ 0xF085, 0xF0FF, &OpcodeManager::InstructionFX85 }
 		} //hold fp to all possible opcode instructions
-		{}
-		void ExecuteOpcode(VirtualMachine& vm, const uint16_t& opC)
+		{
+			if constexpr (Quirks::xoChip)
+			{
+				m_Instructions.push_back(Opcode{ 0x00D0, 0xFFF0, &OpcodeManager::Instruction00DN });
+				m_Instructions.push_back(Opcode{ 0x5002, 0xF00F, &OpcodeManager::Instruction5XY2 });
+				m_Instructions.push_back(Opcode{ 0x5003, 0xF00F, &OpcodeManager::Instruction5XY3 });
+				m_Instructions.push_back(Opcode{ 0xF000, 0xFFFF, &OpcodeManager::InstructionF000 });
+				m_Instructions.push_back(Opcode{ 0xF001, 0xF0FF, &OpcodeManager::InstructionFN01 });
+				m_Instructions.push_back(Opcode{ 0xF002, 0xFFFF, &OpcodeManager::InstructionF002 });
+				m_Instructions.push_back(Opcode{ 0xF03A, 0xF0FF, &OpcodeManager::InstructionFX3A });
+			}
+		}
+		void ExecuteOpcode(VirtualMachine& vm, const uint16_t& opC) override
 		{
 			for (const Opcode& opCode : m_Instructions)
 			{
 				if (opCode.instruction == (opC & opCode.mask))
-					opCode.executableMethod(this, vm, opC); //if given opCode is equal to 1 of the instructions, execute that one
+				{
+					(this->*opCode.executableMethod)(vm, opC); //if given opCode is equal to 1 of the instructions, execute that one
+					break;
+				}
 			}
 		}
+		QuirkProfile GetQuirkProfile() const override { return m_Profile; }
 
 	private:
+		const QuirkProfile m_Profile;
 		std::vector<Opcode> m_Instructions;
 		void Instruction00E0(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			//sets all values in array to 0 (spatial locality memory)
-			std::memset(vm.m_PixelArray, 0, sizeof(uint32_t));	
+			vm.m_Framebuffer.Clear();
+			vm.m_Cpu.displayUpdated = true;
 		}
 
 		void Instruction00EE(VirtualMachine& vm, const uint16_t& instruction)
 		{
-			vm.SetPC(vm.m_Stack[vm.GetSP()]);
+			vm.SetPC(vm.m_Cpu.stack[vm.GetSP()]);
 			vm.DecrementSP();
 		}
+		//SUPER-CHIP: scroll display N rows down
+		void Instruction00CN(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			vm.m_Framebuffer.ScrollDown(GetN(instruction));
+			vm.m_Cpu.displayUpdated = true;
+		}
+
+		//XO-CHIP: scroll display N rows up
+		void Instruction00DN(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			vm.m_Framebuffer.ScrollUp(GetN(instruction));
+			vm.m_Cpu.displayUpdated = true;
+		}
+
+		//SUPER-CHIP: scroll display 4 pixels right
+		void Instruction00FB(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			vm.m_Framebuffer.ScrollRight(4);
+			vm.m_Cpu.displayUpdated = true;
+		}
+
+		//SUPER-CHIP: scroll display 4 pixels left
+		void Instruction00FC(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			vm.m_Framebuffer.ScrollLeft(4);
+			vm.m_Cpu.displayUpdated = true;
+		}
+
+		//SUPER-CHIP: exit interpreter, the program stays parked on this instruction
+		void Instruction00FD(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			vm.DecrementPCByTwo();
+		}
+
+		//SUPER-CHIP: disable high resolution mode (64x32)
+		void Instruction00FE(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			vm.m_Framebuffer.SetHighRes(false);
+			vm.m_Cpu.displayUpdated = true;
+		}
+
+		//SUPER-CHIP: enable high resolution mode (128x64)
+		void Instruction00FF(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			vm.m_Framebuffer.SetHighRes(true);
+			vm.m_Cpu.displayUpdated = true;
+		}
+
 		//jump to address NNN
 		void Instruction1NNN(VirtualMachine& vm, const uint16_t& instruction)
 		{
@@ -88,7 +177,7 @@ namespace InstructionLib
 		void Instruction2NNN(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			vm.IncrementSP();
-			vm.m_Stack[vm.GetSP()] = vm.GetPC();
+			vm.m_Cpu.stack[vm.GetSP()] = vm.GetPC();
 			vm.SetPC(GetNNN(instruction));
 		}
 
@@ -97,10 +186,10 @@ namespace InstructionLib
 		{
 			const uint8_t x = GetX(instruction);
 			//compare, if equal, increment PC by 2
-			if (vm.m_Vx[x] == GetKK(instruction))
+			if (vm.m_Cpu.vx[x] == GetKK(instruction))
 			{
 				//Next address --> PC & PC+1 --> increase by 2
-				vm.IncrementPCByTwo();
+				SkipNextInstruction(vm);
 			}
 		}
 
@@ -109,10 +198,10 @@ namespace InstructionLib
 		{
 			const uint8_t x = GetX(instruction);
 			//compare, if equal, increment PC by 2
-			if (vm.m_Vx[x] != GetKK(instruction))
+			if (vm.m_Cpu.vx[x] != GetKK(instruction))
 			{
 				//Next address --> PC & PC+1 --> increase by 2
-				vm.IncrementPCByTwo();
+				SkipNextInstruction(vm);
 			}
 		}
 
@@ -125,13 +214,35 @@ namespace InstructionLib
 			const uint8_t y = GetY(instruction);
 
 			//compare, if equal, increment PC by 2
-			if (vm.m_Vx[x] == vm.m_Vx[y])
+			if (vm.m_Cpu.vx[x] == vm.m_Cpu.vx[y])
 			{
 				//Next address --> PC & PC+1 --> increase by 2
-				vm.IncrementPCByTwo();
+				SkipNextInstruction(vm);
 			}
 		}
 
+		//XO-CHIP: Store Vx through Vy in memory starting at location I, works in both directions and leaves I alone.
+		void Instruction5XY2(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			const uint8_t x = GetX(instruction);
+			const uint8_t y = GetY(instruction);
+			const int8_t step = x <= y ? 1 : -1;
+			const uint8_t count = uint8_t((x <= y ? y - x : x - y) + 1);
+			for (uint8_t i = 0; i < count; ++i)
+				vm.WriteMemory(vm.m_Cpu.vi + i, vm.m_Cpu.vx[x + step * i]);
+		}
+
+		//XO-CHIP: Read Vx through Vy from memory starting at location I.
+		void Instruction5XY3(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			const uint8_t x = GetX(instruction);
+			const uint8_t y = GetY(instruction);
+			const int8_t step = x <= y ? 1 : -1;
+			const uint8_t count = uint8_t((x <= y ? y - x : x - y) + 1);
+			for (uint8_t i = 0; i < count; ++i)
+				vm.m_Cpu.vx[x + step * i] = vm.ReadMemory(vm.m_Cpu.vi + i);
+		}
+
 		//Set Vx = kk.
 		void Instruction6XKK(VirtualMachine& vm, const uint16_t& instruction)
 		{
@@ -140,7 +251,7 @@ namespace InstructionLib
 			//Get register Y index
 			const uint8_t kk = GetKK(instruction);
 
-			vm.m_Vx[x] = kk;
+			vm.m_Cpu.vx[x] = kk;
 		}
 
 		//Set Vx = Vx + kk.
@@ -151,7 +262,7 @@ namespace InstructionLib
 			//Get register Y index
 			const uint8_t kk = GetKK(instruction);
 
-			vm.m_Vx[x] += kk;
+			vm.m_Cpu.vx[x] += kk;
 		}
 
 		//Set Vx = Vy.
@@ -159,7 +270,7 @@ namespace InstructionLib
 		{
 			const uint8_t x = GetX(instruction);
 			const uint8_t y = GetY(instruction);
-			vm.m_Vx[x] = vm.m_Vx[y];
+			vm.m_Cpu.vx[x] = vm.m_Cpu.vx[y];
 		}
 
 		//Set Vx = Vx OR Vy
@@ -170,7 +281,9 @@ namespace InstructionLib
 			//Performs a bitwise OR on the values of Vx and Vy, then stores the result in Vx.
 			//A bitwise OR compares the corrseponding bits from two values, and if either bit is 1,
 			//then the same bit in the result is also 1. Otherwise, it is 0.
-			vm.m_Vx[x] = vm.m_Vx[x] | vm.m_Vx[y];
+			vm.m_Cpu.vx[x] = vm.m_Cpu.vx[x] | vm.m_Cpu.vx[y];
+			if constexpr (Quirks::logicResetsVF)
+				vm.m_Cpu.vx[0xF] = 0;
 
 		}
 
@@ -182,7 +295,9 @@ namespace InstructionLib
 			//Performs a bitwise AND on the values of Vx and Vy, then stores the result in Vx.
 			//A bitwise AND compares the corrseponding bits from two values, and if both bits are 1,
 			//then the same bit in the result is also 1. Otherwise, it is 0.
-			vm.m_Vx[x] = vm.m_Vx[x] & vm.m_Vx[y];
+			vm.m_Cpu.vx[x] = vm.m_Cpu.vx[x] & vm.m_Cpu.vx[y];
+			if constexpr (Quirks::logicResetsVF)
+				vm.m_Cpu.vx[0xF] = 0;
 		}
 
 		//Set Vx = Vx XOR Vy.
@@ -193,10 +308,12 @@ namespace InstructionLib
 			//Performs a bitwise exclusive OR on the values of Vx and Vy, then stores the result in Vx.
 			//An exclusive OR compares the corrseponding bits from two values, and if the bits are not both the same,
 			//then the corresponding bit in the result is set to 1. Otherwise, it is 0.
-			vm.m_Vx[x] = vm.m_Vx[x] ^ vm.m_Vx[y];
+			vm.m_Cpu.vx[x] = vm.m_Cpu.vx[x] ^ vm.m_Cpu.vx[y];
+			if constexpr (Quirks::logicResetsVF)
+				vm.m_Cpu.vx[0xF] = 0;
 		}
 
-		//Set Vx = Vx + kk.
+		//Set Vx = Vx + Vy, set VF = carry.
 		void Instruction8XY4(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
@@ -204,10 +321,10 @@ namespace InstructionLib
 			//The values of Vx and Vy are added together.
 			//If the result is greater than 8 bits (i.e., > 255,) VF is set to 1, otherwise 0.
 			//Only the lowest 8 bits of the result are kept, and stored in Vx.
-			const uint16_t xY = vm.m_Vx[x] + vm.m_Vx[y];
-			vm.m_Vx[0xF] = xY > sizeof(uint8_t) ? 1 : 0;
-			
-			vm.m_Vx[x] = GetKK(xY);
+			//VF is written last so it wins when x == F
+			const uint16_t xY = vm.m_Cpu.vx[x] + vm.m_Cpu.vx[y];
+			vm.m_Cpu.vx[x] = GetKK(xY);
+			vm.m_Cpu.vx[0xF] = xY > 0xFF ? 1 : 0;
 		}
 
 		//Set Vx = Vx - Vy, set VF = NOT borrow.
@@ -217,9 +334,10 @@ namespace InstructionLib
 			const uint8_t x = GetX(instruction);
 			const uint8_t y = GetY(instruction);
 
-			vm.m_Vx[0xF] = vm.m_Vx[x] > vm.m_Vx[y] ? 1 : 0;
-
-			vm.m_Vx[x] -= vm.m_Vx[y];
+			//no borrow when Vx >= Vy
+			const uint8_t notBorrow = vm.m_Cpu.vx[x] >= vm.m_Cpu.vx[y] ? 1 : 0;
+			vm.m_Cpu.vx[x] -= vm.m_Cpu.vx[y];
+			vm.m_Cpu.vx[0xF] = notBorrow;
 		}
 
 		//Set Vx = Vx SHR 1.
@@ -227,23 +345,23 @@ namespace InstructionLib
 		void Instruction8XY6(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			uint8_t VxVal = vm.m_Vx[x];
+			const uint8_t source = Quirks::shiftUsesVy ? vm.m_Cpu.vx[GetY(instruction)] : vm.m_Cpu.vx[x];
 			//Get lowest bit
-			VxVal = GetLeastSignificantBit(VxVal);
-
-			vm.m_Vx[0xF] = VxVal == 1 ? 1 : 0;
+			const uint8_t lowestBit = source & 0x01u;
 			//divide by 2 once
-			vm.m_Vx[x] >>= 1;
+			vm.m_Cpu.vx[x] = source >> 1;
+			vm.m_Cpu.vx[0xF] = lowestBit;
 		}
 
 		//Set Vx = Vy - Vx, set VF = NOT borrow.
-		//If Vy > Vx, then VF is set to 1, otherwise 0. Then Vx is subtracted from Vy, and the results stored in Vx.
+		//If Vy >= Vx, then VF is set to 1, otherwise 0. Then Vx is subtracted from Vy, and the results stored in Vx.
 		void Instruction8XY7(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
 			const uint8_t y = GetY(instruction);
-			vm.m_Vx[0xF] = vm.m_Vx[x] < vm.m_Vx[y] ? 1 : 0;
-			vm.m_Vx[x] = vm.m_Vx[y] - vm.m_Vx[x];
+			const uint8_t notBorrow = vm.m_Cpu.vx[y] >= vm.m_Cpu.vx[x] ? 1 : 0;
+			vm.m_Cpu.vx[x] = vm.m_Cpu.vx[y] - vm.m_Cpu.vx[x];
+			vm.m_Cpu.vx[0xF] = notBorrow;
 		}
 
 		//Set Vx = Vx SHL 1.
@@ -251,10 +369,12 @@ namespace InstructionLib
 		void Instruction8XYE(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			const uint8_t y = GetY(instruction);
-			vm.m_Vx[0x0F] = (vm.m_Vx[x] >> 8) == 1 ? 1 : 0;
+			const uint8_t source = Quirks::shiftUsesVy ? vm.m_Cpu.vx[GetY(instruction)] : vm.m_Cpu.vx[x];
+			//bit 7 is the most significant bit of a byte
+			const uint8_t highestBit = (source >> 7) & 0x01u;
 			//left shift == *2
-			vm.m_Vx[x] <<= 1;
+			vm.m_Cpu.vx[x] = uint8_t(source << 1);
+			vm.m_Cpu.vx[0xF] = highestBit;
 		}
 
 		//Skip next instruction if Vx != Vy.
@@ -262,115 +382,108 @@ namespace InstructionLib
 		{
 			const uint8_t x = GetX(instruction);
 			const uint8_t y = GetY(instruction);
-			if (vm.m_Vx[x] != vm.m_Vx[y])
+			if (vm.m_Cpu.vx[x] != vm.m_Cpu.vx[y])
 			{
-				vm.IncrementPCByTwo();
+				SkipNextInstruction(vm);
 			}
 		}
 
 		//Set register I = nnn
 		void InstructionANNN(VirtualMachine& vm, const uint16_t& instruction)
 		{
-			vm.m_Vi = GetNNN(instruction);
+			vm.m_Cpu.vi = GetNNN(instruction);
 		}
 
-		//Jump to location nnn + V0
+		//Jump to location nnn + V0 (SUPER-CHIP: xnn + Vx)
 		void InstructionBNNN(VirtualMachine& vm, const uint16_t& instruction)
 		{
-			vm.SetPC(vm.m_Vx[0] + GetNNN(instruction));
+			const uint8_t offsetRegister = Quirks::jumpUsesVx ? GetX(instruction) : 0;
+			vm.SetPC(vm.m_Cpu.vx[offsetRegister] + GetNNN(instruction));
 		}
 
 		//Set Vx = random byte AND kk.
 		void InstructionCXKK(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			const uint8_t random = (std::rand() % 256);
-			vm.m_Vx[x] = random & GetNNN(instruction);
+			const uint8_t random = vm.NextRandomByte();
+			vm.m_Cpu.vx[x] = random & GetKK(instruction);
 		}
 
 		//Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision.
+		//SUPER-CHIP: DXY0 displays a 16x16 sprite (2 bytes per row)
 		void InstructionDXYN(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			//The interpreter reads n bytes from memory, starting at the address stored in I.
-			const uint8_t height = GetN(instruction);//sprite Height (rows)
-			//We know width is 8 pixels wide --> 1 byte, 1 px per bit
 			//These bytes are then displayed as sprites on screen at coordinates (Vx, Vy).
 			//Sprites are XORed onto the existing screen. If this causes any pixels to be erased,
 			//VF is set to 1, otherwise it is set to 0. If the sprite is positioned so part of it is outside the coordinates of the display,
-			//it wraps around to the opposite side of the screen.
-			const uint32_t textureWidth = 64;
-			uint8_t xCoord = GetX(instruction);
-			xCoord = vm.m_Vx[xCoord] % textureWidth; //64 pix total width
-
-			uint8_t yCoord = GetY(instruction);
-			const uint32_t textureHeight = 32;
-			yCoord = vm.m_Vx[yCoord] % textureHeight; //32 pix total height
-
-			const uint8_t width = 8;
+			//it wraps around to the opposite side of the screen (or gets clipped, depending on the quirk profile).
+			//XO-CHIP: every selected plane gets its own sprite, stored one after the other starting at I.
+			Framebuffer& framebuffer = vm.m_Framebuffer;
+			const uint16_t screenWidth = framebuffer.GetWidth();
+			const uint16_t screenHeight = framebuffer.GetHeight();
+			const bool isLargeSprite = GetN(instruction) == 0;
+			const uint8_t height = isLargeSprite ? 16 : GetN(instruction);//sprite Height (rows)
+			const uint8_t spriteSize = isLargeSprite ? 32 : height;
+
+			//the start position always wraps
+			const uint16_t xCoord = vm.m_Cpu.vx[GetX(instruction)] % screenWidth;
+			const uint16_t yCoord = vm.m_Cpu.vx[GetY(instruction)] % screenHeight;
 			bool collisionFlag = false;
+			uint16_t spriteAddress = vm.m_Cpu.vi;
 
-			// The sprite is rendered 8 pixels wide (a pixel per bit) and n bytes high
-			for (int currRow = 0; currRow < height; ++currRow)
+			for (uint8_t plane = 0; plane < Framebuffer::m_PlaneCount; ++plane)
 			{
-				for (int currCol = 0; currCol < width; ++currCol)
-				{
-					const uint16_t address = vm.m_Vi;
-					const uint8_t value = vm.m_Memory[address + currRow];
-
-					// Create mask to see if bit is on in the current column
-					const uint32_t mask = (((0xFF + 1) >> 1) >> currCol);
-					//e.g. 224 == 1110 0000 --> 128 == 0100 0000 ==> true 32 == 0001 0000 ==> false
-					const bool isPixelActive = (value & mask);
+				if (!framebuffer.IsPlaneSelected(plane))
+					continue;
 
-
-					if (!isPixelActive)
-						continue;
-
-					//Get Pixel relative to windowsize
-					const uint32_t relativeXPos = (xCoord + currCol) % uint32_t(vm.m_ScreenDimensions.width); // rest of division is relative xPos
-					const uint32_t relativeYPos = (yCoord + currRow) % uint32_t(vm.m_ScreenDimensions.height);
-
-					const uint32_t relativeIdx = uint32_t(vm.m_ScreenDimensions.width) * relativeYPos + relativeXPos; // is current pos in relative pixelarray
-
-					//  xor pixel onto the display if true
-					if (vm.m_PixelArray[relativeIdx])
+				// Every sprite row is XORed in as one left aligned bit row (bit 63 = leftmost pixel)
+				for (uint8_t currRow = 0; currRow < height; ++currRow)
+				{
+					uint16_t yPos = yCoord + currRow;
+					if (yPos >= screenHeight)
 					{
-						collisionFlag = true;
-						vm.m_PixelArray[relativeIdx] = !collisionFlag;
-						continue;
+						if constexpr (!Quirks::spritesWrap)
+							break;
+						yPos -= screenHeight;
 					}
 
-					vm.m_PixelArray[relativeIdx] = 0xFFFFFFFF;
+					uint64_t spriteBits;
+					if (isLargeSprite)
+						spriteBits = uint64_t(vm.ReadMemory(spriteAddress + currRow * 2)) << 56 | uint64_t(vm.ReadMemory(spriteAddress + currRow * 2 + 1)) << 48;
+					else
+						spriteBits = uint64_t(vm.ReadMemory(spriteAddress + currRow)) << 56;
+
+					collisionFlag |= framebuffer.DrawSpriteRow<Quirks::spritesWrap>(plane, xCoord, yPos, spriteBits);
 				}
+				spriteAddress += spriteSize;
 			}
 
 			// Set CollisionFlag in F register
-			vm.m_Vx[0xF] = collisionFlag ? 1 : 0;
-			//vm.m_DisplayUpdated = true;
-
-
+			vm.m_Cpu.vx[0xF] = collisionFlag ? 1 : 0;
+			vm.m_Cpu.displayUpdated = true;
 		}
 		//Skip next instruction if key with the value of Vx is pressed.
 		void InstructionEX9E(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			if (vm.m_Input[vm.m_Vx[x]])
-				vm.IncrementPCByTwo();
+			if (vm.m_Cpu.input[vm.m_Cpu.vx[x] & 0x0Fu])
+				SkipNextInstruction(vm);
 		}
 
 		//Skip next instruction if key with the value of Vx is not pressed.
 		void InstructionEXA1(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			if (!vm.m_Input[vm.m_Vx[x]])
-				vm.IncrementPCByTwo();
+			if (!vm.m_Cpu.input[vm.m_Cpu.vx[x] & 0x0Fu])
+				SkipNextInstruction(vm);
 		}
 
 		//Set Vx = delay timer value.
 		void InstructionFX07(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			vm.m_Vx[x] = vm.m_DT;
+			vm.m_Cpu.vx[x] = vm.m_Cpu.dt;
 		}
 
 		//Wait for a key press, store the value of the key in Vx.
@@ -380,9 +493,9 @@ namespace InstructionLib
 			for (uint8_t i{ 0 }; i < 16; i++)
 			{
 				//Go over input, if there is save it in Vx
-				if (vm.m_Input[i])
+				if (vm.m_Cpu.input[i])
 				{
-					vm.m_Vx[x] = i;
+					vm.m_Cpu.vx[x] = i;
 					return;
 				}
 			}
@@ -394,50 +507,57 @@ namespace InstructionLib
 		void InstructionFX15(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			vm.m_DT = vm.m_Vx[x];
+			vm.m_Cpu.dt = vm.m_Cpu.vx[x];
 		}
 
 		//Set sound timer = Vx.
 		void InstructionFX18(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			vm.m_ST = vm.m_Vx[x];
+			vm.m_Cpu.st = vm.m_Cpu.vx[x];
 		}
 
 		//Set I = I + Vx.
 		void InstructionFX1E(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			vm.m_Vi += vm.m_Vx[x];
+			vm.m_Cpu.vi += vm.m_Cpu.vx[x];
 		}
 
 		//Set I = location of sprite for digit Vx.
 		void InstructionFX29(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			const uint8_t digit = vm.m_Vx[x];
+			const uint8_t digit = vm.m_Cpu.vx[x];
 
 			//letter sprites start at mem 0x050, eacht has a size of 5
-			vm.m_Vi = 0x050 + (5 * digit);
+			vm.m_Cpu.vi = VirtualMachine::m_FontAddress + (5 * digit);
+		}
 
+		//SUPER-CHIP: Set I = location of 10 byte sprite for decimal digit Vx.
+		void InstructionFX30(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			const uint8_t x = GetX(instruction);
+			const uint8_t digit = vm.m_Cpu.vx[x];
+			vm.m_Cpu.vi = VirtualMachine::m_LargeFontAddress + (10 * (digit % 10));
 		}
 
 		//Store BCD representation of Vx in memory locations I, I+1, and I+2.
 		void InstructionFX33(VirtualMachine& vm, const uint16_t& instruction)
 		{
 			const uint8_t x = GetX(instruction);
-			uint8_t decimalVal = vm.m_Vx[x];
+			uint8_t decimalVal = vm.m_Cpu.vx[x];
 
 			// Ones-place
-			vm.m_Memory[vm.m_Vi + 2] = decimalVal % 10;
+			vm.WriteMemory(vm.m_Cpu.vi + 2, decimalVal % 10);
 			decimalVal /= 10;
 
 			// Tens-place
-			vm.m_Memory[vm.m_Vi + 1] = decimalVal % 10;
+			vm.WriteMemory(vm.m_Cpu.vi + 1, decimalVal % 10);
 			decimalVal /= 10;
 
 			// Hundreds-place
-			vm.m_Memory[vm.m_Vi] = decimalVal % 10;
+			vm.WriteMemory(vm.m_Cpu.vi, decimalVal % 10);
 		}
 
 		//Store registers V0 through Vx in memory starting at location I.
@@ -447,8 +567,10 @@ namespace InstructionLib
 
 			for (uint8_t i = 0; i <= x; ++i)
 			{
-				vm.m_Memory[vm.m_Vi + i] = vm.m_Vx[i];
+				vm.WriteMemory(vm.m_Cpu.vi + i, vm.m_Cpu.vx[i]);
 			}
+			if constexpr (Quirks::loadStoreIncrementsI)
+				vm.m_Cpu.vi += x + 1;
 		}
 
 		//Read registers V0 through Vx from memory starting at location I.
@@ -458,8 +580,51 @@ namespace InstructionLib
 
 			for (uint8_t i = 0; i <= x; ++i)
 			{
-				vm.m_Vx[i] = vm.m_Memory[vm.m_Vi + i];
+				vm.m_Cpu.vx[i] = vm.ReadMemory(vm.m_Cpu.vi + i);
 			}
+			if constexpr (Quirks::loadStoreIncrementsI)
+				vm.m_Cpu.vi += x + 1;
+		}
+
+		//SUPER-CHIP: Store V0 through Vx in the RPL user flags.
+		void InstructionFX75(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			const uint8_t x = GetX(instruction);
+			std::memcpy(vm.m_Cpu.rplFlags, vm.m_Cpu.vx, x + 1);
+		}
+
+		//SUPER-CHIP: Read V0 through Vx from the RPL user flags.
+		void InstructionFX85(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			const uint8_t x = GetX(instruction);
+			std::memcpy(vm.m_Cpu.vx, vm.m_Cpu.rplFlags, x + 1);
+		}
+
+		//XO-CHIP: Set I = NNNN, the 16 bit address is the word after the instruction.
+		void InstructionF000(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			const uint16_t pc = vm.GetPC();
+			vm.m_Cpu.vi = uint16_t(vm.ReadMemory(pc) << 8 | vm.ReadMemory(pc + 1));
+			vm.IncrementPCByTwo();
+		}
+
+		//XO-CHIP: Select the drawing planes, N is a bit mask.
+		void InstructionFN01(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			vm.m_Framebuffer.SelectPlanes(GetX(instruction));
+		}
+
+		//XO-CHIP: Load the 16 byte audio pattern buffer from memory starting at location I.
+		void InstructionF002(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			for (uint8_t i = 0; i < sizeof(vm.m_Cpu.audioPattern); ++i)
+				vm.m_Cpu.audioPattern[i] = vm.ReadMemory(vm.m_Cpu.vi + i);
+		}
+
+		//XO-CHIP: Set audio pitch = Vx.
+		void InstructionFX3A(VirtualMachine& vm, const uint16_t& instruction)
+		{
+			vm.m_Cpu.audioPitch = vm.m_Cpu.vx[GetX(instruction)];
 		}
 
 
@@ -476,6 +641,18 @@ namespace InstructionLib
 			return instruction & 0x0FFFu; // u == unsigned
 		}
 
+		void SkipNextInstruction(VirtualMachine& vm) const
+		{
+			//XO-CHIP: F000 NNNN is 4 bytes long and is skipped as a whole
+			if constexpr (Quirks::xoChip)
+			{
+				const uint16_t pc = vm.GetPC();
+				if (vm.ReadMemory(pc) == 0xF0 && vm.ReadMemory(pc + 1) == 0x00)
+					vm.IncrementPCByTwo();
+			}
+			vm.IncrementPCByTwo();
+		}
+
 		uint8_t GetX(const uint16_t& instruction) const
 		{
 			//Opcode layout: Instruction RegisterX N N
@@ -497,10 +674,5 @@ namespace InstructionLib
 			//Opcode layout: Instruction RegisterX K K
 			return instruction & 0x00FFu; // u == unsigned
 		}
-		uint8_t GetLeastSignificantBit(uint16_t Val) const
-		{
-			//Opcode layout: Instruction RegisterX K K
-			return Val &= ~Val + 1; // u == unsigned
-		}
 	};
 }
\ No newline at end of file
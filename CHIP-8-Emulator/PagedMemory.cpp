@@ -0,0 +1,193 @@
+#include "PagedMemory.h"
+#include <cstring>
+#include <new>
+
+const size_t PagedMemory::m_PageBlockSize{ sizeof(PagedMemory::Page) };
+
+PagedMemory::PagedMemory()
+	:m_pAllocator{}
+	, m_pTableAllocator{}
+	, m_pPages{ m_InlinePages }
+	, m_PageCount{}
+	, m_PageCapacity{ m_InlinePageCount }
+	, m_InlinePages{}
+{
+}
+
+PagedMemory::~PagedMemory()
+{
+	for (uint32_t pageIdx = 0; pageIdx < m_PageCount; ++pageIdx)
+		ReleasePage(m_pPages[pageIdx]);
+	ResizeTable(0);
+}
+
+void PagedMemory::SetAllocator(Allocator* pAllocator)
+{
+	m_pAllocator = pAllocator;
+}
+
+void PagedMemory::DeleteTable()
+{
+	if (m_pPages == m_InlinePages)
+		return;
+	if (m_pTableAllocator)
+		m_pTableAllocator->FreeTable(m_pPages);
+	else
+		delete[] m_pPages;
+	m_pPages = m_InlinePages;
+}
+
+void PagedMemory::ResizeTable(const uint32_t pageCount)
+{
+	if (pageCount > m_PageCapacity || (pageCount <= m_InlinePageCount && m_pPages != m_InlinePages))
+	{
+		Page** pPages = m_InlinePages;
+		uint32_t capacity = m_InlinePageCount;
+		Allocator* pTableAllocator = nullptr;
+		if (pageCount > m_InlinePageCount)
+		{
+			pPages = m_pAllocator && pageCount <= m_MaxPageCount ? static_cast<Page**>(m_pAllocator->AllocateTable()) : nullptr;
+			capacity = pPages ? m_MaxPageCount : pageCount;
+			pTableAllocator = pPages ? m_pAllocator : nullptr;
+			if (!pPages)
+				pPages = new Page*[pageCount];
+		}
+		std::memcpy(pPages, m_pPages, sizeof(Page*) * (pageCount < m_PageCount ? pageCount : m_PageCount));
+		DeleteTable();
+		m_pPages = pPages;
+		m_pTableAllocator = pTableAllocator;
+		m_PageCapacity = capacity;
+	}
+	m_PageCount = pageCount;
+}
+
+PagedMemory::Page* PagedMemory::GetZeroPage()
+{
+	//never freed, the extra reference keeps the count from ever reaching 0
+	static Page* s_pZeroPage = []()
+	{
+		Page* pPage = new Page();
+		pPage->refCount.store(1, std::memory_order_relaxed);
+		pPage->pAllocator = nullptr;
+		std::memset(pPage->bytes, 0, m_PageSize);
+		return pPage;
+	}();
+	return s_pZeroPage;
+}
+
+void PagedMemory::ReleasePage(Page* pPage)
+{
+	if (pPage->refCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+	Allocator* pAllocator = pPage->pAllocator;
+	if (!pAllocator)
+	{
+		delete pPage;
+		return;
+	}
+	pPage->~Page();
+	pAllocator->FreePage(pPage);
+}
+
+void PagedMemory::Resize(const uint32_t size)
+{
+	const uint32_t pageCount = (size + m_PageSize - 1) >> m_PageShift;
+	for (uint32_t pageIdx = pageCount; pageIdx < m_PageCount; ++pageIdx)
+		ReleasePage(m_pPages[pageIdx]);
+	const uint32_t oldCount = m_PageCount;
+	ResizeTable(pageCount);
+	if (pageCount <= oldCount)
+		return;
+	Page* pZeroPage = GetZeroPage();
+	for (uint32_t pageIdx = oldCount; pageIdx < pageCount; ++pageIdx)
+		m_pPages[pageIdx] = pZeroPage;
+	pZeroPage->refCount.fetch_add(pageCount - oldCount, std::memory_order_relaxed);
+}
+
+void PagedMemory::ShareFrom(const PagedMemory& other)
+{
+	if (&other == this)
+		return;
+	//refork of the same parent: pages that are still shared are skipped, saves 2 atomics per page
+	const uint32_t commonCount = m_PageCount < other.m_PageCount ? m_PageCount : other.m_PageCount;
+	for (uint32_t pageIdx = 0; pageIdx < commonCount; ++pageIdx)
+	{
+		Page* pPage = other.m_pPages[pageIdx];
+		if (m_pPages[pageIdx] == pPage)
+			continue;
+		pPage->refCount.fetch_add(1, std::memory_order_relaxed);
+		ReleasePage(m_pPages[pageIdx]);
+		m_pPages[pageIdx] = pPage;
+	}
+	for (uint32_t pageIdx = commonCount; pageIdx < m_PageCount; ++pageIdx)
+		ReleasePage(m_pPages[pageIdx]);
+	ResizeTable(other.m_PageCount);
+	for (uint32_t pageIdx = commonCount; pageIdx < other.m_PageCount; ++pageIdx)
+	{
+		Page* pPage = other.m_pPages[pageIdx];
+		pPage->refCount.fetch_add(1, std::memory_order_relaxed);
+		m_pPages[pageIdx] = pPage;
+	}
+}
+
+uint32_t PagedMemory::GetPrivatePageCount() const
+{
+	uint32_t count = 0;
+	for (uint32_t pageIdx = 0; pageIdx < m_PageCount; ++pageIdx)
+	{
+		if (m_pPages[pageIdx]->refCount.load(std::memory_order_relaxed) == 1)
+			++count;
+	}
+	return count;
+}
+
+void PagedMemory::Read(const uint32_t address, uint8_t* pData, const uint32_t size) const
+{
+	uint32_t copied = 0;
+	while (copied < size)
+	{
+		const uint32_t current = address + copied;
+		const uint32_t offset = current & (m_PageSize - 1);
+		const uint32_t chunk = (m_PageSize - offset) < (size - copied) ? (m_PageSize - offset) : (size - copied);
+		std::memcpy(pData + copied, m_pPages[current >> m_PageShift]->bytes + offset, chunk);
+		copied += chunk;
+	}
+}
+
+void PagedMemory::Write(const uint32_t address, const uint8_t* pData, const uint32_t size)
+{
+	uint32_t copied = 0;
+	while (copied < size)
+	{
+		const uint32_t current = address + copied;
+		const uint32_t offset = current & (m_PageSize - 1);
+		const uint32_t chunk = (m_PageSize - offset) < (size - copied) ? (m_PageSize - offset) : (size - copied);
+		const uint32_t pageIdx = current >> m_PageShift;
+		if (std::memcmp(m_pPages[pageIdx]->bytes + offset, pData + copied, chunk) != 0)
+			std::memcpy(GetWritablePage(pageIdx) + offset, pData + copied, chunk);
+		copied += chunk;
+	}
+}
+
+bool PagedMemory::IsEqual(const uint8_t* pData) const
+{
+	for (uint32_t pageIdx = 0; pageIdx < m_PageCount; ++pageIdx)
+	{
+		if (std::memcmp(m_pPages[pageIdx]->bytes, pData + (pageIdx << m_PageShift), m_PageSize) != 0)
+			return false;
+	}
+	return true;
+}
+
+PagedMemory::Page* PagedMemory::CopyPage(const uint32_t pageIdx)
+{
+	Page* pShared = m_pPages[pageIdx];
+	void* pBlock = m_pAllocator ? m_pAllocator->AllocatePage() : nullptr;
+	Page* pPage = pBlock ? new (pBlock) Page() : new Page();
+	pPage->refCount.store(1, std::memory_order_relaxed);
+	pPage->pAllocator = pBlock ? m_pAllocator : nullptr;
+	std::memcpy(pPage->bytes, pShared->bytes, m_PageSize);
+	m_pPages[pageIdx] = pPage;
+	ReleasePage(pShared);
+	return pPage;
+}
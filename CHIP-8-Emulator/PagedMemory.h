@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+//Interpreter memory split into 256 byte pages that forked machines share read only.
+//A page is copied the first time an owner writes to it while someone else still holds it (copy on write),
+//so thousands of forks of one ROM only pay for the pages they actually change.
+//Pages are reference counted atomically, forks can run on other threads. The machine being forked from must not
+//run while the fork is taken.
+class PagedMemory
+{
+public:
+	const static uint32_t m_PageSize{ 256 };
+	const static uint32_t m_PageShift{ 8 };
+	//64 KB, the largest memory (XO-CHIP)
+	const static uint32_t m_MaxPageCount{ 256 };
+	//bytes of one page including its header
+	const static size_t m_PageBlockSize;
+
+	//where copied pages and page tables above the inline size come from instead of the heap (VmPool's arenas).
+	//A page goes back to the allocator it came from, from whichever memory drops the last reference
+	class Allocator
+	{
+	public:
+		//m_PageBlockSize bytes, nullptr --> the memory falls back to the heap
+		virtual void* AllocatePage() = 0;
+		//any thread
+		virtual void FreePage(void* pPage) = 0;
+		//m_MaxPageCount entries, nullptr --> heap
+		virtual void* AllocateTable() = 0;
+		virtual void FreeTable(void* pTable) = 0;
+	protected:
+		~Allocator() = default;
+	};
+
+	PagedMemory();
+	~PagedMemory();
+	PagedMemory(const PagedMemory& old) = delete;
+	PagedMemory(PagedMemory&& old) = delete;
+	PagedMemory& operator=(const PagedMemory& other) = delete;
+	PagedMemory& operator=(const PagedMemory&& other) = delete;
+
+	//pages already held stay where they are, pages copied from now on come from pAllocator (nullptr --> the heap)
+	void SetAllocator(Allocator* pAllocator);
+
+	//keeps the pages that fit, new pages read as 0 (they all share one zero page until written)
+	void Resize(const uint32_t size);
+	//drops every own page and shares all pages of other instead, pointer copies and refcount increments only
+	void ShareFrom(const PagedMemory& other);
+
+	uint32_t GetSize() const { return m_PageCount << m_PageShift; }
+	//pages not shared with any other memory
+	uint32_t GetPrivatePageCount() const;
+
+	//address has to be inside the memory
+	uint8_t Read(const uint32_t address) const { return m_pPages[address >> m_PageShift]->bytes[address & (m_PageSize - 1)]; }
+	void Write(const uint32_t address, const uint8_t value) { GetWritablePage(address >> m_PageShift)[address & (m_PageSize - 1)] = value; }
+
+	//bulk copies, pData covers [address, address + size) inside the memory
+	void Read(const uint32_t address, uint8_t* pData, const uint32_t size) const;
+	//pages whose content already matches are left alone (and stay shared)
+	void Write(const uint32_t address, const uint8_t* pData, const uint32_t size);
+	bool IsEqual(const uint8_t* pData) const;
+private:
+	struct Page
+	{
+		std::atomic<uint32_t> refCount;
+		//nullptr --> heap
+		Allocator* pAllocator;
+		uint8_t bytes[m_PageSize];
+	};
+
+	static Page* GetZeroPage();
+	static void ReleasePage(Page* pPage);
+	//frees m_pPages unless it is the inline table
+	void DeleteTable();
+
+	//keeps the first pageCount entries that exist, callers release the pages past pageCount before and fill new entries after
+	void ResizeTable(const uint32_t pageCount);
+
+	uint8_t* GetWritablePage(const uint32_t pageIdx)
+	{
+		Page* pPage = m_pPages[pageIdx];
+		if (pPage->refCount.load(std::memory_order_acquire) != 1)
+			pPage = CopyPage(pageIdx);
+		return pPage->bytes;
+	}
+	Page* CopyPage(const uint32_t pageIdx);
+
+	//page table, up to 4 KB (CHIP-8, SUPER-CHIP) it lives inside the object and creating a memory allocates nothing.
+	//XO-CHIP's 64 KB get a table from the allocator or the heap
+	const static uint32_t m_InlinePageCount{ 16 };
+	Allocator* m_pAllocator;
+	//the allocator m_pPages came from when it is not inline, nullptr --> heap
+	Allocator* m_pTableAllocator;
+	Page** m_pPages;
+	uint32_t m_PageCount;
+	uint32_t m_PageCapacity;
+	Page* m_InlinePages[m_InlinePageCount];
+};
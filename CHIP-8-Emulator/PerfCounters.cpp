@@ -0,0 +1,205 @@
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char* g_CounterNames[PerfCounters::CounterCount]{ "task-clock", "cycles", "instructions", "branches", "branch-misses", "L1d-read-misses", "LL-read-misses" };
+
+#if defined(__linux__)
+	int OpenCounter(const PerfCounters::Counter counter, const int groupFd)
+	{
+		perf_event_attr attr{};
+		attr.size = sizeof(attr);
+		switch (counter)
+		{
+		case PerfCounters::TaskClock:
+			attr.type = PERF_TYPE_SOFTWARE;
+			attr.config = PERF_COUNT_SW_TASK_CLOCK;
+			break;
+		case PerfCounters::Cycles:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case PerfCounters::Instructions:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case PerfCounters::Branches:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS;
+			break;
+		case PerfCounters::BranchMisses:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		case PerfCounters::L1dReadMisses:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		default:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		}
+		//the leader starts the whole group at once, user space only works with perf_event_paranoid 2
+		attr.disabled = groupFd < 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		//this thread on any cpu
+		return int(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+	}
+#endif
+}
+
+PerfCounters::PerfCounters(const std::string& csvPath)
+	:m_GroupFd{ -1 }
+	, m_Fds{}
+	, m_ReadOrder{}
+	, m_OpenCount{}
+	, m_FrameStart{}
+	, m_LastFrame{}
+	, m_Total{}
+	, m_FrameCount{}
+	, m_Csv{}
+{
+	for (int& fd : m_Fds)
+		fd = -1;
+#if defined(__linux__)
+	m_GroupFd = OpenCounter(TaskClock, -1);
+	if (m_GroupFd < 0)
+	{
+		std::cerr << "Performance counters unavailable: " << std::strerror(errno) << std::endl;
+		return;
+	}
+	m_Fds[TaskClock] = m_GroupFd;
+	m_ReadOrder[m_OpenCount++] = TaskClock;
+	std::string missing;
+	int missingError = 0;
+	for (uint8_t counter = Cycles; counter < CounterCount; ++counter)
+	{
+		m_Fds[counter] = OpenCounter(Counter(counter), m_GroupFd);
+		if (m_Fds[counter] >= 0)
+			m_ReadOrder[m_OpenCount++] = counter;
+		else
+		{
+			missing += std::string(missing.empty() ? "" : ", ") + g_CounterNames[counter];
+			missingError = errno;
+		}
+	}
+	if (!missing.empty())
+		std::cerr << "Performance counters without " << missing << ": " << std::strerror(missingError) << std::endl;
+	ioctl(m_GroupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(m_GroupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+	std::cerr << "Performance counters need Linux perf_event_open" << std::endl;
+#endif
+	if (IsOpen() && !csvPath.empty())
+	{
+		m_Csv.open(csvPath);
+		if (!m_Csv)
+			std::cerr << "Cant open " << csvPath << std::endl;
+		m_Csv << "frame,emulated_instructions";
+		for (uint8_t counter = 0; counter < CounterCount; ++counter)
+			m_Csv << ',' << g_CounterNames[counter];
+		m_Csv << ",host_per_emulated_instruction,branch_miss_rate\n";
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+	for (int& fd : m_Fds)
+	{
+		if (fd >= 0)
+			close(fd);
+		fd = -1;
+	}
+#endif
+	m_GroupFd = -1;
+}
+
+bool PerfCounters::ReadCounters(uint64_t* pValues) const
+{
+	std::memset(pValues, 0, sizeof(uint64_t) * CounterCount);
+#if defined(__linux__)
+	//nr, time enabled, time running, one value per opened counter
+	uint64_t buffer[3 + CounterCount]{};
+	if (m_GroupFd < 0 || read(m_GroupFd, buffer, sizeof(buffer)) < ssize_t(sizeof(uint64_t) * (3 + m_OpenCount)))
+		return false;
+	const uint64_t enabled = buffer[1];
+	const uint64_t running = buffer[2];
+	for (uint8_t readIdx = 0; readIdx < m_OpenCount && readIdx < buffer[0]; ++readIdx)
+	{
+		const uint64_t value = buffer[3 + readIdx];
+		pValues[m_ReadOrder[readIdx]] = running != 0 && running < enabled ? uint64_t(double(value) * double(enabled) / double(running)) : value;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void PerfCounters::BeginFrame()
+{
+	if (!IsOpen())
+		return;
+	ReadCounters(m_FrameStart);
+}
+
+void PerfCounters::EndFrame(const uint64_t emulatedInstructions)
+{
+	if (!IsOpen())
+		return;
+	uint64_t frameEnd[CounterCount];
+	if (!ReadCounters(frameEnd))
+		return;
+	m_LastFrame.emulatedInstructions = emulatedInstructions;
+	m_Total.emulatedInstructions += m_LastFrame.emulatedInstructions;
+	for (uint8_t counter = 0; counter < CounterCount; ++counter)
+	{
+		//scaled multiplexed counts can step back a little
+		m_LastFrame.values[counter] = frameEnd[counter] > m_FrameStart[counter] ? frameEnd[counter] - m_FrameStart[counter] : 0;
+		m_Total.values[counter] += m_LastFrame.values[counter];
+	}
+	++m_FrameCount;
+
+	if (!m_Csv.is_open())
+		return;
+	m_Csv << m_FrameCount << ',' << m_LastFrame.emulatedInstructions;
+	for (uint8_t counter = 0; counter < CounterCount; ++counter)
+		m_Csv << ',' << m_LastFrame.values[counter];
+	const uint64_t emulated = m_LastFrame.emulatedInstructions;
+	const uint64_t branches = m_LastFrame.values[Branches];
+	m_Csv << ',' << (emulated ? double(m_LastFrame.values[Instructions]) / double(emulated) : 0.0)
+		<< ',' << (branches ? double(m_LastFrame.values[BranchMisses]) / double(branches) : 0.0) << '\n';
+}
+
+void PerfCounters::PrintReport(std::ostream& stream) const
+{
+	if (!IsOpen() || m_FrameCount == 0)
+		return;
+	const double frames = double(m_FrameCount);
+	const double emulated = double(m_Total.emulatedInstructions ? m_Total.emulatedInstructions : 1);
+	stream << "perf over " << m_FrameCount << " frames, " << m_Total.emulatedInstructions << " emulated instructions: "
+		<< double(m_Total.values[TaskClock]) / frames / 1000.0 << " us task clock per frame";
+	//per emulated instruction, what dispatch changes are judged by
+	const char* pSeparator = "; per emulated instruction:";
+	for (const Counter counter : { Cycles, Instructions, BranchMisses, L1dReadMisses, LLReadMisses })
+	{
+		if (!IsAvailable(counter))
+			continue;
+		stream << pSeparator << ' ' << double(m_Total.values[counter]) / emulated << ' ' << g_CounterNames[counter];
+		pSeparator = ",";
+	}
+	if (IsAvailable(Branches) && IsAvailable(BranchMisses) && m_Total.values[Branches] != 0)
+		stream << ", branch miss rate " << 100.0 * double(m_Total.values[BranchMisses]) / double(m_Total.values[Branches]) << " %";
+	stream << std::endl;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+//Host performance counters around the emulation of a frame (--perf), Linux perf_event_open only.
+//One counter group per instance counting the thread that created it, user space only: profile several vms or threads
+//with one instance each. Counters that cannot be opened (no PMU in containers and VMs, perf_event_paranoid, other
+//platforms) are reported once and left out, task clock is a software counter and works almost everywhere.
+//Begin/EndFrame take one read each, everything between them is attributed to the frame, divided by the number of
+//instructions the vm executed: a dispatch change that removes mispredictions shows up as fewer misses per instruction.
+class PerfCounters final
+{
+public:
+	//empty csvPath --> no per frame log
+	explicit PerfCounters(const std::string& csvPath);
+	~PerfCounters();
+	PerfCounters(const PerfCounters& old) = delete;
+	PerfCounters(PerfCounters&& old) = delete;
+	PerfCounters& operator=(const PerfCounters& other) = delete;
+	PerfCounters& operator=(const PerfCounters&& other) = delete;
+
+	//there is no generic L2 event, last level misses are what is left when neither L1 nor L2 had the line
+	enum Counter : uint8_t { TaskClock, Cycles, Instructions, Branches, BranchMisses, L1dReadMisses, LLReadMisses, CounterCount };
+	bool IsOpen() const { return m_GroupFd >= 0; }
+	bool IsAvailable(const Counter counter) const { return m_Fds[counter] >= 0; }
+
+	//on the thread that created the counters, around the emulation of a frame (Step, not the presentation) of one or
+	//many vms (--bench-instances). The caller counts the instructions they executed, run ahead copies included
+	void BeginFrame();
+	void EndFrame(const uint64_t emulatedInstructions);
+
+	//TaskClock in ns, the rest in events, unavailable counters stay 0
+	struct Sample
+	{
+		uint64_t values[CounterCount];
+		uint64_t emulatedInstructions;
+	};
+	const Sample& GetLastFrame() const { return m_LastFrame; }
+	const Sample& GetTotal() const { return m_Total; }
+	uint64_t GetFrameCount() const { return m_FrameCount; }
+	void PrintReport(std::ostream& stream) const;
+private:
+	//counts since the group was enabled, scaled up when the kernel had to multiplex the group
+	bool ReadCounters(uint64_t* pValues) const;
+
+	int m_GroupFd;
+	int m_Fds[CounterCount];
+	//opened counters in group order, how they come back from a group read
+	uint8_t m_ReadOrder[CounterCount];
+	uint8_t m_OpenCount;
+	uint64_t m_FrameStart[CounterCount];
+	Sample m_LastFrame;
+	Sample m_Total;
+	uint64_t m_FrameCount;
+	std::ofstream m_Csv;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+//Behaviour that differs between CHIP-8 interpreters. A profile is a template parameter of OpcodeManager,
+//so handlers pick their behaviour at compile time and the hot path has no quirk branches.
+namespace InstructionLib
+{
+	enum class QuirkProfile : uint8_t
+	{
+		Modern,		//what most current interpreters and test ROMs expect
+		CosmacVIP,	//original 1977 interpreter
+		SuperChip,	//SUPER-CHIP 1.1 on the HP48
+		XoChip		//XO-CHIP (Octo): 64 KB memory, 2 bitplanes, audio pattern buffer
+	};
+
+	//XO-CHIP addresses all of 64 KB, everything else the classic 4 KB
+	constexpr uint32_t GetMemorySize(const QuirkProfile profile)
+	{
+		return profile == QuirkProfile::XoChip ? 0x10000 : 0x1000;
+	}
+
+	//command line and ROM database spelling, in enum order
+	constexpr const char* g_QuirkProfileNames[]{ "modern", "vip", "schip", "xochip" };
+
+	inline bool ParseQuirkProfile(const char* pName, QuirkProfile& profile)
+	{
+		for (uint8_t profileIdx = 0; profileIdx < sizeof(g_QuirkProfileNames) / sizeof(g_QuirkProfileNames[0]); ++profileIdx)
+		{
+			if (std::strcmp(pName, g_QuirkProfileNames[profileIdx]) == 0)
+			{
+				profile = QuirkProfile(profileIdx);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline const char* GetQuirkProfileName(const QuirkProfile profile)
+	{
+		return g_QuirkProfileNames[uint8_t(profile)];
+	}
+
+	struct QuirksModern
+	{
+		//8XY6/8XYE shift Vy into Vx instead of shifting Vx
+		static constexpr bool shiftUsesVy = false;
+		//FX55/FX65 leave I pointing after the last register
+		static constexpr bool loadStoreIncrementsI = false;
+		//BNNN behaves as BXNN: jump to XNN + VX
+		static constexpr bool jumpUsesVx = false;
+		//DXYN wraps sprite pixels around the screen edge instead of clipping them
+		static constexpr bool spritesWrap = true;
+		//8XY1/8XY2/8XY3 reset VF
+		static constexpr bool logicResetsVF = false;
+		//XO-CHIP instructions (F000 NNNN, FN01, 5XY2/5XY3, F002, FX3A, 00DN) and skips over the 4 byte F000 NNNN
+		static constexpr bool xoChip = false;
+	};
+
+	struct QuirksCosmacVIP
+	{
+		static constexpr bool shiftUsesVy = true;
+		static constexpr bool loadStoreIncrementsI = true;
+		static constexpr bool jumpUsesVx = false;
+		static constexpr bool spritesWrap = false;
+		static constexpr bool logicResetsVF = true;
+		static constexpr bool xoChip = false;
+	};
+
+	struct QuirksSuperChip
+	{
+		static constexpr bool shiftUsesVy = false;
+		static constexpr bool loadStoreIncrementsI = false;
+		static constexpr bool jumpUsesVx = true;
+		static constexpr bool spritesWrap = false;
+		static constexpr bool logicResetsVF = false;
+		static constexpr bool xoChip = false;
+	};
+
+	struct QuirksXoChip
+	{
+		static constexpr bool shiftUsesVy = true;
+		static constexpr bool loadStoreIncrementsI = true;
+		static constexpr bool jumpUsesVx = false;
+		static constexpr bool spritesWrap = true;
+		static constexpr bool logicResetsVF = false;
+		static constexpr bool xoChip = true;
+	};
+}
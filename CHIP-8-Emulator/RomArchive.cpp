@@ -0,0 +1,311 @@
+#include "RomArchive.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+RomArchive::RomArchive()
+	:m_pData{}
+	, m_Size{}
+	, m_EntryCount{}
+	, m_pEntries{}
+	, m_pHashOrder{}
+	, m_IsMapped{}
+#ifdef _WIN32
+	, m_hFile{}
+	, m_hMapping{}
+#endif
+{
+}
+
+RomArchive::~RomArchive()
+{
+	Close();
+}
+
+bool RomArchive::Open(const std::string& path)
+{
+	Close();
+	const uint8_t* pMapped = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	m_hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		m_hFile = nullptr;
+	LARGE_INTEGER fileSize{};
+	if (m_hFile && GetFileSizeEx(m_hFile, &fileSize) && fileSize.QuadPart > 0)
+	{
+		m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_hMapping)
+		{
+			pMapped = static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+			size = size_t(fileSize.QuadPart);
+		}
+	}
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd >= 0)
+	{
+		struct stat fileStat {};
+		if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+		{
+			void* pView = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (pView != MAP_FAILED)
+			{
+				pMapped = static_cast<const uint8_t*>(pView);
+				size = size_t(fileStat.st_size);
+			}
+		}
+		//the mapping keeps the file alive
+		close(fd);
+	}
+#endif
+	if (!pMapped)
+	{
+		std::cerr << "Cant map ROM archive " << path << std::endl;
+		Close();
+		return false;
+	}
+	m_pData = pMapped;
+	m_Size = size;
+	m_IsMapped = true;
+	if (!Validate())
+	{
+		std::cerr << path << " is not a valid ROM archive" << std::endl;
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool RomArchive::OpenMemory(const uint8_t* pData, const size_t size)
+{
+	Close();
+	m_pData = pData;
+	m_Size = size;
+	if (!Validate())
+	{
+		std::cerr << "Embedded ROM archive is not valid" << std::endl;
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void RomArchive::Close()
+{
+#ifdef _WIN32
+	if (m_IsMapped && m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_hMapping)
+		CloseHandle(m_hMapping);
+	if (m_hFile)
+		CloseHandle(m_hFile);
+	m_hMapping = nullptr;
+	m_hFile = nullptr;
+#else
+	if (m_IsMapped && m_pData)
+		munmap(const_cast<uint8_t*>(m_pData), m_Size);
+#endif
+	m_pData = nullptr;
+	m_Size = 0;
+	m_EntryCount = 0;
+	m_pEntries = nullptr;
+	m_pHashOrder = nullptr;
+	m_IsMapped = false;
+}
+
+bool RomArchive::Validate()
+{
+	//archives come from disk, every offset is checked once here so lookups can trust them
+	if (m_Size < sizeof(Header))
+		return false;
+	Header header{};
+	std::memcpy(&header, m_pData, sizeof(header));
+	if (header.magic != m_Magic || header.version != m_Version)
+		return false;
+	const uint64_t tablesEnd = sizeof(Header) + uint64_t(header.entryCount) * (sizeof(EntryRecord) + sizeof(uint32_t));
+	if (tablesEnd > m_Size)
+		return false;
+	m_pEntries = reinterpret_cast<const EntryRecord*>(m_pData + sizeof(Header));
+	m_pHashOrder = reinterpret_cast<const uint32_t*>(m_pData + sizeof(Header) + header.entryCount * sizeof(EntryRecord));
+	for (uint32_t entryIdx = 0; entryIdx < header.entryCount; ++entryIdx)
+	{
+		const EntryRecord& record = m_pEntries[entryIdx];
+		if (uint64_t(record.nameOffset) + record.nameLength > m_Size || uint64_t(record.dataOffset) + record.size > m_Size)
+			return false;
+		if (m_pHashOrder[entryIdx] >= header.entryCount)
+			return false;
+	}
+	m_EntryCount = header.entryCount;
+	return true;
+}
+
+RomEntry RomArchive::GetEntry(const uint32_t entryIdx) const
+{
+	const EntryRecord& record = m_pEntries[entryIdx];
+	return RomEntry{ std::string_view(reinterpret_cast<const char*>(m_pData + record.nameOffset), record.nameLength),
+		m_pData + record.dataOffset, record.size, record.hash };
+}
+
+bool RomArchive::FindByName(const std::string_view name, RomEntry& entry) const
+{
+	uint32_t first = 0;
+	uint32_t count = m_EntryCount;
+	//lower bound over the name sorted entries
+	while (count > 0)
+	{
+		const uint32_t half = count / 2;
+		if (GetEntry(first + half).name < name)
+		{
+			first += half + 1;
+			count -= half + 1;
+		}
+		else
+			count = half;
+	}
+	if (first == m_EntryCount || GetEntry(first).name != name)
+		return false;
+	entry = GetEntry(first);
+	return true;
+}
+
+bool RomArchive::FindByHash(const uint64_t hash, RomEntry& entry) const
+{
+	const uint32_t* pFound = std::lower_bound(m_pHashOrder, m_pHashOrder + m_EntryCount, hash,
+		[this](const uint32_t entryIdx, const uint64_t value) { return m_pEntries[entryIdx].hash < value; });
+	if (pFound == m_pHashOrder + m_EntryCount || m_pEntries[*pFound].hash != hash)
+		return false;
+	entry = GetEntry(*pFound);
+	return true;
+}
+
+uint64_t RomArchive::HashContent(const uint8_t* pData, const size_t size)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (size_t byteIdx = 0; byteIdx < size; ++byteIdx)
+	{
+		hash ^= pData[byteIdx];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+namespace
+{
+	struct PackedRom
+	{
+		std::string name;
+		std::vector<uint8_t> data;
+		uint64_t hash;
+	};
+
+	template<typename T>
+	void AppendBytes(std::vector<uint8_t>& archive, const T& value)
+	{
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&value);
+		archive.insert(archive.end(), pBytes, pBytes + sizeof(T));
+	}
+
+	bool WriteEmbeddedHeader(const std::string& path, const std::vector<uint8_t>& archive)
+	{
+		std::ofstream file(path, std::ios::out | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+		file << "#pragma once\n//generated by CHIP-8-Emulator --pack, do not edit\n#include <cstddef>\n#include <cstdint>\n"
+			<< "alignas(8) inline const uint8_t g_EmbeddedRomArchive[] = {";
+		const char* pDigits = "0123456789ABCDEF";
+		for (size_t byteIdx = 0; byteIdx < archive.size(); ++byteIdx)
+		{
+			if (byteIdx % 24 == 0)
+				file << "\n\t";
+			file << "0x" << pDigits[archive[byteIdx] >> 4] << pDigits[archive[byteIdx] & 0xF] << ',';
+		}
+		file << "\n};\ninline const size_t g_EmbeddedRomArchiveSize{ sizeof(g_EmbeddedRomArchive) };\n";
+		return file.good();
+	}
+}
+
+bool RomArchive::Pack(const std::string& outPath, const std::vector<std::string>& directories)
+{
+	std::vector<PackedRom> roms;
+	for (const std::string& directory : directories)
+	{
+		std::error_code error;
+		for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+		{
+			if (!it->is_regular_file())
+				continue;
+			std::ifstream file(it->path(), std::ios::binary | std::ios::in);
+			PackedRom rom{};
+			rom.name = it->path().lexically_relative(directory).generic_string();
+			rom.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			rom.hash = HashContent(rom.data.data(), rom.data.size());
+			roms.push_back(std::move(rom));
+		}
+		if (error)
+		{
+			std::cerr << "Cant read " << directory << ": " << error.message() << std::endl;
+			return false;
+		}
+	}
+	//directories given first win when two contain the same name
+	std::stable_sort(roms.begin(), roms.end(), [](const PackedRom& a, const PackedRom& b) { return a.name < b.name; });
+	roms.erase(std::unique(roms.begin(), roms.end(), [](const PackedRom& a, const PackedRom& b) { return a.name == b.name; }), roms.end());
+
+	const uint32_t entryCount = uint32_t(roms.size());
+	std::vector<uint32_t> hashOrder(entryCount);
+	for (uint32_t entryIdx = 0; entryIdx < entryCount; ++entryIdx)
+		hashOrder[entryIdx] = entryIdx;
+	std::sort(hashOrder.begin(), hashOrder.end(), [&roms](const uint32_t a, const uint32_t b) { return roms[a].hash < roms[b].hash; });
+
+	std::vector<uint8_t> archive;
+	AppendBytes(archive, Header{ m_Magic, m_Version, entryCount, 0 });
+	uint32_t nameOffset = uint32_t(sizeof(Header) + entryCount * (sizeof(EntryRecord) + sizeof(uint32_t)));
+	uint32_t dataOffset = nameOffset;
+	for (const PackedRom& rom : roms)
+		dataOffset += uint32_t(rom.name.size());
+	for (const PackedRom& rom : roms)
+	{
+		AppendBytes(archive, EntryRecord{ rom.hash, nameOffset, uint32_t(rom.name.size()), dataOffset, uint32_t(rom.data.size()) });
+		nameOffset += uint32_t(rom.name.size());
+		dataOffset += uint32_t(rom.data.size());
+	}
+	for (const uint32_t entryIdx : hashOrder)
+		AppendBytes(archive, entryIdx);
+	for (const PackedRom& rom : roms)
+		archive.insert(archive.end(), rom.name.begin(), rom.name.end());
+	for (const PackedRom& rom : roms)
+		archive.insert(archive.end(), rom.data.begin(), rom.data.end());
+
+	const std::string headerExtension{ ".h" };
+	const bool isHeader = outPath.size() >= headerExtension.size() && outPath.compare(outPath.size() - headerExtension.size(), headerExtension.size(), headerExtension) == 0;
+	bool isWritten = false;
+	if (isHeader)
+		isWritten = WriteEmbeddedHeader(outPath, archive);
+	else
+	{
+		std::ofstream file(outPath, std::ios::binary | std::ios::out | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(archive.data()), std::streamsize(archive.size()));
+		isWritten = file.good();
+	}
+	if (!isWritten)
+	{
+		std::cerr << "Cant write " << outPath << std::endl;
+		return false;
+	}
+	std::cout << "Packed " << entryCount << " ROMs into " << outPath << " (" << archive.size() << " bytes)" << std::endl;
+	return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+//one ROM inside an archive, pData points into the mapping and stays valid while the archive is open
+struct RomEntry
+{
+	std::string_view name;
+	const uint8_t* pData;
+	uint32_t size;
+	uint64_t hash;
+};
+
+//Read only pack of many ROMs in one file, opened with a single open/mmap and looked up by name or content hash.
+//Layout (host byte order, all offsets from the start of the archive):
+//  header      magic "C8RA", version, entry count, reserved
+//  entries     {hash, name offset, name length, data offset, size} sorted by name
+//  hash index  entry indices sorted by hash
+//  names, data
+//Built by Pack (--pack), either as a file for Open or as a header with a byte array for OpenMemory.
+class RomArchive final
+{
+public:
+	RomArchive();
+	~RomArchive();
+	RomArchive(const RomArchive& old) = delete;
+	RomArchive(RomArchive&& old) = delete;
+	RomArchive& operator=(const RomArchive& other) = delete;
+	RomArchive& operator=(const RomArchive&& other) = delete;
+
+	//maps the file read only, false when it is missing or not a valid archive
+	bool Open(const std::string& path);
+	//uses an archive that is already in memory (compiled in), not owned
+	bool OpenMemory(const uint8_t* pData, const size_t size);
+	void Close();
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	uint32_t GetEntryCount() const { return m_EntryCount; }
+	//entries are in name order
+	RomEntry GetEntry(const uint32_t entryIdx) const;
+	bool FindByName(const std::string_view name, RomEntry& entry) const;
+	bool FindByHash(const uint64_t hash, RomEntry& entry) const;
+
+	//FNV-1a over the ROM bytes, also what ROMs are identified by outside of archives
+	static uint64_t HashContent(const uint8_t* pData, const size_t size);
+	//build step: packs every file below the directories, named by their path relative to it. An output path ending
+	//in .h gets a C++ header defining g_EmbeddedRomArchive instead of the binary archive
+	static bool Pack(const std::string& outPath, const std::vector<std::string>& directories);
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+	};
+	struct EntryRecord
+	{
+		uint64_t hash;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t dataOffset;
+		uint32_t size;
+	};
+	const static uint32_t m_Magic{ 0x41523843 }; //"C8RA"
+	const static uint32_t m_Version{ 1 };
+
+	const uint8_t* m_pData;
+	size_t m_Size;
+	uint32_t m_EntryCount;
+	const EntryRecord* m_pEntries;
+	const uint32_t* m_pHashOrder;
+	//set when m_pData is our own mapping
+	bool m_IsMapped;
+#ifdef _WIN32
+	void* m_hFile;
+	void* m_hMapping;
+#endif
+
+	bool Validate();
+};
@@ -0,0 +1,60 @@
+#include "RomDatabase.h"
+#include "VirtualMachine.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static_assert(sizeof(RomDatabase::Settings::idleLoops) / sizeof(uint16_t) == VirtualMachine::m_MaxIdleLoops, "idle loop limit has to match the vm");
+
+bool RomDatabase::Load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+		return false;
+	Parse(file);
+	return true;
+}
+
+bool RomDatabase::Load(const char* pText, const size_t size)
+{
+	std::istringstream stream(std::string(pText, size));
+	Parse(stream);
+	return true;
+}
+
+void RomDatabase::Parse(std::istream& stream)
+{
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(stream, line))
+	{
+		++lineNumber;
+		line = line.substr(0, line.find('#'));
+		std::istringstream lineStream(line);
+		uint64_t hash = 0;
+		std::string profileName;
+		std::string keyMap;
+		Settings settings{};
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
+			continue;
+		if (!(lineStream >> std::hex >> hash >> std::dec >> settings.instructionsPerFrame >> profileName >> keyMap)
+			|| !InstructionLib::ParseQuirkProfile(profileName.c_str(), settings.quirkProfile)
+			|| (keyMap != "-" && (keyMap.size() != 16 || keyMap.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)))
+		{
+			std::cerr << "Skipping ROM database line " << lineNumber << ": " << line << std::endl;
+			continue;
+		}
+		for (uint8_t key = 0; key < 16; ++key)
+			settings.keyMap[key] = keyMap == "-" ? key : uint8_t(std::stoul(keyMap.substr(key, 1), nullptr, 16));
+		uint16_t address = 0;
+		while (settings.idleLoopCount < VirtualMachine::m_MaxIdleLoops && lineStream >> std::hex >> address)
+			settings.idleLoops[settings.idleLoopCount++] = address;
+		m_Entries[hash] = settings;
+	}
+}
+
+const RomDatabase::Settings* RomDatabase::Find(const uint64_t romHash) const
+{
+	const auto it = m_Entries.find(romHash);
+	return it != m_Entries.end() ? &it->second : nullptr;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Quirks.h"
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+class VirtualMachine;
+//What a ROM needs to run right at full speed, looked up by content hash (RomArchive::HashContent).
+//Text file, one ROM per line, '#' starts a comment:
+//  <hash> <instructions per frame> <quirk profile> <key map> [idle loop addresses...]
+//hash and addresses are hex, the key map is 16 hex digits (digit N = CHIP-8 key that keypad key N sends) or '-'
+//for 1:1. Roms/roms.c8db holds the bundled ROMs.
+class RomDatabase final
+{
+public:
+	struct Settings
+	{
+		uint16_t instructionsPerFrame;
+		InstructionLib::QuirkProfile quirkProfile;
+		uint8_t keyMap[16];
+		uint16_t idleLoops[4];
+		uint8_t idleLoopCount;
+	};
+
+	bool Load(const std::string& path);
+	//database text that is already in memory (e.g. an archive entry)
+	bool Load(const char* pText, const size_t size);
+	size_t GetEntryCount() const { return m_Entries.size(); }
+	//nullptr for unknown ROMs
+	const Settings* Find(const uint64_t romHash) const;
+private:
+	void Parse(std::istream& stream);
+
+	std::unordered_map<uint64_t, Settings> m_Entries;
+};
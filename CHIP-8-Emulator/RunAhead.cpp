@@ -0,0 +1,71 @@
+#include "RunAhead.h"
+#include "VirtualMachine.h"
+
+RunAhead::RunAhead(const uint32_t frameCount)
+	:m_FrameCount{ frameCount }
+	, m_pFutureVM{ new VirtualMachine() }
+	, m_PresentedHash{}
+	, m_PresentedFrames{}
+	, m_LastFutureInstructions{}
+	, m_TotalCost{}
+	, m_MaxCost{}
+{
+}
+
+RunAhead::~RunAhead()
+{
+	delete m_pFutureVM;
+	m_pFutureVM = nullptr;
+}
+
+void RunAhead::Update(VirtualMachine& vm)
+{
+	Step(vm);
+	Present(vm);
+}
+
+void RunAhead::Step(VirtualMachine& vm)
+{
+	vm.Step();
+
+	const auto start = std::chrono::steady_clock::now();
+	//snapshot: pages stay shared with vm until one of both writes them, dropping it is just the next fork
+	m_pFutureVM->ForkFrom(vm);
+	const uint64_t forkInstructions = m_pFutureVM->GetExecutedInstructions();
+	for (uint32_t frame = 0; frame < m_FrameCount; ++frame)
+		m_pFutureVM->Step();
+	m_LastFutureInstructions = m_pFutureVM->GetExecutedInstructions() - forkInstructions;
+	const std::chrono::nanoseconds cost = std::chrono::steady_clock::now() - start;
+	m_TotalCost += cost;
+	if (cost > m_MaxCost)
+		m_MaxCost = cost;
+
+	//forks always start dirty, only tell the sinks about a change when the future picture really differs
+	const uint64_t hash = m_pFutureVM->GetFrameHash();
+	m_pFutureVM->m_Cpu.displayUpdated = m_PresentedFrames == 0 || hash != m_PresentedHash;
+	m_PresentedHash = hash;
+}
+
+void RunAhead::Present(VirtualMachine& vm)
+{
+	vm.PresentFrame(*m_pFutureVM);
+	++m_PresentedFrames;
+}
+
+double RunAhead::GetAverageMicroseconds() const
+{
+	if (m_PresentedFrames == 0)
+		return 0.0;
+	return std::chrono::duration<double, std::micro>(m_TotalCost).count() / double(m_PresentedFrames);
+}
+
+double RunAhead::GetMaxMicroseconds() const
+{
+	return std::chrono::duration<double, std::micro>(m_MaxCost).count();
+}
+
+void RunAhead::PrintReport(std::ostream& stream) const
+{
+	stream << "run ahead " << m_FrameCount << " frames: " << GetAverageMicroseconds() << " us per frame on average, "
+		<< GetMaxMicroseconds() << " us max over " << m_PresentedFrames << " frames" << std::endl;
+}
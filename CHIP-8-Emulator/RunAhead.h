@@ -0,0 +1,41 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+class VirtualMachine;
+//Run ahead latency reduction: every frame the real vm steps once, a copy of it then runs N frames further with the
+//current input and that future frame is presented instead. Input shows up N frames earlier on screen, the real vm
+//never sees the extra frames. The copy is a fork (see VirtualMachine::ForkFrom), so taking and dropping the snapshot
+//costs a refcount per changed memory page instead of a full SaveState/LoadState round trip.
+class RunAhead final
+{
+public:
+	explicit RunAhead(const uint32_t frameCount);
+	~RunAhead();
+	RunAhead(const RunAhead& old) = delete;
+	RunAhead(RunAhead&& old) = delete;
+	RunAhead& operator=(const RunAhead& other) = delete;
+	RunAhead& operator=(const RunAhead&& other) = delete;
+
+	//replaces vm.Update for one frame, the frame sinks of vm get the future frame
+	void Update(VirtualMachine& vm);
+	//Update in two halves like VirtualMachine::Step/PresentFrame, to time emulation and presentation apart
+	void Step(VirtualMachine& vm);
+	void Present(VirtualMachine& vm);
+	uint32_t GetFrameCount() const { return m_FrameCount; }
+	//instructions the copy ran in the last Step, on top of the ones of the real vm
+	uint64_t GetLastFutureInstructions() const { return m_LastFutureInstructions; }
+	//cost of the extra work (snapshot + N frames) per presented frame, to choose N
+	double GetAverageMicroseconds() const;
+	double GetMaxMicroseconds() const;
+	void PrintReport(std::ostream& stream) const;
+private:
+	const uint32_t m_FrameCount;
+	VirtualMachine* m_pFutureVM;
+	//hash of the last presented picture, the fork itself has no idea what the sinks have seen
+	uint64_t m_PresentedHash;
+	uint64_t m_PresentedFrames;
+	uint64_t m_LastFutureInstructions;
+	std::chrono::nanoseconds m_TotalCost;
+	std::chrono::nanoseconds m_MaxCost;
+};
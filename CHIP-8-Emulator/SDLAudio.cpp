@@ -0,0 +1,58 @@
+#include "SDLAudio.h"
+#include "Beeper.h"
+#include <iostream>
+
+SDLAudio::SDLAudio()
+	:m_Device{}
+	, m_pBeeper{}
+{
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+	{
+		std::cerr << "Cant start SDL audio: " << SDL_GetError() << std::endl;
+		return;
+	}
+
+	SDL_AudioSpec desired{};
+	desired.freq = m_RequestedRate;
+	desired.format = AUDIO_F32SYS;
+	desired.channels = 1;
+	desired.samples = m_RequestedSamples;
+	desired.callback = AudioCallback;
+	desired.userdata = this;
+	SDL_AudioSpec obtained{};
+	//rate and buffer size may differ, format and channels are converted by SDL if needed
+	m_Device = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+	if (m_Device == 0)
+	{
+		std::cerr << "Cant open audio device: " << SDL_GetError() << std::endl;
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		return;
+	}
+
+	//events are scheduled one buffer ahead of the callback, the device holds about another buffer
+	m_pBeeper = new Beeper(uint32_t(obtained.freq), obtained.samples);
+	const float latencyMs = 1000.f * 2.f * obtained.samples / float(obtained.freq);
+	std::cerr << "Audio: " << SDL_GetCurrentAudioDriver() << ", " << obtained.freq << " Hz, " << obtained.samples
+		<< " sample buffer, about " << latencyMs << " ms latency" << std::endl;
+	//devices open paused, the callback only starts once the beeper exists
+	SDL_PauseAudioDevice(m_Device, 0);
+}
+
+SDLAudio::~SDLAudio()
+{
+	if (m_Device != 0)
+	{
+		//stops the callback before the beeper goes away
+		SDL_CloseAudioDevice(m_Device);
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+	}
+	m_Device = 0;
+	delete m_pBeeper;
+	m_pBeeper = nullptr;
+}
+
+void SDLAudio::AudioCallback(void* pUserData, Uint8* pStream, int length)
+{
+	SDLAudio* pAudio = static_cast<SDLAudio*>(pUserData);
+	pAudio->m_pBeeper->Render(reinterpret_cast<float*>(pStream), uint32_t(length / sizeof(float)));
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <SDL.h>
+class Beeper;
+//Opens the default SDL audio device and plays the Beeper from its callback. Set SDL_AUDIODRIVER=dummy to run
+//without a sound card. Works with or without the SDL window, only the audio subsystem is started.
+class SDLAudio final
+{
+public:
+	SDLAudio();
+	~SDLAudio();
+	SDLAudio(const SDLAudio& old) = delete;
+	SDLAudio(SDLAudio&& old) = delete;
+	SDLAudio& operator=(const SDLAudio& other) = delete;
+	SDLAudio& operator=(const SDLAudio&& other) = delete;
+
+	bool IsOpen() const { return m_pBeeper != nullptr; }
+	//frame sink to register with the vm, nullptr when no device could be opened
+	Beeper* GetBeeper() const { return m_pBeeper; }
+private:
+	//small buffers keep the latency down: 256 samples at 48 kHz are 5.3 ms
+	const static int m_RequestedRate{ 48000 };
+	const static Uint16 m_RequestedSamples{ 256 };
+
+	SDL_AudioDeviceID m_Device;
+	Beeper* m_pBeeper;
+
+	static void AudioCallback(void* pUserData, Uint8* pStream, int length);
+};
@@ -0,0 +1,160 @@
+#include "SDLFrontend.h"
+#include "VirtualMachine.h"
+#include "FrameTelemetry.h"
+#include "InputEventQueue.h"
+#include <SDL_main.h>
+#include <cstring>
+
+//1 2 3 4 / Q W E R / A S D F / Z X C V --> 1 2 3 C / 4 5 6 D / 7 8 9 E / A 0 B F
+const SDL_Scancode SDLFrontend::m_KeypadScancodes[16]{
+	SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+	SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+	SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+	SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
+};
+
+SDLFrontend::SDLFrontend(const int& widthScale, const int& heightScale)
+	:m_Pixels{}
+	, m_ScancodeKeys{}
+	, m_pInputQueue{}
+	, m_LastPollTicks{}
+	, m_DroppedFile{}
+	, m_IsNextRomRequested{}
+	, m_pTelemetry{}
+{
+	//scale is relative to the native 64 x 32 screen
+	const int scaledWidth{ widthScale * Framebuffer::m_LoresWidth };
+	const int scaledHeight{ heightScale * Framebuffer::m_LoresHeight };
+	SDL_Init(SDL_INIT_VIDEO);
+	m_Window = SDL_CreateWindow("CHIP-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, scaledWidth, scaledHeight, SDL_WINDOW_SHOWN);
+	//ACCELERATED --> Uses hardware
+	m_Renderer = SDL_CreateRenderer(m_Window, -1, SDL_RENDERER_ACCELERATED);
+	m_Texture = SDL_CreateTexture(m_Renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, m_TextureWidth, m_TextureHeight);
+
+	std::memset(m_ScancodeKeys, -1, sizeof(m_ScancodeKeys));
+	for (uint8_t key = 0; key < 16; ++key)
+		m_ScancodeKeys[m_KeypadScancodes[key]] = int8_t(key);
+	m_LastPollTicks = SDL_GetTicks();
+}
+
+SDLFrontend::~SDLFrontend()
+{
+	SDL_DestroyTexture(m_Texture);
+	SDL_DestroyRenderer(m_Renderer);
+	SDL_DestroyWindow(m_Window);
+	SDL_Quit();
+}
+
+void SDLFrontend::ClearScreen()
+{
+	//Clear everything from prev frame render
+	SDL_RenderClear(m_Renderer);
+	SDL_RenderPresent(m_Renderer);
+	SDL_SetRenderDrawColor(m_Renderer, 1, 1, 1, 1);
+
+}
+
+void SDLFrontend::PublishFrame(const VirtualMachine& vm)
+{
+	//only upload when an opcode touched the pixels, the texture still holds the previous frame otherwise
+	if (vm.IsDisplayUpdated())
+	{
+		const FrameTelemetry::Clock::time_point uploadStart = m_pTelemetry ? FrameTelemetry::Clock::now() : FrameTelemetry::Clock::time_point{};
+		//unpack the planes into palette colors, lores pixels become 2x2 texels
+		const Framebuffer& framebuffer = vm.m_Framebuffer;
+		const uint16_t shift = framebuffer.IsHighRes() ? 0 : 1;
+		for (uint16_t y = 0; y < m_TextureHeight; ++y)
+		{
+			uint32_t* pRow = m_Pixels + y * m_TextureWidth;
+			for (uint16_t x = 0; x < m_TextureWidth; ++x)
+				pRow[x] = m_Palette[framebuffer.GetPixel(x >> shift, y >> shift)];
+		}
+		int pitch = m_TextureWidth * sizeof(uint32_t);
+		SDL_UpdateTexture(m_Texture, nullptr, m_Pixels, pitch);
+		if (m_pTelemetry)
+			m_pTelemetry->Record(FrameTelemetry::TextureUpload, uploadStart, FrameTelemetry::Clock::now());
+	}
+	//copy this frame texture into renderer
+	SDL_RenderClear(m_Renderer);
+	SDL_RenderCopy(m_Renderer, m_Texture, nullptr, nullptr);
+	//present renderer
+	const FrameTelemetry::Clock::time_point presentStart = m_pTelemetry ? FrameTelemetry::Clock::now() : FrameTelemetry::Clock::time_point{};
+	SDL_RenderPresent(m_Renderer);
+	if (m_pTelemetry)
+		m_pTelemetry->Record(FrameTelemetry::Present, presentStart, FrameTelemetry::Clock::now());
+}
+
+bool SDLFrontend::ProcessInput(VirtualMachine& vm)
+{
+	bool quit = false;
+	//the events of the last frame interval are spread over the coming frame at the same relative time
+	const uint32_t pollTicks = SDL_GetTicks();
+	const uint32_t intervalTicks = pollTicks - m_LastPollTicks;
+
+	SDL_Event event;
+
+	while (SDL_PollEvent(&event))
+	{
+		switch (event.type)
+		{
+		case SDL_QUIT:
+		{
+			quit = true;
+		} break;
+
+		case SDL_DROPFILE:
+		{
+			m_DroppedFile = event.drop.file;
+			SDL_free(event.drop.file);
+		} break;
+
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+		{
+			const bool isPressed = event.type == SDL_KEYDOWN;
+			if (isPressed && event.key.keysym.sym == SDLK_ESCAPE)
+				quit = true;
+			else if (isPressed && event.key.keysym.sym == SDLK_TAB)
+				m_IsNextRomRequested = true;
+
+			const int8_t key = m_ScancodeKeys[event.key.keysym.scancode];
+			//auto repeat presses are no key changes
+			if (key < 0 || event.key.repeat)
+				break;
+			const uint8_t chip8Key = vm.m_KeyMap[key];
+			if (!m_pInputQueue)
+			{
+				vm.m_Cpu.input[chip8Key] = isPressed;
+				break;
+			}
+			//SDL timestamps are whole milliseconds, events from before the last poll go at the frame start and events
+			//that came in while polling at its end
+			const int32_t sinceLastPoll = int32_t(event.key.timestamp - m_LastPollTicks);
+			double framePosition = intervalTicks == 0 || sinceLastPoll <= 0 ? 0.0 : double(sinceLastPoll) / double(intervalTicks);
+			framePosition = framePosition < 1.0 ? framePosition : 1.0;
+			const uint64_t cycle = vm.GetCycle() + uint64_t(framePosition * (vm.GetInstructionsPerFrame() - 1) + 0.5);
+			if (!m_pInputQueue->Push(InputEvent{ cycle, chip8Key, isPressed }))
+				vm.m_Cpu.input[chip8Key] = isPressed;
+		} break;
+		}
+	}
+
+	m_LastPollTicks = pollTicks;
+	return quit;
+}
+
+bool SDLFrontend::TakeDroppedFile(std::string& path)
+{
+	if (m_DroppedFile.empty())
+		return false;
+	path.swap(m_DroppedFile);
+	m_DroppedFile.clear();
+	return true;
+}
+
+bool SDLFrontend::TakeNextRomRequest()
+{
+	const bool isRequested = m_IsNextRomRequested;
+	m_IsNextRomRequested = false;
+	return isRequested;
+}
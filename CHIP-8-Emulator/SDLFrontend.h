@@ -0,0 +1,55 @@
+#pragma once
+#include "FrameSink.h"
+#include "Framebuffer.h"
+#include <SDL.h>
+#include <string>
+class VirtualMachine;
+class FrameTelemetry;
+class InputEventQueue;
+class SDLFrontend final : public FrameSink
+{
+public:
+	SDLFrontend(const int& widthScale, const int& heightScale);
+	~SDLFrontend();
+	SDLFrontend(const SDLFrontend& old) = delete;
+	SDLFrontend(SDLFrontend&& old) = delete;
+	SDLFrontend& operator=(const SDLFrontend& other) = delete;
+	SDLFrontend& operator=(const SDLFrontend&& other) = delete;
+
+	void ClearScreen();
+	//key changes go through the ROM's key map into the input queue, stamped with the cycle of the coming frame that
+	//matches when they happened during the last one. Without a queue they are written to vm.m_Cpu.input directly.
+	//Returns true when the user wants to quit
+	bool ProcessInput(VirtualMachine& vm);
+	//nullptr --> write vm.m_Cpu.input at poll time. Not owned
+	void SetInputQueue(InputEventQueue* pInputQueue) { m_pInputQueue = pInputQueue; }
+	//ROM swap requests collected by ProcessInput: a file dropped on the window, Tab for the next ROM of the playlist
+	bool TakeDroppedFile(std::string& path);
+	bool TakeNextRomRequest();
+
+	void PublishFrame(const VirtualMachine& vm) override;
+	//times texture uploads and presents into pTelemetry, nullptr --> no timing. Not owned
+	void SetTelemetry(FrameTelemetry* pTelemetry) { m_pTelemetry = pTelemetry; }
+private:
+	//the texture is always hires sized, lores frames are doubled so switching modes needs no new texture
+	const static uint16_t m_TextureWidth{ Framebuffer::m_HiresWidth };
+	const static uint16_t m_TextureHeight{ Framebuffer::m_HiresHeight };
+	uint32_t m_Pixels[m_TextureWidth * m_TextureHeight];
+	//RGBA per color index, plain CHIP-8 only uses the first 2
+	const uint32_t m_Palette[4]{ 0x000000FF, 0xFFFFFFFF, 0xAAAAAAFF, 0x555555FF };
+
+	//physical key per keypad key 0-F (COSMAC VIP layout on the left of a QWERTY keyboard) and the reverse lookup
+	static const SDL_Scancode m_KeypadScancodes[16];
+	int8_t m_ScancodeKeys[SDL_NUM_SCANCODES];
+	InputEventQueue* m_pInputQueue;
+	//SDL_GetTicks at the previous ProcessInput, events are placed relative to it
+	uint32_t m_LastPollTicks;
+
+	std::string m_DroppedFile;
+	bool m_IsNextRomRequested;
+
+	SDL_Window* m_Window;
+	SDL_Renderer* m_Renderer;
+	SDL_Texture* m_Texture;
+	FrameTelemetry* m_pTelemetry;
+};
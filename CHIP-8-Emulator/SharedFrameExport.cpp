@@ -0,0 +1,130 @@
+#include "SharedFrameExport.h"
+#include "VirtualMachine.h"
+#include "InputEventQueue.h"
+#include <cstring>
+#include <iostream>
+#include <new>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(SharedFrame::Frame::planes) == sizeof(Framebuffer::m_Planes), "shared frame layout has to match the framebuffer");
+
+SharedFrameExport::SharedFrameExport(const std::string& name)
+	:m_Name{ name }
+	, m_pSegment{}
+	, m_LastPollNanoseconds{}
+#ifdef _WIN32
+	, m_hMapping{}
+#endif
+{
+	void* pMapped = nullptr;
+#ifdef _WIN32
+	const std::string mappingName = "Local\\" + m_Name;
+	m_hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, DWORD(sizeof(SharedFrame::Segment)), mappingName.c_str());
+	if (m_hMapping)
+		pMapped = MapViewOfFile(m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedFrame::Segment));
+#else
+	const std::string shmName = "/" + m_Name;
+	const int fd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0600);
+	if (fd >= 0)
+	{
+		if (ftruncate(fd, sizeof(SharedFrame::Segment)) == 0)
+		{
+			pMapped = mmap(nullptr, sizeof(SharedFrame::Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (pMapped == MAP_FAILED)
+				pMapped = nullptr;
+		}
+		close(fd);
+	}
+#endif
+	if (!pMapped)
+	{
+		std::cerr << "Cant create shared memory segment " << m_Name << std::endl;
+		return;
+	}
+
+	//magic goes in last, readers that see it see an initialized segment
+	m_pSegment = new (pMapped) SharedFrame::Segment{};
+	m_pSegment->version = SharedFrame::m_Version;
+	std::atomic_thread_fence(std::memory_order_release);
+	m_pSegment->magic = SharedFrame::m_Magic;
+}
+
+SharedFrameExport::~SharedFrameExport()
+{
+#ifdef _WIN32
+	if (m_pSegment)
+		UnmapViewOfFile(m_pSegment);
+	if (m_hMapping)
+		CloseHandle(m_hMapping);
+	m_hMapping = nullptr;
+#else
+	if (m_pSegment)
+	{
+		munmap(m_pSegment, sizeof(SharedFrame::Segment));
+		//readers that still have it mapped keep their mapping
+		shm_unlink(("/" + m_Name).c_str());
+	}
+#endif
+	m_pSegment = nullptr;
+}
+
+void SharedFrameExport::ApplyInput(VirtualMachine& vm, InputEventQueue* pInputQueue)
+{
+	if (!m_pSegment)
+		return;
+	const uint32_t injected = m_pSegment->injectedInput.load(std::memory_order_acquire);
+	const uint64_t injectedNanoseconds = m_pSegment->injectedNanoseconds.load(std::memory_order_relaxed);
+	const uint64_t pollNanoseconds = SharedFrame::GetNanoseconds();
+	//injected somewhere between the last poll and this one, it lands at the same point of the coming frame (like
+	//keyboard events). Injections from before the last poll go at the frame start
+	double framePosition = 0.0;
+	if (m_LastPollNanoseconds != 0 && pollNanoseconds > m_LastPollNanoseconds && injectedNanoseconds > m_LastPollNanoseconds)
+		framePosition = double(injectedNanoseconds - m_LastPollNanoseconds) / double(pollNanoseconds - m_LastPollNanoseconds);
+	framePosition = framePosition < 1.0 ? framePosition : 1.0;
+	m_LastPollNanoseconds = pollNanoseconds;
+	const uint64_t cycle = vm.GetCycle() + uint64_t(framePosition * (vm.GetInstructionsPerFrame() - 1) + 0.5);
+
+	const uint16_t overrideMask = uint16_t(injected >> 16);
+	for (uint8_t key = 0; key < 16; ++key)
+	{
+		if (!((overrideMask >> key) & 1))
+			continue;
+		//a new injection, or keyboard/movie moved an overridden key away from it last frame
+		const bool isPressed = (injected >> key) & 1;
+		if (isPressed == (vm.m_Cpu.input[key] != 0))
+			continue;
+		if (!pInputQueue || !pInputQueue->Push(InputEvent{ cycle, key, isPressed }))
+			vm.m_Cpu.input[key] = isPressed;
+	}
+}
+
+void SharedFrameExport::PublishFrame(const VirtualMachine& vm)
+{
+	if (!m_pSegment)
+		return;
+
+	//seqlock write: odd while the block is inconsistent, readers retry instead of making us wait
+	SharedFrame::Segment& segment = *m_pSegment;
+	const uint32_t sequence = segment.sequence.load(std::memory_order_relaxed);
+	segment.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	SharedFrame::Frame& frame = segment.frame;
+	++frame.frameCounter;
+	frame.width = vm.GetTextureWidth();
+	frame.height = vm.GetTextureHeight();
+	std::memcpy(frame.input, vm.m_Cpu.input, sizeof(frame.input));
+	//planes only change on dirty frames
+	if (vm.IsDisplayUpdated())
+		std::memcpy(frame.planes, vm.m_Framebuffer.m_Planes, sizeof(frame.planes));
+
+	segment.sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "FrameSink.h"
+#include "SharedFrameLayout.h"
+#include <cstdint>
+#include <string>
+class InputEventQueue;
+//Publishes every frame (packed planes, frame counter, key states) into a named shared memory segment and takes input
+//from it, so monitoring or training processes can watch and drive a running emulator without sockets or copies on
+//their side. POSIX shm_open on Linux/macOS ("/name"), a named file mapping on Windows. See SharedFrameLayout.h.
+class SharedFrameExport final : public FrameSink
+{
+public:
+	explicit SharedFrameExport(const std::string& name);
+	~SharedFrameExport();
+	SharedFrameExport(const SharedFrameExport& old) = delete;
+	SharedFrameExport(SharedFrameExport&& old) = delete;
+	SharedFrameExport& operator=(const SharedFrameExport& other) = delete;
+	SharedFrameExport& operator=(const SharedFrameExport&& other) = delete;
+
+	bool IsOpen() const { return m_pSegment != nullptr; }
+	//queues keys injected by consumers, call before every Update. Without a queue (or when it is full) they are set
+	//directly at the frame start
+	void ApplyInput(VirtualMachine& vm, InputEventQueue* pInputQueue);
+	void PublishFrame(const VirtualMachine& vm) override;
+private:
+	const std::string m_Name;
+	SharedFrame::Segment* m_pSegment;
+	//when ApplyInput last ran, injections since then fall into the coming frame
+	uint64_t m_LastPollNanoseconds;
+#ifdef _WIN32
+	void* m_hMapping;
+#endif
+};
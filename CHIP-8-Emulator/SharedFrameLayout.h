@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+//Layout of the shared memory segment written by SharedFrameExport (--shm <name>).
+//Self contained on purpose: out of process consumers include only this header, they never link the core.
+//
+//Frame block: guarded by a seqlock. The emulator makes sequence odd, writes the block and makes it even again,
+//it never waits for readers. A reader copies the block and retries when sequence was odd or changed meanwhile.
+//Input block: consumers store (override mask << 16 | pressed keys) in injectedInput and the steady clock time they did
+//it at in injectedNanoseconds (InjectInput does both). Before every frame the emulator queues the changed keys in the
+//mask at the point of the frame that matches when they were injected, like keyboard input. Keys outside the mask keep
+//their local (keyboard/movie) state, keys in it are put back to the injected state when local input changed them.
+namespace SharedFrame
+{
+	const uint32_t m_Magic{ 0x42463843 }; //"C8FB"
+	const uint32_t m_Version{ 2 };
+	const uint16_t m_MaxWidth{ 128 };
+	const uint16_t m_MaxHeight{ 64 };
+	const uint8_t m_PlaneCount{ 2 };
+
+	//plain copy of the frame block, what a reader ends up with
+	struct Frame
+	{
+		uint64_t frameCounter;
+		uint16_t width;
+		uint16_t height;
+		//key states (CpuState::input) of the vm as it was for this frame (injected keys included)
+		uint8_t input[16];
+		//1 bit per pixel, 128 bits per row, bit 63 of word 0 is the leftmost pixel. Lores only uses word 0 of the first 32 rows
+		uint64_t planes[m_PlaneCount][m_MaxHeight][2];
+	};
+
+	struct Segment
+	{
+		uint32_t magic;
+		uint32_t version;
+		std::atomic<uint32_t> sequence;
+		std::atomic<uint32_t> injectedInput;
+		//std::chrono::steady_clock since its epoch, the same clock in every process of the machine
+		std::atomic<uint64_t> injectedNanoseconds;
+		Frame frame;
+	};
+
+	static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+		"shared memory atomics have to be lock free to work across processes");
+
+	inline uint64_t GetNanoseconds()
+	{
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	//reader side of the seqlock, spins only while the emulator is in the middle of a write. False when the block was
+	//still busy after maxAttempts tries: the emulator was descheduled in the middle of a write (try again later) or
+	//died in it (every later call fails too)
+	inline bool ReadFrame(const Segment& segment, Frame& frame, const uint32_t maxAttempts = 1u << 20)
+	{
+		for (uint32_t attempt = 0; attempt < maxAttempts; ++attempt)
+		{
+			const uint32_t before = segment.sequence.load(std::memory_order_acquire);
+			if (before & 1)
+				continue;
+			frame = segment.frame;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (segment.sequence.load(std::memory_order_relaxed) == before)
+				return true;
+		}
+		return false;
+	}
+
+	inline void InjectInput(Segment& segment, const uint16_t overrideMask, const uint16_t pressedKeys)
+	{
+		segment.injectedNanoseconds.store(GetNanoseconds(), std::memory_order_relaxed);
+		segment.injectedInput.store(uint32_t(overrideMask) << 16 | (pressedKeys & overrideMask), std::memory_order_release);
+	}
+}
@@ -0,0 +1,106 @@
+//Example consumer of --shm, a separate process that only includes SharedFrameLayout.h. Only compiled with
+//CHIP8_SHM_READER defined, e.g.
+//c++ -std=c++17 -O2 -DCHIP8_SHM_READER SharedFrameReader.cpp -o chip8_shm_reader
+//./CHIP-8-Emulator --headless --shm chip8 ../Roms/brix.rom & ./chip8_shm_reader chip8 50 4
+//Prints the frame as text a few times per second and, when a key is given, holds it for the first half of the run.
+#ifdef CHIP8_SHM_READER
+#include "SharedFrameLayout.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	SharedFrame::Segment* OpenSegment(const std::string& name)
+	{
+		void* pMapped = nullptr;
+#ifdef _WIN32
+		HANDLE hMapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, ("Local\\" + name).c_str());
+		if (hMapping)
+			pMapped = MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedFrame::Segment));
+#else
+		const int fd = shm_open(("/" + name).c_str(), O_RDWR, 0600);
+		if (fd >= 0)
+		{
+			pMapped = mmap(nullptr, sizeof(SharedFrame::Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (pMapped == MAP_FAILED)
+				pMapped = nullptr;
+			close(fd);
+		}
+#endif
+		return static_cast<SharedFrame::Segment*>(pMapped);
+	}
+
+	void PrintFrame(const SharedFrame::Frame& frame)
+	{
+		//one character per pixel pair, hires is halved horizontally to stay inside 80 columns
+		const uint16_t step = frame.width > 64 ? 2 : 1;
+		std::string text;
+		for (uint16_t y = 0; y < frame.height; y += step)
+		{
+			for (uint16_t x = 0; x < frame.width; x += step)
+			{
+				const uint64_t word = frame.planes[0][y][x >> 6] | frame.planes[1][y][x >> 6];
+				text += ((word >> (63 - (x & 63))) & 1) ? '#' : '.';
+			}
+			text += '\n';
+		}
+		std::printf("frame %llu, keys held:", static_cast<unsigned long long>(frame.frameCounter));
+		for (uint8_t key = 0; key < 16; ++key)
+		{
+			if (frame.input[key])
+				std::printf(" %X", key);
+		}
+		std::printf("\n%s\n", text.c_str());
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: chip8_shm_reader <name> [samples] [key to hold]\n");
+		return 1;
+	}
+	const int sampleCount = argc > 2 ? std::atoi(argv[2]) : 20;
+	const int key = argc > 3 ? int(std::strtol(argv[3], nullptr, 16)) & 0xF : -1;
+
+	SharedFrame::Segment* pSegment = OpenSegment(argv[1]);
+	if (!pSegment || pSegment->magic != SharedFrame::m_Magic || pSegment->version != SharedFrame::m_Version)
+	{
+		std::fprintf(stderr, "no emulator segment named %s\n", argv[1]);
+		return 1;
+	}
+
+	SharedFrame::Frame frame;
+	uint64_t lastCounter = 0;
+	for (int sample = 0; sample < sampleCount; ++sample)
+	{
+		if (key >= 0)
+			SharedFrame::InjectInput(*pSegment, uint16_t(1u << key), sample < sampleCount / 2 ? uint16_t(1u << key) : 0);
+		if (!SharedFrame::ReadFrame(*pSegment, frame))
+		{
+			std::fprintf(stderr, "emulator stopped in the middle of a frame\n");
+			return 1;
+		}
+		std::printf("%llu frames since last sample\n", static_cast<unsigned long long>(frame.frameCounter - lastCounter));
+		lastCounter = frame.frameCounter;
+		PrintFrame(frame);
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	}
+	//hand the keys back to the emulator
+	SharedFrame::InjectInput(*pSegment, 0, 0);
+	return 0;
+}
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+//beeper edge, sampleTime counts samples of emulated time (see Beeper)
+struct SoundEvent
+{
+	uint64_t sampleTime;
+	bool isOn;
+};
+
+//Single producer single consumer ring between the emulation thread and the audio callback.
+//Fixed size and lock free: neither side allocates, locks or waits for the other.
+class SoundEventRing final
+{
+public:
+	SoundEventRing()
+		:m_Events{}
+		, m_Head{ 0 }
+		, m_Tail{ 0 }
+	{
+	}
+	SoundEventRing(const SoundEventRing& old) = delete;
+	SoundEventRing(SoundEventRing&& old) = delete;
+	SoundEventRing& operator=(const SoundEventRing& other) = delete;
+	SoundEventRing& operator=(const SoundEventRing&& other) = delete;
+
+	//producer only, false when the consumer fell behind and the ring is full
+	bool Push(const SoundEvent& event)
+	{
+		const uint32_t head = m_Head.load(std::memory_order_relaxed);
+		if (head - m_Tail.load(std::memory_order_acquire) == m_Capacity)
+			return false;
+		m_Events[head & (m_Capacity - 1)] = event;
+		m_Head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	//consumer only, false when empty
+	bool Pop(SoundEvent& event)
+	{
+		const uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+		if (tail == m_Head.load(std::memory_order_acquire))
+			return false;
+		event = m_Events[tail & (m_Capacity - 1)];
+		m_Tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+private:
+	//power of 2, an edge per frame at most so this covers about a second
+	const static uint32_t m_Capacity{ 64 };
+	SoundEvent m_Events[m_Capacity];
+	//own cache lines, producer and consumer only write their own index
+	alignas(64) std::atomic<uint32_t> m_Head;
+	alignas(64) std::atomic<uint32_t> m_Tail;
+};
@@ -0,0 +1,239 @@
+#include "StateExplorer.h"
+#include "VirtualMachine.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+	//xxHash64 style round per 8 bytes, same mixing as the frame hash
+	uint64_t HashState(const std::vector<uint8_t>& state)
+	{
+		const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+		const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+		uint64_t hash = 0x27D4EB2F165667C5ull ^ state.size();
+		size_t idx = 0;
+		for (; idx + 8 <= state.size(); idx += 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, state.data() + idx, sizeof(word));
+			hash ^= ((word * prime2) << 31 | (word * prime2) >> 33) * prime1;
+			hash = (hash << 27 | hash >> 37) * prime1 + 0x85EBCA77C2B2AE63ull;
+		}
+		for (; idx < state.size(); ++idx)
+			hash = (hash ^ state[idx]) * prime1;
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		return hash;
+	}
+
+	//delta layout: runs of [uint32 offset][uint16 length][length bytes] where state differs from the root
+	void EncodeDelta(const std::vector<uint8_t>& root, const std::vector<uint8_t>& state, std::vector<uint8_t>& delta)
+	{
+		delta.clear();
+		const size_t size = state.size();
+		size_t idx = 0;
+		while (idx < size)
+		{
+			if (state[idx] == root[idx])
+			{
+				++idx;
+				continue;
+			}
+			const uint32_t offset = uint32_t(idx);
+			while (idx < size && state[idx] != root[idx] && idx - offset < 0xFFFF)
+				++idx;
+			const uint16_t length = uint16_t(idx - offset);
+			const uint8_t* pOffset = reinterpret_cast<const uint8_t*>(&offset);
+			const uint8_t* pLength = reinterpret_cast<const uint8_t*>(&length);
+			delta.insert(delta.end(), pOffset, pOffset + sizeof(offset));
+			delta.insert(delta.end(), pLength, pLength + sizeof(length));
+			delta.insert(delta.end(), state.begin() + offset, state.begin() + idx);
+		}
+	}
+
+	void DecodeDelta(const std::vector<uint8_t>& root, const std::vector<uint8_t>& delta, std::vector<uint8_t>& state)
+	{
+		state = root;
+		size_t idx = 0;
+		while (idx < delta.size())
+		{
+			uint32_t offset;
+			uint16_t length;
+			std::memcpy(&offset, delta.data() + idx, sizeof(offset));
+			std::memcpy(&length, delta.data() + idx + sizeof(offset), sizeof(length));
+			idx += sizeof(offset) + sizeof(length);
+			std::memcpy(state.data() + offset, delta.data() + idx, length);
+			idx += length;
+		}
+	}
+}
+
+StateExplorer::StateHashSet::StateHashSet(const uint64_t minCapacity)
+	:m_pSlots{}
+	, m_Mask{}
+{
+	uint64_t capacity = 1024;
+	while (capacity < minCapacity)
+		capacity <<= 1;
+	m_pSlots.reset(new std::atomic<uint64_t>[capacity]);
+	for (uint64_t idx = 0; idx < capacity; ++idx)
+		m_pSlots[idx].store(0, std::memory_order_relaxed);
+	m_Mask = capacity - 1;
+}
+
+bool StateExplorer::StateHashSet::Insert(uint64_t hash)
+{
+	//0 marks an empty slot
+	if (hash == 0)
+		hash = 1;
+	uint64_t slot = hash & m_Mask;
+	for (uint64_t probe = 0; probe <= m_Mask; ++probe, slot = (slot + 1) & m_Mask)
+	{
+		uint64_t stored = m_pSlots[slot].load(std::memory_order_relaxed);
+		if (stored == 0 && m_pSlots[slot].compare_exchange_strong(stored, hash, std::memory_order_relaxed))
+			return true;
+		//either already filled or another worker won the CAS, stored now holds the winner
+		if (stored == hash)
+			return false;
+	}
+	//full, sized so this cant happen below maxStates
+	return false;
+}
+
+StateExplorer::StateExplorer(const VirtualMachine& root, const uint32_t threadCount, const uint64_t maxStates)
+	:m_ThreadCount{ threadCount > 0 ? threadCount : 1 }
+	, m_MaxStates{ maxStates }
+	, m_RootState{}
+	, m_Visited{ maxStates * 2 }
+	, m_UniqueStates{}
+	, m_SteppedStates{}
+	, m_IsStateLimitHit{}
+	, m_Frontier{}
+	, m_Workers{}
+{
+	root.SaveState(m_RootState);
+	for (uint32_t workerIdx = 0; workerIdx < m_ThreadCount; ++workerIdx)
+	{
+		std::unique_ptr<Worker> pWorker{ new Worker() };
+		pWorker->pVM.reset(new VirtualMachine());
+		//profile, instructions per frame, idle loops and key map of the root, LoadState only brings the machine state
+		pWorker->pVM->ForkFrom(root);
+		m_Workers.push_back(std::move(pWorker));
+	}
+}
+
+StateExplorer::~StateExplorer() = default;
+
+StateExplorer::Result StateExplorer::Run(const uint32_t maxDepth)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+	m_Visited.Insert(HashState(m_RootState));
+	m_UniqueStates = 1;
+	//the root is its own empty delta
+	m_Frontier.assign(1, std::vector<uint8_t>{});
+
+	uint32_t depth = 0;
+	while (depth < maxDepth && !m_Frontier.empty() && !m_IsStateLimitHit)
+	{
+		//hand out chunks round robin, stealing evens out whatever the split gets wrong
+		const uint32_t chunkCount = uint32_t((m_Frontier.size() + m_ChunkSize - 1) / m_ChunkSize);
+		for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+			m_Workers[chunk % m_ThreadCount]->chunks.push_back(chunk);
+
+		std::vector<std::thread> threads;
+		for (uint32_t workerIdx = 1; workerIdx < m_ThreadCount; ++workerIdx)
+			threads.emplace_back(&StateExplorer::WorkerLoop, this, workerIdx);
+		WorkerLoop(0);
+		for (std::thread& thread : threads)
+			thread.join();
+
+		m_Frontier.clear();
+		for (std::unique_ptr<Worker>& pWorker : m_Workers)
+		{
+			for (std::vector<uint8_t>& delta : pWorker->nextFrontier)
+				m_Frontier.push_back(std::move(delta));
+			pWorker->nextFrontier.clear();
+		}
+		++depth;
+		std::cout << "depth " << depth << ": " << m_Frontier.size() << " new states, " << m_UniqueStates << " total" << std::endl;
+	}
+
+	Result result{};
+	result.uniqueStates = m_UniqueStates;
+	result.steppedStates = m_SteppedStates;
+	result.reachedDepth = depth;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	result.isStateLimitHit = m_IsStateLimitHit;
+	return result;
+}
+
+void StateExplorer::WorkerLoop(const uint32_t workerIdx)
+{
+	Worker& worker = *m_Workers[workerIdx];
+	uint32_t chunk;
+	while (TakeChunk(workerIdx, chunk))
+	{
+		const size_t first = size_t(chunk) * m_ChunkSize;
+		const size_t last = first + m_ChunkSize < m_Frontier.size() ? first + m_ChunkSize : m_Frontier.size();
+		for (size_t node = first; node < last && !m_IsStateLimitHit; ++node)
+			ExpandNode(worker, m_Frontier[node]);
+	}
+}
+
+bool StateExplorer::TakeChunk(const uint32_t workerIdx, uint32_t& chunk)
+{
+	{
+		Worker& worker = *m_Workers[workerIdx];
+		std::lock_guard<std::mutex> lock(worker.queueMutex);
+		if (!worker.chunks.empty())
+		{
+			chunk = worker.chunks.back();
+			worker.chunks.pop_back();
+			return true;
+		}
+	}
+	//no chunks are added during a level, so once every queue is empty the level is done
+	for (uint32_t offset = 1; offset < m_ThreadCount; ++offset)
+	{
+		Worker& victim = *m_Workers[(workerIdx + offset) % m_ThreadCount];
+		std::lock_guard<std::mutex> lock(victim.queueMutex);
+		if (!victim.chunks.empty())
+		{
+			chunk = victim.chunks.front();
+			victim.chunks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void StateExplorer::ExpandNode(Worker& worker, const std::vector<uint8_t>& delta)
+{
+	VirtualMachine& vm = *worker.pVM;
+	DecodeDelta(m_RootState, delta, worker.parentState);
+	m_SteppedStates += m_InputCount;
+	for (uint8_t input = 0; input < m_InputCount; ++input)
+	{
+		vm.LoadState(worker.parentState);
+		std::memset(vm.m_Cpu.input, 0, sizeof(vm.m_Cpu.input));
+		if (input < sizeof(vm.m_Cpu.input))
+			vm.m_Cpu.input[input] = 1;
+		vm.Update();
+		//released again so the held key itself does not make otherwise equal states differ
+		std::memset(vm.m_Cpu.input, 0, sizeof(vm.m_Cpu.input));
+		vm.SaveState(worker.childState);
+
+		if (!m_Visited.Insert(HashState(worker.childState)))
+			continue;
+		if (++m_UniqueStates > m_MaxStates)
+		{
+			m_IsStateLimitHit = true;
+			return;
+		}
+		worker.nextFrontier.emplace_back();
+		EncodeDelta(m_RootState, worker.childState, worker.nextFrontier.back());
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "Quirks.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+class VirtualMachine;
+//Breadth first search over the input space of a ROM, run with --explore.
+//From every reached state each of the 16 keys (and no key) is held for one frame, the resulting machine state is
+//hashed and only unseen states are expanded further. A level is split into chunks that worker threads take from
+//their own queue and steal from the others once it runs dry.
+class StateExplorer final
+{
+public:
+	struct Result
+	{
+		uint64_t uniqueStates;
+		uint64_t steppedStates;
+		uint32_t reachedDepth;
+		double seconds;
+		//search stopped early because maxStates was reached
+		bool isStateLimitHit;
+	};
+
+	//the root state is copied, the vm itself is not used after construction
+	StateExplorer(const VirtualMachine& root, const uint32_t threadCount, const uint64_t maxStates);
+	~StateExplorer();
+	StateExplorer(const StateExplorer& old) = delete;
+	StateExplorer(StateExplorer&& old) = delete;
+	StateExplorer& operator=(const StateExplorer& other) = delete;
+	StateExplorer& operator=(const StateExplorer&& other) = delete;
+
+	Result Run(const uint32_t maxDepth);
+private:
+	//inputs tried per state: keys 0-F held alone, then no key
+	static const uint8_t m_InputCount{ 17 };
+	//frontier nodes handed out per queue entry
+	static const uint32_t m_ChunkSize{ 64 };
+
+	//open addressing set of 64 bit state hashes, inserted with a CAS per slot so workers never take a lock
+	class StateHashSet
+	{
+	public:
+		explicit StateHashSet(const uint64_t minCapacity);
+		//true when the hash was not in the set yet
+		bool Insert(uint64_t hash);
+	private:
+		std::unique_ptr<std::atomic<uint64_t>[]> m_pSlots;
+		uint64_t m_Mask;
+	};
+
+	struct Worker
+	{
+		std::unique_ptr<VirtualMachine> pVM;
+		std::vector<uint8_t> parentState;
+		std::vector<uint8_t> childState;
+		//states this worker discovered for the next level
+		std::vector<std::vector<uint8_t>> nextFrontier;
+		//chunks of the current level, the owner pops from the back and thieves take from the front
+		std::mutex queueMutex;
+		std::deque<uint32_t> chunks;
+	};
+
+	void WorkerLoop(const uint32_t workerIdx);
+	bool TakeChunk(const uint32_t workerIdx, uint32_t& chunk);
+	void ExpandNode(Worker& worker, const std::vector<uint8_t>& delta);
+
+	const uint32_t m_ThreadCount;
+	const uint64_t m_MaxStates;
+	std::vector<uint8_t> m_RootState;
+	StateHashSet m_Visited;
+	std::atomic<uint64_t> m_UniqueStates;
+	std::atomic<uint64_t> m_SteppedStates;
+	std::atomic<bool> m_IsStateLimitHit;
+
+	//frontier states are stored as changed byte runs against the root state
+	std::vector<std::vector<uint8_t>> m_Frontier;
+	std::vector<std::unique_ptr<Worker>> m_Workers;
+};
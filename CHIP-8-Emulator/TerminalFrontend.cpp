@@ -0,0 +1,103 @@
+#include "TerminalFrontend.h"
+#include "VirtualMachine.h"
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	//utf-8 encoded glyph per Cell value
+	const char* const g_CellGlyphs[4]{ " ", "\xE2\x96\x80", "\xE2\x96\x84", "\xE2\x96\x88" };
+}
+
+TerminalFrontend::TerminalFrontend(const int outputFd)
+	:m_OutputFd{ outputFd }
+	, m_Columns{}
+	, m_Rows{}
+{
+	m_OutBuffer.reserve(0x4000);
+}
+
+TerminalFrontend::~TerminalFrontend()
+{
+	//leave the cursor below the picture and make it visible again
+	m_OutBuffer.clear();
+	AppendCursorMove(m_Rows, 0);
+	m_OutBuffer += "\x1b[0m\x1b[?25h\n";
+	Flush();
+}
+
+void TerminalFrontend::PublishFrame(const VirtualMachine& vm)
+{
+	const uint16_t width = vm.GetTextureWidth();
+	const uint16_t height = vm.GetTextureHeight();
+	const uint16_t rows = (height + 1) / 2;
+
+	if (width != m_Columns || rows != m_Rows)
+	{
+		//first frame or resolution change --> clear terminal and hide cursor, every cell is blank afterwards
+		m_Columns = width;
+		m_Rows = rows;
+		m_Cells.assign(size_t(m_Columns) * m_Rows, Empty);
+		m_OutBuffer += "\x1b[?25l\x1b[2J";
+	}
+	else if (!vm.IsDisplayUpdated())
+	{
+		//idle frame, nothing to send
+		return;
+	}
+
+	//position the terminal cursor will be at after the last glyph, avoids a move escape for runs of changed cells
+	uint16_t cursorRow = 0xFFFF;
+	uint16_t cursorCol = 0xFFFF;
+	const Framebuffer& framebuffer = vm.m_Framebuffer;
+	for (uint16_t row = 0; row < m_Rows; ++row)
+	{
+		const uint16_t upperY = row * 2;
+		const bool hasLower = upperY + 1 < height;
+		uint8_t* pCells = m_Cells.data() + size_t(row) * m_Columns;
+		for (uint16_t col = 0; col < m_Columns; ++col)
+		{
+			const bool isUpperOn = framebuffer.GetPixel(col, upperY);
+			const bool isLowerOn = hasLower && framebuffer.GetPixel(col, upperY + 1);
+			const uint8_t cell = uint8_t((isUpperOn ? Upper : Empty) | (isLowerOn ? Lower : Empty));
+			if (cell == pCells[col])
+				continue;
+			pCells[col] = cell;
+
+			if (row != cursorRow || col != cursorCol)
+				AppendCursorMove(row, col);
+			m_OutBuffer += g_CellGlyphs[cell];
+			cursorRow = row;
+			cursorCol = col + 1;
+		}
+	}
+	Flush();
+}
+
+void TerminalFrontend::AppendCursorMove(const uint16_t row, const uint16_t col)
+{
+	//ANSI positions are 1 based
+	m_OutBuffer += "\x1b[";
+	m_OutBuffer += std::to_string(row + 1);
+	m_OutBuffer += ';';
+	m_OutBuffer += std::to_string(col + 1);
+	m_OutBuffer += 'H';
+}
+
+void TerminalFrontend::Flush()
+{
+	size_t written = 0;
+	while (written < m_OutBuffer.size())
+	{
+		//a single call in practice, only loops on a short write (e.g. full pipe)
+		const auto result = write(m_OutputFd, m_OutBuffer.data() + written, unsigned(m_OutBuffer.size() - written));
+		if (result <= 0)
+			break;
+		written += size_t(result);
+	}
+	m_OutBuffer.clear();
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "FrameSink.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+//Draws the framebuffer with unicode half blocks (2 pixel rows per character cell) using ANSI escapes,
+//meant for checking headless instances over ssh. Only cells that changed since the last frame are sent.
+class TerminalFrontend final : public FrameSink
+{
+public:
+	explicit TerminalFrontend(const int outputFd = 1);
+	~TerminalFrontend();
+	TerminalFrontend(const TerminalFrontend& old) = delete;
+	TerminalFrontend(TerminalFrontend&& old) = delete;
+	TerminalFrontend& operator=(const TerminalFrontend& other) = delete;
+	TerminalFrontend& operator=(const TerminalFrontend&& other) = delete;
+
+	void PublishFrame(const VirtualMachine& vm) override;
+private:
+	//cell value: bit 0 --> upper pixel on, bit 1 --> lower pixel on
+	enum Cell : uint8_t { Empty = 0, Upper = 1, Lower = 2, Full = 3 };
+
+	void AppendCursorMove(const uint16_t row, const uint16_t col);
+	void Flush();
+
+	const int m_OutputFd;
+	uint16_t m_Columns;
+	uint16_t m_Rows;
+	//what the terminal currently shows
+	std::vector<uint8_t> m_Cells;
+	//whole frame is built here and written with one write()
+	std::string m_OutBuffer;
+};
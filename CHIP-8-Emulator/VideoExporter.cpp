@@ -0,0 +1,195 @@
+#include "VideoExporter.h"
+#include "VirtualMachine.h"
+#include <iostream>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace
+{
+	//queued instead of a buffer index when a frame is identical to the previous one, the writer repeats its last buffer
+	const int g_RepeatFrame = -1;
+	//luma per color index, plain CHIP-8 only uses the first 2
+	const uint8_t g_LumaPalette[4]{ 0x00, 0xFF, 0xAA, 0x55 };
+}
+
+VideoExporter::VideoExporter(const std::string& path, const Format format, const uint32_t frameInterval)
+	:m_pFile{}
+	, m_Format{ format }
+	, m_FrameInterval{ frameInterval > 0 ? frameInterval : 1 }
+	, m_FrameCounter{}
+	, m_IsDrawnSinceWrite{ false }
+	, m_Width{}
+	, m_Height{}
+	, m_StallCount{}
+	, m_IsStopping{ false }
+{
+	if (path == "-")
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		m_pFile = stdout;
+	}
+	else
+	{
+		m_pFile = std::fopen(path.c_str(), "wb");
+	}
+
+	if (!m_pFile)
+	{
+		std::cerr << "Cant open video output " << path << std::endl;
+		return;
+	}
+
+	m_Buffers.resize(m_PoolSize);
+	for (int i = int(m_PoolSize) - 1; i >= 0; --i)
+		m_FreeBuffers.push_back(i);
+	m_Writer = std::thread(&VideoExporter::WriterLoop, this);
+}
+
+VideoExporter::~VideoExporter()
+{
+	if (!m_pFile)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IsStopping = true;
+	}
+	m_FrameReady.notify_one();
+	m_Writer.join();
+
+	if (m_pFile == stdout)
+		std::fflush(m_pFile);
+	else
+		std::fclose(m_pFile);
+
+	if (m_StallCount > 0)
+		std::cerr << "Video export stalled emulation " << m_StallCount << " times" << std::endl;
+}
+
+void VideoExporter::PublishFrame(const VirtualMachine& vm)
+{
+	if (!m_pFile)
+		return;
+	//the display flag only lasts for the frame it was set in, draws of skipped frames have to be remembered
+	m_IsDrawnSinceWrite = m_IsDrawnSinceWrite || vm.IsDisplayUpdated();
+	if (m_FrameCounter++ % m_FrameInterval != 0)
+		return;
+	const bool isDisplayUpdated = m_IsDrawnSinceWrite;
+	m_IsDrawnSinceWrite = false;
+
+	//stream is always hires sized, the container cant change dimensions when a ROM switches modes
+	const bool isFirstFrame = m_Width == 0;
+	if (isFirstFrame)
+	{
+		m_Width = Framebuffer::m_HiresWidth;
+		m_Height = Framebuffer::m_HiresHeight;
+	}
+
+	//neither container has per frame durations so a duplicate still has to be written,
+	//but unchanged frames skip the copy and conversion on the emulation thread
+	if (!isFirstFrame && !isDisplayUpdated)
+	{
+		QueueFrame(g_RepeatFrame);
+		return;
+	}
+
+	int bufferIdx;
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		if (m_FreeBuffers.empty())
+		{
+			//writer fell a whole pool behind, wait instead of dropping frames from the recording
+			++m_StallCount;
+			m_BufferFreed.wait(lock, [this] { return !m_FreeBuffers.empty(); });
+		}
+		bufferIdx = m_FreeBuffers.back();
+		m_FreeBuffers.pop_back();
+	}
+
+	//convert the planes to 8 bit luma (lores pixels doubled), the buffer is owned by this thread until it is queued
+	std::vector<uint8_t>& luma = m_Buffers[bufferIdx];
+	luma.resize(size_t(m_Width) * m_Height);
+	const Framebuffer& framebuffer = vm.m_Framebuffer;
+	const uint16_t shift = framebuffer.IsHighRes() ? 0 : 1;
+	for (uint16_t y = 0; y < m_Height; ++y)
+	{
+		uint8_t* pRow = luma.data() + size_t(y) * m_Width;
+		for (uint16_t x = 0; x < m_Width; ++x)
+			pRow[x] = g_LumaPalette[framebuffer.GetPixel(x >> shift, y >> shift)];
+	}
+
+	QueueFrame(bufferIdx);
+}
+
+void VideoExporter::QueueFrame(const int bufferIdx)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		if (m_PendingFrames.size() >= m_MaxPendingFrames)
+		{
+			//stalled encoder or pipe, wait like for a buffer instead of dropping frames from the recording
+			++m_StallCount;
+			m_FrameTaken.wait(lock, [this] { return m_PendingFrames.size() < m_MaxPendingFrames; });
+		}
+		m_PendingFrames.push_back(bufferIdx);
+	}
+	m_FrameReady.notify_one();
+}
+
+void VideoExporter::WriterLoop()
+{
+	//header is written lazily, dimensions are only known once the first frame arrives
+	bool isHeaderWritten = false;
+	int lastBufferIdx = g_RepeatFrame;
+	while (true)
+	{
+		int bufferIdx;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_FrameReady.wait(lock, [this] { return m_IsStopping || !m_PendingFrames.empty(); });
+			if (m_PendingFrames.empty())
+				break;
+			bufferIdx = m_PendingFrames.front();
+			m_PendingFrames.pop_front();
+		}
+		m_FrameTaken.notify_one();
+
+		if (!isHeaderWritten && m_Format == Format::Y4M)
+		{
+			//mono luma only, 60 fps emulated frames divided by the export interval
+			std::fprintf(m_pFile, "YUV4MPEG2 W%u H%u F60:%u Ip A1:1 Cmono\n", unsigned(m_Width), unsigned(m_Height), unsigned(m_FrameInterval));
+			isHeaderWritten = true;
+		}
+
+		if (bufferIdx == g_RepeatFrame)
+		{
+			WriteFrame(m_Buffers[lastBufferIdx]);
+			continue;
+		}
+
+		WriteFrame(m_Buffers[bufferIdx]);
+		//keep the newest buffer around for repeats, hand the previous one back to the pool
+		if (lastBufferIdx != g_RepeatFrame)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_FreeBuffers.push_back(lastBufferIdx);
+			}
+			m_BufferFreed.notify_one();
+		}
+		lastBufferIdx = bufferIdx;
+	}
+}
+
+void VideoExporter::WriteFrame(const std::vector<uint8_t>& luma)
+{
+	if (m_Format == Format::Y4M)
+		std::fputs("FRAME\n", m_pFile);
+	else
+		std::fprintf(m_pFile, "P5\n%u %u\n255\n", unsigned(m_Width), unsigned(m_Height));
+	std::fwrite(luma.data(), 1, luma.size(), m_pFile);
+}
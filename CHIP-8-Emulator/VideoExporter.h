@@ -0,0 +1,59 @@
+#pragma once
+#include "FrameSink.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+//Streams presented frames as raw video (YUV4MPEG2 mono or concatenated binary PGM) to a file or stdout ("-"),
+//so it can be piped into an encoder. Frames are handed to a writer thread through a fixed pool of buffers and a
+//bounded queue, a writer that falls behind makes emulation wait instead of memory grow.
+class VideoExporter final : public FrameSink
+{
+public:
+	enum class Format { Y4M, PGM };
+
+	//frameInterval: only every Nth presented frame is written
+	VideoExporter(const std::string& path, const Format format, const uint32_t frameInterval = 1);
+	~VideoExporter();
+	VideoExporter(const VideoExporter& old) = delete;
+	VideoExporter(VideoExporter&& old) = delete;
+	VideoExporter& operator=(const VideoExporter& other) = delete;
+	VideoExporter& operator=(const VideoExporter&& other) = delete;
+
+	bool IsOpen() const { return m_pFile != nullptr; }
+	void PublishFrame(const VirtualMachine& vm) override;
+private:
+	static const size_t m_PoolSize{ 32 };
+	//repeats of unchanged frames take no buffer, this caps them (and everything else) in the queue
+	static const size_t m_MaxPendingFrames{ 256 };
+
+	//waits while the queue is full
+	void QueueFrame(const int bufferIdx);
+	void WriterLoop();
+	void WriteFrame(const std::vector<uint8_t>& luma);
+
+	std::FILE* m_pFile;
+	const Format m_Format;
+	const uint32_t m_FrameInterval;
+	uint32_t m_FrameCounter;
+	//a frame since the last written one (this one included) drew something
+	bool m_IsDrawnSinceWrite;
+	uint16_t m_Width;
+	uint16_t m_Height;
+	//emulation thread had to wait for a free buffer or queue slot this many times
+	uint32_t m_StallCount;
+
+	std::vector<std::vector<uint8_t>> m_Buffers;
+	std::vector<int> m_FreeBuffers;
+	std::deque<int> m_PendingFrames;
+	bool m_IsStopping;
+	std::mutex m_Mutex;
+	std::condition_variable m_FrameReady;
+	std::condition_variable m_BufferFreed;
+	std::condition_variable m_FrameTaken;
+	std::thread m_Writer;
+};
@@ -1,421 +1,557 @@
 #include "VirtualMachine.h"
 #include "InstructionLib.h"
-#include <SDL_main.h>
-#include <SDL.h>
+#include "FrameSink.h"
+#include "RomArchive.h"
+#include "Debugger.h"
+#include "InputEventQueue.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
-VirtualMachine::VirtualMachine(const int& width, const int& height)
-	:m_TextureHeight{ 32 }
-	, m_TextureWidth{ 64 }
-	, m_Vi{}
-	, m_Vx{}
-	, m_DT{}
-	, m_ST{}
-	, m_Input{}
+#include <cstring>
+#include <iterator>
+VirtualMachine::VirtualMachine()
+	:m_Cpu{}
+	, m_pOpcodeManager{}
+	, m_MemSize{}
+	, m_MemAddressMask{}
+	, m_InstructionsPerFrame{ 1 }
+	, m_IdleLoops{}
+	, m_IdleLoopCount{}
+	, m_FrameEnd{ FrameEnd::Complete }
+	, m_Cycle{}
+	, m_ExecutedInstructions{}
+	, m_Framebuffer{}
 	, m_Memory{}
-	, m_PC{}
-	, m_Stack{}
-	, m_PixelArray{}
-	, m_ScreenDimensions{}
+	, m_KeyMap{}
+	, m_RomHash{}
+	, m_pDebugger{}
+	, m_pInputQueue{}
 {
-	Init(width, height);
+	Init();
 }
 
 VirtualMachine::~VirtualMachine()
 {
-	delete m_pOpcodeManager;
 	m_pOpcodeManager = nullptr;
-	SDL_DestroyTexture(m_Texture);
-	SDL_DestroyRenderer(m_Renderer);
-	SDL_DestroyWindow(m_Window);
-	SDL_Quit();
 }
 
-void VirtualMachine::Init(const int& widthScale, const int& heightScale)
+void VirtualMachine::Init()
 {
-	
-	InitSDL(widthScale, heightScale);
-	InitFont();
-	m_PC = m_ProgramMemStart;
-	m_pOpcodeManager = new InstructionLib::OpcodeManager();
-	m_ScreenDimensions.width = m_TextureWidth;
-	m_ScreenDimensions.height = m_TextureHeight;
+	m_pOpcodeManager = InstructionLib::GetOpcodeManager(InstructionLib::QuirkProfile::Modern);
+	for (uint8_t key = 0; key < 16; ++key)
+		m_KeyMap[key] = key;
+	AllocateMemory(InstructionLib::GetMemorySize(InstructionLib::QuirkProfile::Modern));
+	Reset();
 }
 
-void VirtualMachine::InitSDL(const int& widthScale, const int& heightScale)
+void VirtualMachine::AllocateMemory(const uint32_t memSize)
 {
-	const int scaledWidth{ widthScale * m_TextureWidth };
-	const int scaledHeight{ heightScale * m_TextureHeight };
-	SDL_Init(SDL_INIT_VIDEO);
-	m_Window = SDL_CreateWindow("CHIP-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, scaledWidth, scaledHeight, SDL_WINDOW_SHOWN);
-	//ACCELERATED --> Uses hardware
-	m_Renderer = SDL_CreateRenderer(m_Window, -1, SDL_RENDERER_ACCELERATED);
-	m_Texture = SDL_CreateTexture(m_Renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, m_TextureWidth, m_TextureHeight);
+	//new memory reads as 0 and only costs a page once written
+	m_Memory.Resize(memSize);
+	m_MemSize = memSize;
+	m_MemAddressMask = uint16_t(memSize - 1);
 }
 
-void VirtualMachine::InitFont()
+void VirtualMachine::Reset()
+{
+	m_Memory.ShareFrom(GetMemoryTemplate(m_MemSize));
+	m_Framebuffer.Reset();
+	std::memset(m_Cpu.stack, 0, sizeof(m_Cpu.stack));
+	std::memset(m_Cpu.rplFlags, 0, sizeof(m_Cpu.rplFlags));
+	std::memset(m_Cpu.audioPattern, 0, sizeof(m_Cpu.audioPattern));
+	m_Cpu.audioPitch = 64;
+	std::memset(m_Cpu.vx, 0, sizeof(m_Cpu.vx));
+	std::memset(m_Cpu.input, 0, sizeof(m_Cpu.input));
+	m_Cpu.vi = 0;
+	m_Cpu.dt = 0;
+	m_Cpu.st = 0;
+	m_Cpu.sp = 0;
+	m_Cpu.pc = m_ProgramMemStart;
+	m_Cpu.randomState = m_RandomSeed;
+	m_Cpu.displayUpdated = true;
+	m_FrameEnd = FrameEnd::Complete;
+}
+
+void VirtualMachine::SetQuirkProfile(const InstructionLib::QuirkProfile profile)
+{
+	if (profile == GetQuirkProfile())
+		return;
+	m_pOpcodeManager = InstructionLib::GetOpcodeManager(profile);
+	AllocateMemory(InstructionLib::GetMemorySize(profile));
+}
+
+InstructionLib::QuirkProfile VirtualMachine::GetQuirkProfile() const
+{
+	return m_pOpcodeManager->GetQuirkProfile();
+}
+
+const PagedMemory& VirtualMachine::GetMemoryTemplate(const uint32_t memSize)
+{
+	//leaked on purpose, vms destroyed during static destruction may still hold its pages
+	static const PagedMemory* s_pClassic = []()
+	{
+		PagedMemory* pMemory = new PagedMemory();
+		pMemory->Resize(m_ClassicMemSize);
+		uint8_t image[m_ClassicMemSize]{};
+		InitFont(image);
+		pMemory->Write(0, image, m_ClassicMemSize);
+		return pMemory;
+	}();
+	//XO-CHIP: same font pages, everything above 4 KB is the shared zero page
+	static const PagedMemory* s_pXoChip = []()
+	{
+		PagedMemory* pMemory = new PagedMemory();
+		pMemory->ShareFrom(*s_pClassic);
+		pMemory->Resize(m_MaxMemSize);
+		return pMemory;
+	}();
+	return memSize > m_ClassicMemSize ? *s_pXoChip : *s_pClassic;
+}
+
+void VirtualMachine::InitFont(uint8_t* pMemory)
 {
 	//http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#3.1
 	// 80 bytes are font loaded in interpreter memory (interpreter are 1st 512 bytes --> 0x000 -> 0x200
-	m_Memory[0x050] = 0xF0;
-	m_Memory[0x051] = 0x90;
-	m_Memory[0x052] = 0x90;
-	m_Memory[0x053] = 0x90;
-	m_Memory[0x054] = 0xF0;
+	pMemory[0x050] = 0xF0;
+	pMemory[0x051] = 0x90;
+	pMemory[0x052] = 0x90;
+	pMemory[0x053] = 0x90;
+	pMemory[0x054] = 0xF0;
 	// 1
-	m_Memory[0x055] = 0x20;
-	m_Memory[0x056] = 0x60;
-	m_Memory[0x057] = 0x20;
-	m_Memory[0x058] = 0x20;
-	m_Memory[0x059] = 0x70;
+	pMemory[0x055] = 0x20;
+	pMemory[0x056] = 0x60;
+	pMemory[0x057] = 0x20;
+	pMemory[0x058] = 0x20;
+	pMemory[0x059] = 0x70;
 	// 2
-	m_Memory[0x05A] = 0xF0;
-	m_Memory[0x05B] = 0x10;
-	m_Memory[0x05C] = 0xF0;
-	m_Memory[0x05D] = 0x80;
-	m_Memory[0x05E] = 0xF0;
+	pMemory[0x05A] = 0xF0;
+	pMemory[0x05B] = 0x10;
+	pMemory[0x05C] = 0xF0;
+	pMemory[0x05D] = 0x80;
+	pMemory[0x05E] = 0xF0;
 	// 3
-	m_Memory[0x05F] = 0xF0;
-	m_Memory[0x060] = 0x10;
-	m_Memory[0x061] = 0xF0;
-	m_Memory[0x062] = 0x10;
-	m_Memory[0x063] = 0xF0;
+	pMemory[0x05F] = 0xF0;
+	pMemory[0x060] = 0x10;
+	pMemory[0x061] = 0xF0;
+	pMemory[0x062] = 0x10;
+	pMemory[0x063] = 0xF0;
 	// 4
-	m_Memory[0x064] = 0x90;
-	m_Memory[0x065] = 0x90;
-	m_Memory[0x066] = 0xF0;
-	m_Memory[0x067] = 0x10;
-	m_Memory[0x068] = 0x10;
+	pMemory[0x064] = 0x90;
+	pMemory[0x065] = 0x90;
+	pMemory[0x066] = 0xF0;
+	pMemory[0x067] = 0x10;
+	pMemory[0x068] = 0x10;
 	// 5
-	m_Memory[0x069] = 0xF0;
-	m_Memory[0x06A] = 0x80;
-	m_Memory[0x06B] = 0xF0;
-	m_Memory[0x06C] = 0x10;
-	m_Memory[0x06D] = 0xF0;
+	pMemory[0x069] = 0xF0;
+	pMemory[0x06A] = 0x80;
+	pMemory[0x06B] = 0xF0;
+	pMemory[0x06C] = 0x10;
+	pMemory[0x06D] = 0xF0;
 	// 6
-	m_Memory[0x06E] = 0xF0;
-	m_Memory[0x06F] = 0x80;
-	m_Memory[0x070] = 0xF0;
-	m_Memory[0x071] = 0x90;
-	m_Memory[0x072] = 0xF0;
+	pMemory[0x06E] = 0xF0;
+	pMemory[0x06F] = 0x80;
+	pMemory[0x070] = 0xF0;
+	pMemory[0x071] = 0x90;
+	pMemory[0x072] = 0xF0;
 	// 7
-	m_Memory[0x073] = 0xF0;
-	m_Memory[0x074] = 0x10;
-	m_Memory[0x075] = 0x20;
-	m_Memory[0x076] = 0x40;
-	m_Memory[0x077] = 0x40;
+	pMemory[0x073] = 0xF0;
+	pMemory[0x074] = 0x10;
+	pMemory[0x075] = 0x20;
+	pMemory[0x076] = 0x40;
+	pMemory[0x077] = 0x40;
 	// 8
-	m_Memory[0x078] = 0xF0;
-	m_Memory[0x079] = 0x90;
-	m_Memory[0x07A] = 0xF0;
-	m_Memory[0x07B] = 0x90;
-	m_Memory[0x07C] = 0xF0;
+	pMemory[0x078] = 0xF0;
+	pMemory[0x079] = 0x90;
+	pMemory[0x07A] = 0xF0;
+	pMemory[0x07B] = 0x90;
+	pMemory[0x07C] = 0xF0;
 	// 9
-	m_Memory[0x07D] = 0xF0;
-	m_Memory[0x07E] = 0x90;
-	m_Memory[0x07F] = 0xF0;
-	m_Memory[0x080] = 0x10;
-	m_Memory[0x081] = 0xF0;
+	pMemory[0x07D] = 0xF0;
+	pMemory[0x07E] = 0x90;
+	pMemory[0x07F] = 0xF0;
+	pMemory[0x080] = 0x10;
+	pMemory[0x081] = 0xF0;
 	// A
-	m_Memory[0x082] = 0xF0;
-	m_Memory[0x083] = 0x90;
-	m_Memory[0x084] = 0xF0;
-	m_Memory[0x085] = 0x90;
-	m_Memory[0x086] = 0x90;
+	pMemory[0x082] = 0xF0;
+	pMemory[0x083] = 0x90;
+	pMemory[0x084] = 0xF0;
+	pMemory[0x085] = 0x90;
+	pMemory[0x086] = 0x90;
 	// B
-	m_Memory[0x087] = 0xE0;
-	m_Memory[0x088] = 0x90;
-	m_Memory[0x089] = 0xE0;
-	m_Memory[0x08A] = 0x90;
-	m_Memory[0x08B] = 0xE0;
+	pMemory[0x087] = 0xE0;
+	pMemory[0x088] = 0x90;
+	pMemory[0x089] = 0xE0;
+	pMemory[0x08A] = 0x90;
+	pMemory[0x08B] = 0xE0;
 	// C
-	m_Memory[0x08C] = 0xF0;
-	m_Memory[0x08D] = 0x80;
-	m_Memory[0x08E] = 0x80;
-	m_Memory[0x08F] = 0x80;
-	m_Memory[0x090] = 0xF0;
+	pMemory[0x08C] = 0xF0;
+	pMemory[0x08D] = 0x80;
+	pMemory[0x08E] = 0x80;
+	pMemory[0x08F] = 0x80;
+	pMemory[0x090] = 0xF0;
 	// D
-	m_Memory[0x091] = 0xE0;
-	m_Memory[0x092] = 0x90;
-	m_Memory[0x093] = 0x90;
-	m_Memory[0x094] = 0x90;
-	m_Memory[0x095] = 0xE0;
+	pMemory[0x091] = 0xE0;
+	pMemory[0x092] = 0x90;
+	pMemory[0x093] = 0x90;
+	pMemory[0x094] = 0x90;
+	pMemory[0x095] = 0xE0;
 	// E
-	m_Memory[0x096] = 0xF0;
-	m_Memory[0x097] = 0x80;
-	m_Memory[0x098] = 0xF0;
-	m_Memory[0x099] = 0x80;
-	m_Memory[0x09A] = 0xF0;
+	pMemory[0x096] = 0xF0;
+	pMemory[0x097] = 0x80;
+	pMemory[0x098] = 0xF0;
+	pMemory[0x099] = 0x80;
+	pMemory[0x09A] = 0xF0;
 	// F
-	m_Memory[0x09B] = 0xF0;
-	m_Memory[0x09C] = 0x80;
-	m_Memory[0x09D] = 0xF0;
-	m_Memory[0x09E] = 0x80;
-	m_Memory[0x09F] = 0x80;
+	pMemory[0x09B] = 0xF0;
+	pMemory[0x09C] = 0x80;
+	pMemory[0x09D] = 0xF0;
+	pMemory[0x09E] = 0x80;
+	pMemory[0x09F] = 0x80;
+
+	//SUPER-CHIP 8x10 digits 0-9
+	const uint8_t largeDigits[100]{
+		0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C,
+		0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C,
+		0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF,
+		0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C,
+		0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06,
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C,
+		0x3E, 0x7C, 0xC0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C,
+		0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60,
+		0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C,
+		0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C
+	};
+	std::memcpy(pMemory + m_LargeFontAddress, largeDigits, sizeof(largeDigits));
 }
 
-void VirtualMachine::UpdateApp(const float elapsedSec)
+void VirtualMachine::SetIdleLoops(const uint16_t* pAddresses, const uint8_t count)
 {
-	if (m_PC >= m_MemSize)
+	m_IdleLoopCount = count < m_MaxIdleLoops ? count : m_MaxIdleLoops;
+	for (uint8_t loopIdx = 0; loopIdx < m_IdleLoopCount; ++loopIdx)
+		m_IdleLoops[loopIdx] = pAddresses[loopIdx];
+}
+
+void VirtualMachine::UpdateApp()
+{
+	const uint64_t frameCycle = m_Cycle;
+	m_Cycle += m_InstructionsPerFrame;
+	m_FrameEnd = FrameEnd::Complete;
+	if (m_Cpu.pc >= m_MemSize)
 	{
+		m_FrameEnd = FrameEnd::Halted;
 		std::cerr << "PC encountered an overflow" << std::endl;
+		if (m_pDebugger)
+			m_pDebugger->OnFault(*this, "PC overflow");
+		ApplyInputEvents(frameCycle, m_InstructionsPerFrame);
 		return;
 	}
 
-	if (m_DT > 0)
-		--m_DT;
-	if (m_ST > 0)
-		--m_ST;
+	if (m_Cpu.dt > 0)
+		--m_Cpu.dt;
+	if (m_Cpu.st > 0)
+		--m_Cpu.st;
 
-	// Construct opcode from the 2 bytes divided over PC and PC + 1
-	//shift left cuz higher order
-	const uint16_t opcode = (m_Memory[m_PC] << 8u) | m_Memory[m_PC + 1];
-	m_PC += 2;
-	m_pOpcodeManager->ExecuteOpcode(*this, opcode);
+	//the batch is split where queued key events are due, without events (or a queue) it is a single run.
+	//Debugger or not is decided per run, the loop without a debugger has no extra instructions
+	uint16_t instruction = 0;
+	bool isFrameOver = false;
+	while (!isFrameOver && instruction < m_InstructionsPerFrame)
+	{
+		const uint16_t end = ApplyInputEvents(frameCycle, instruction);
+		isFrameOver = m_pDebugger ? RunInstructions<true>(instruction, end) : RunInstructions<false>(instruction, end);
+	}
+	m_ExecutedInstructions += instruction;
+	//keys that change after a frame ended early (idle loop, FX0A) are there for the next frame
+	ApplyInputEvents(frameCycle, m_InstructionsPerFrame);
+}
 
+uint16_t VirtualMachine::ApplyInputEvents(const uint64_t frameCycle, const uint16_t instruction)
+{
+	if (!m_pInputQueue)
+		return m_InstructionsPerFrame;
+	InputEvent event{};
+	while (m_pInputQueue->Peek(event))
+	{
+		if (event.cycle > frameCycle + instruction)
+		{
+			const uint64_t dueInstruction = event.cycle - frameCycle;
+			return dueInstruction < m_InstructionsPerFrame ? uint16_t(dueInstruction) : m_InstructionsPerFrame;
+		}
+		m_Cpu.input[event.key & 0xF] = event.isPressed;
+		m_pInputQueue->Pop();
+	}
+	return m_InstructionsPerFrame;
+}
+
+template<bool isDebugged>
+bool VirtualMachine::RunInstructions(uint16_t& instruction, const uint16_t end)
+{
+	for (; instruction < end; ++instruction)
+	{
+		uint16_t pc = m_Cpu.pc;
+		//overflow is reported next frame
+		if (pc >= m_MemSize)
+		{
+			m_FrameEnd = FrameEnd::Yielded;
+			return true;
+		}
+		//a known idle loop only spins until the next timer tick, it runs once per frame to see that tick
+		if (instruction != 0)
+		{
+			for (uint8_t loopIdx = 0; loopIdx < m_IdleLoopCount; ++loopIdx)
+			{
+				if (m_IdleLoops[loopIdx] == pc)
+				{
+					m_FrameEnd = FrameEnd::IdleLoop;
+					return true;
+				}
+			}
+		}
+		if constexpr (isDebugged)
+		{
+			if (!m_pDebugger->OnInstruction(*this))
+			{
+				m_FrameEnd = FrameEnd::Yielded;
+				return true;
+			}
+			//commands may have moved PC while stopped
+			pc = m_Cpu.pc;
+			if (pc >= m_MemSize)
+			{
+				m_FrameEnd = FrameEnd::Yielded;
+				return true;
+			}
+		}
+
+		// Construct opcode from the 2 bytes divided over PC and PC + 1
+		//shift left cuz higher order
+		const uint16_t opcode = (m_Memory.Read(pc) << 8u) | ReadMemory(pc + 1);
+		m_Cpu.pc += 2;
+		m_pOpcodeManager->ExecuteOpcode(*this, opcode);
+		//jump to self or FX0A without a key: nothing changes before the next frame
+		if (m_Cpu.pc == pc)
+		{
+			//other instructions that stay in place (call to self, BNNN) change state, they are just run again
+			m_FrameEnd = (opcode & 0xF0FF) == 0xF00A ? FrameEnd::KeyWait : (opcode & 0xF000) == 0x1000 ? FrameEnd::Halted : FrameEnd::Yielded;
+			++instruction;
+			return true;
+		}
+	}
+	return false;
 }
 
 
-void VirtualMachine::LoadROM(const std::string& path)
+bool VirtualMachine::LoadROM(const std::string& path)
 {
-	// Open the file as a stream of binary and move the file pointer to the end
 	std::ifstream file(path, std::ios::binary | std::ios::in);
 
 	if (!file.good())
 	{
 		std::cerr << "Rom not found" << std::endl;
-		return;
+		return false;
 	}
 	else if (!file.is_open())
 	{
 		std::cerr << "Cant open ROM" << std::endl;
-		return;
+		return false;
 	}
 
-	int counter{ 0 };
-	//read byte by byte
-	while (file)
-	{
-		char byte;
-		file.read((char*)&byte, sizeof(byte));
-		m_Memory[m_ProgramMemStart + counter] = byte;
-		++counter;
-	}
+	const std::vector<uint8_t> rom{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+	return LoadROM(rom.data(), rom.size());
 }
-void VirtualMachine::ClearScreen()
+
+bool VirtualMachine::LoadROM(const uint8_t* pData, const size_t size)
 {
-	//Clear everything from prev frame render
-	SDL_RenderClear(m_Renderer);
-	SDL_RenderPresent(m_Renderer);
-	SDL_SetRenderDrawColor(m_Renderer, 1, 1, 1, 1);
+	if (size == 0)
+	{
+		std::cerr << "ROM is empty" << std::endl;
+		return false;
+	}
 
+	//only pages the ROM covers get private copies, the rest stays shared with the template
+	Reset();
+	m_RomHash = RomArchive::HashContent(pData, size);
+	m_IdleLoopCount = 0;
+	for (uint8_t key = 0; key < 16; ++key)
+		m_KeyMap[key] = key;
+	//everything from 0x200 up to the end of memory is program space
+	const size_t capacity = m_MemSize - m_ProgramMemStart;
+#ifndef CHIP8_FUZZER
+	//the fuzzer hands in oversized inputs all the time, a flushed line per exec would cost it throughput
+	if (size > capacity)
+		std::cerr << "ROM is " << size << " bytes, only the first " << capacity << " are loaded" << std::endl;
+#endif
+	m_Memory.Write(m_ProgramMemStart, pData, uint32_t(size < capacity ? size : capacity));
+	return true;
 }
-void VirtualMachine::Update(const float elapsedSec)
+
+bool VirtualMachine::LoadROM(const RomEntry& entry)
 {
-	UpdateApp(elapsedSec);
-	int pitch = m_TextureWidth * sizeof(uint32_t);
-	SDL_UpdateTexture(m_Texture, nullptr, &m_PixelArray, pitch);
-	//copy this frame texture into renderer
-	SDL_RenderClear(m_Renderer);
-	SDL_RenderCopy(m_Renderer, m_Texture, nullptr, nullptr);
-	//present renderer
-	SDL_RenderPresent(m_Renderer);
+	return LoadROM(entry.pData, entry.size);
 }
 
-bool VirtualMachine::ProcessInput()
+namespace
 {
-	bool quit = false;
-
-	SDL_Event event;
-
-	while (SDL_PollEvent(&event))
+	template<typename T>
+	void AppendState(std::vector<uint8_t>& state, const T& value)
 	{
-		switch (event.type)
-		{
-		case SDL_QUIT:
-		{
-			quit = true;
-		} break;
-
-		case SDL_KEYDOWN:
-		{
-			switch (event.key.keysym.sym)
-			{
-			case SDLK_ESCAPE:
-			{
-				quit = true;
-			} break;
-
-			case SDLK_x:
-			{
-				m_Input[0] = 1;
-			} break;
-
-			case SDLK_1:
-			{
-				m_Input[1] = 1;
-			} break;
-
-			case SDLK_2:
-			{
-				m_Input[2] = 1;
-			} break;
-
-			case SDLK_3:
-			{
-				m_Input[3] = 1;
-			} break;
-
-			case SDLK_q:
-			{
-				m_Input[4] = 1;
-			} break;
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&value);
+		state.insert(state.end(), pBytes, pBytes + sizeof(T));
+	}
 
-			case SDLK_w:
-			{
-				m_Input[5] = 1;
-			} break;
+	template<typename T>
+	void ReadState(const uint8_t*& pState, T& value)
+	{
+		std::memcpy(&value, pState, sizeof(T));
+		pState += sizeof(T);
+	}
+}
 
-			case SDLK_e:
-			{
-				m_Input[6] = 1;
-			} break;
+void VirtualMachine::ForkFrom(const VirtualMachine& parent)
+{
+	if (&parent == this)
+		return;
+	m_pOpcodeManager = parent.m_pOpcodeManager;
+	m_InstructionsPerFrame = parent.m_InstructionsPerFrame;
+	m_ExecutedInstructions = parent.m_ExecutedInstructions;
+	m_Cycle = parent.m_Cycle;
+	std::memcpy(m_IdleLoops, parent.m_IdleLoops, sizeof(m_IdleLoops));
+	m_IdleLoopCount = parent.m_IdleLoopCount;
+	m_FrameEnd = parent.m_FrameEnd;
+	std::memcpy(m_KeyMap, parent.m_KeyMap, sizeof(m_KeyMap));
+	m_RomHash = parent.m_RomHash;
+	m_MemSize = parent.m_MemSize;
+	m_MemAddressMask = parent.m_MemAddressMask;
+	m_Memory.ShareFrom(parent.m_Memory);
+	m_Framebuffer = parent.m_Framebuffer;
+	m_Cpu = parent.m_Cpu;
+	m_Cpu.displayUpdated = true;
+}
 
-			case SDLK_a:
-			{
-				m_Input[7] = 1;
-			} break;
+void VirtualMachine::SaveState(std::vector<uint8_t>& state) const
+{
+	state.resize(m_MemSize);
+	m_Memory.Read(0, state.data(), m_MemSize);
+	AppendState(state, m_Framebuffer.m_Planes);
+	AppendState(state, m_Framebuffer.m_PlaneMask);
+	AppendState(state, m_Framebuffer.m_IsHighRes);
+	AppendState(state, m_Cpu.stack);
+	AppendState(state, m_Cpu.vx);
+	AppendState(state, m_Cpu.vi);
+	AppendState(state, m_Cpu.input);
+	AppendState(state, m_Cpu.dt);
+	AppendState(state, m_Cpu.st);
+	AppendState(state, m_Cpu.sp);
+	AppendState(state, m_Cpu.pc);
+	AppendState(state, m_Cpu.rplFlags);
+	AppendState(state, m_Cpu.audioPattern);
+	AppendState(state, m_Cpu.audioPitch);
+	AppendState(state, m_Cpu.randomState);
+}
 
-			case SDLK_s:
-			{
-				m_Input[8] = 1;
-			} break;
+bool VirtualMachine::LoadState(const std::vector<uint8_t>& state)
+{
+	const size_t registerSize = sizeof(m_Framebuffer.m_Planes) + sizeof(m_Framebuffer.m_PlaneMask) + sizeof(m_Framebuffer.m_IsHighRes)
+		+ sizeof(m_Cpu.stack) + sizeof(m_Cpu.vx) + sizeof(m_Cpu.vi) + sizeof(m_Cpu.input) + sizeof(m_Cpu.dt) + sizeof(m_Cpu.st) + sizeof(m_Cpu.sp) + sizeof(m_Cpu.pc)
+		+ sizeof(m_Cpu.rplFlags) + sizeof(m_Cpu.audioPattern) + sizeof(m_Cpu.audioPitch) + sizeof(m_Cpu.randomState);
+	if (state.size() != m_MemSize + registerSize)
+	{
+		std::cerr << "State does not fit this vm" << std::endl;
+		return false;
+	}
 
-			case SDLK_d:
-			{
-				m_Input[9] = 1;
-			} break;
+	const uint8_t* pState = state.data();
+	//unchanged pages stay shared
+	m_Memory.Write(0, pState, m_MemSize);
+	pState += m_MemSize;
+	ReadState(pState, m_Framebuffer.m_Planes);
+	ReadState(pState, m_Framebuffer.m_PlaneMask);
+	ReadState(pState, m_Framebuffer.m_IsHighRes);
+	ReadState(pState, m_Cpu.stack);
+	ReadState(pState, m_Cpu.vx);
+	ReadState(pState, m_Cpu.vi);
+	ReadState(pState, m_Cpu.input);
+	ReadState(pState, m_Cpu.dt);
+	ReadState(pState, m_Cpu.st);
+	ReadState(pState, m_Cpu.sp);
+	ReadState(pState, m_Cpu.pc);
+	ReadState(pState, m_Cpu.rplFlags);
+	ReadState(pState, m_Cpu.audioPattern);
+	ReadState(pState, m_Cpu.audioPitch);
+	ReadState(pState, m_Cpu.randomState);
+	m_Cpu.displayUpdated = true;
+	return true;
+}
 
-			case SDLK_z:
-			{
-				m_Input[0xA] = 1;
-			} break;
+void VirtualMachine::AddFrameSink(FrameSink* pSink)
+{
+	m_FrameSinks.push_back(pSink);
+}
 
-			case SDLK_c:
-			{
-				m_Input[0xB] = 1;
-			} break;
+void VirtualMachine::SkipStalledFrames(const uint64_t frameCount)
+{
+	//each of them retried the waiting instruction once, PC overflow frames run nothing
+	SkipIdleFrames(frameCount, m_Cpu.pc < m_MemSize ? 1 : 0);
+}
 
-			case SDLK_4:
-			{
-				m_Input[0xC] = 1;
-			} break;
+void VirtualMachine::SkipIdleFrames(const uint64_t frameCount, const uint32_t loopInstructions)
+{
+	m_Cycle += frameCount * m_InstructionsPerFrame;
+	m_Cpu.dt = frameCount < m_Cpu.dt ? uint8_t(m_Cpu.dt - frameCount) : 0;
+	m_Cpu.st = frameCount < m_Cpu.st ? uint8_t(m_Cpu.st - frameCount) : 0;
+	m_ExecutedInstructions += frameCount * loopInstructions;
+}
 
-			case SDLK_r:
-			{
-				m_Input[0xD] = 1;
-			} break;
+void VirtualMachine::Update()
+{
+	Step();
+	PresentFrame(*this);
+}
 
-			case SDLK_f:
-			{
-				m_Input[0xE] = 1;
-			} break;
+void VirtualMachine::Step()
+{
+	UpdateApp();
+}
 
-			case SDLK_v:
-			{
-				m_Input[0xF] = 1;
-			} break;
-			}
-		} break;
+void VirtualMachine::PresentFrame(const VirtualMachine& source)
+{
+	for (FrameSink* pSink : m_FrameSinks)
+		pSink->PublishFrame(source);
+	//every sink has seen this frame, next one is only dirty if an opcode draws again
+	m_Cpu.displayUpdated = false;
+}
 
-		case SDL_KEYUP:
+uint64_t VirtualMachine::GetFrameHash() const
+{
+	//xxHash64 style round per packed word, only rows and words of the current resolution take part
+	const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+	const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+	const uint16_t height = m_Framebuffer.GetHeight();
+	const uint16_t wordsPerRow = m_Framebuffer.GetWidth() / 64;
+	uint64_t hash = 0x27D4EB2F165667C5ull ^ (uint64_t(m_Framebuffer.GetWidth()) << 16 | height);
+	for (uint8_t plane = 0; plane < Framebuffer::m_PlaneCount; ++plane)
+	{
+		for (uint16_t y = 0; y < height; ++y)
 		{
-			switch (event.key.keysym.sym)
-			{
-			case SDLK_x:
-			{
-				m_Input[0] = 0;
-			} break;
-
-			case SDLK_1:
-			{
-				m_Input[1] = 0;
-			} break;
-
-			case SDLK_2:
-			{
-				m_Input[2] = 0;
-			} break;
-
-			case SDLK_3:
-			{
-				m_Input[3] = 0;
-			} break;
-
-			case SDLK_q:
-			{
-				m_Input[4] = 0;
-			} break;
-
-			case SDLK_w:
-			{
-				m_Input[5] = 0;
-			} break;
-
-			case SDLK_e:
-			{
-				m_Input[6] = 0;
-			} break;
-
-			case SDLK_a:
-			{
-				m_Input[7] = 0;
-			} break;
-
-			case SDLK_s:
-			{
-				m_Input[8] = 0;
-			} break;
-
-			case SDLK_d:
-			{
-				m_Input[9] = 0;
-			} break;
-
-			case SDLK_z:
-			{
-				m_Input[0xA] = 0;
-			} break;
-
-			case SDLK_c:
-			{
-				m_Input[0xB] = 0;
-			} break;
-
-			case SDLK_4:
+			for (uint16_t word = 0; word < wordsPerRow; ++word)
 			{
-				m_Input[0xC] = 0;
-			} break;
-
-			case SDLK_r:
-			{
-				m_Input[0xD] = 0;
-			} break;
-
-			case SDLK_f:
-			{
-				m_Input[0xE] = 0;
-			} break;
-
-			case SDLK_v:
-			{
-				m_Input[0xF] = 0;
-			} break;
+				const uint64_t packed = m_Framebuffer.GetRow(plane, y)[word];
+				hash ^= ((packed * prime2) << 31 | (packed * prime2) >> 33) * prime1;
+				hash = (hash << 27 | hash >> 37) * prime1 + 0x85EBCA77C2B2AE63ull;
 			}
-		} break;
 		}
 	}
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	return hash;
+}
 
-	return quit;
-}
\ No newline at end of file
+uint8_t VirtualMachine::NextRandomByte()
+{
+	//xorshift32, std::rand differs between standard libraries which breaks recorded runs
+	m_Cpu.randomState ^= m_Cpu.randomState << 13;
+	m_Cpu.randomState ^= m_Cpu.randomState >> 17;
+	m_Cpu.randomState ^= m_Cpu.randomState << 5;
+	return uint8_t(m_Cpu.randomState >> 24);
+}
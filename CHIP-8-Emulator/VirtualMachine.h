@@ -1,13 +1,20 @@
 #pragma once
 #include <iostream>
-#include <SDL.h>
-namespace InstructionLib { class OpcodeManager; }
-class InstructionLib::OpcodeManager;
+#include <vector>
+#include <cstdint>
+#include "Quirks.h"
+#include "CpuState.h"
+#include "Framebuffer.h"
+#include "PagedMemory.h"
+namespace InstructionLib { class OpcodeManagerBase; }
+class FrameSink;
+class Debugger;
+class InputEventQueue;
+struct RomEntry;
 class VirtualMachine
 {
-	struct Vector2 { float width, height; };
 public:
-	VirtualMachine(const int& widthScale , const int& heightScale);
+	VirtualMachine();
 	~VirtualMachine();
 	//cpy ctr
 	VirtualMachine(const VirtualMachine& old) = delete;
@@ -16,73 +23,156 @@ public:
 	VirtualMachine& operator=(const VirtualMachine& other) = delete;
 	VirtualMachine& operator=(const VirtualMachine&& other) = delete;
 
-	void LoadROM(const std::string& path);
-	void ClearScreen();
-	void Update(const float elapsedSec);
-	bool ProcessInput();
-
-	const static uint16_t m_TotalPixelCount{ 0x800 };
-	//monochrome --> pixel has 0 or 1 state
-	uint32_t m_PixelArray[m_TotalPixelCount];
-
-	uint8_t GetSP() const { return m_SP; }
-	void SetSP(const uint8_t sp) { m_SP = sp; }
-	void DecrementSP() { --m_SP; }
-	void IncrementSP() { ++m_SP; }
-
-	uint16_t GetPC() const { return m_PC; }
-	void SetPC(const uint16_t& memAddress) { m_PC = memAddress; }
-	void IncrementPCByTwo() { m_PC += 2; }
-	void DecrementPCByTwo() { m_PC -= 2; }
-
-	//used to store the address that the interpreter shoud return to when finished with a subroutine. Chip-8 allows for up to 16 levels of nested subroutines.
-	uint16_t m_Stack[16];
-
-	//REGISTERS
-	//general purpose registers 0 to F
-	uint8_t m_Vx[16];
-	//used to store memory addresses
-	uint16_t m_Vi;
-
-	const static uint16_t m_MemSize{ 0x1000 };
-	uint8_t m_Memory[m_MemSize];
-
-	Vector2 m_ScreenDimensions;
-
-	//INPUT
-	uint8_t m_Input[16];
-
-	//special purpose sound and time registers
-	//delay timer register
-	uint8_t m_DT;
-	//sound timer register
-	uint8_t m_ST;
-
-	//Stack pointer, points to upmost level of the stack
-	uint8_t m_SP;
+	//power on (see Reset) followed by copying the ROM to 0x200, nothing of a previous ROM survives. Frame sinks and the
+	//quirk profile are kept, so ROMs can be swapped while frontends keep running.
+	//Both return false and leave the vm untouched when nothing was loaded, ROMs larger than the program area are truncated
+	bool LoadROM(const std::string& path);
+	bool LoadROM(const uint8_t* pData, const size_t size);
+	//copies straight out of the archive mapping
+	bool LoadROM(const RomEntry& entry);
+	//power on state: font loaded, registers, stack, pixels and timers cleared. Only copies from a shared template,
+	//cheap enough to run before every fuzz input
+	void Reset();
+	//picks the opcode handlers for the interpreter behaviour a ROM expects, meant to be done before loading the ROM.
+	//Also sizes memory for the profile (64 KB for XO-CHIP), memory that exists in both sizes is kept
+	void SetQuirkProfile(const InstructionLib::QuirkProfile profile);
+	InstructionLib::QuirkProfile GetQuirkProfile() const;
+	//a frame is one timer tick and up to this many instructions, kept across LoadROM like the quirk profile
+	void SetInstructionsPerFrame(const uint16_t instructionsPerFrame) { m_InstructionsPerFrame = instructionsPerFrame ? instructionsPerFrame : 1; }
+	uint16_t GetInstructionsPerFrame() const { return m_InstructionsPerFrame; }
+	//addresses of loops that only wait for the next timer tick, reaching one ends the frame early. Per ROM, LoadROM clears them
+	void SetIdleLoops(const uint16_t* pAddresses, const uint8_t count);
+	//why the last frame ended, what a scheduler needs to know to not run a vm that cant get anywhere
+	enum class FrameEnd : uint8_t
+	{
+		Complete,	//all instructions per frame ran
+		Yielded,	//other early end (debugger, instruction that stays in place), runs on next frame
+		IdleLoop,	//reached a known idle loop, runs on next frame
+		KeyWait,	//FX0A without a pressed key, frames until a key goes down only tick the timers
+		Halted,		//jump to itself or PC overflow, frames only tick the timers whatever the keys do
+	};
+	FrameEnd GetFrameEnd() const { return m_FrameEnd; }
+	//applies frameCount frames of a vm whose last frame ended in KeyWait or Halted at once, same state as stepping
+	//them with unchanged keys: timers, cycle and instruction count move on, nothing else does
+	void SkipStalledFrames(const uint64_t frameCount);
+	//applies frameCount frames of a vm parked at an idle loop that waits for the delay timer, while the timer is still
+	//running at the end of them: every such frame is one pass of the loop. Timers, cycle and instruction count move on,
+	//registers the loop reads the timer into keep the value of the last stepped pass until the next one
+	void SkipIdleFrames(const uint64_t frameCount, const uint32_t loopInstructions);
+	//emulated time in cycles (one per instruction slot) where the next frame starts. Every frame is instructions per frame
+	//cycles long, also when it ends early on an idle loop, so frontends can stamp input with it
+	uint64_t GetCycle() const { return m_Cycle; }
+	//instructions run since construction, summed once per frame. Profilers divide host counters by it
+	uint64_t GetExecutedInstructions() const { return m_ExecutedInstructions; }
+	//content hash (RomArchive::HashContent) of the loaded ROM, what the ROM database is keyed by
+	uint64_t GetRomHash() const { return m_RomHash; }
+	//Step followed by PresentFrame(*this)
+	void Update();
+	//runs one frame without presenting it, the headless path run ahead and batch tools build on. A frame is one timer
+	//tick and m_InstructionsPerFrame instructions whatever its wall time was, pacing is up to the caller (FramePacer)
+	void Step();
+	//hands source's picture to every sink of this vm, source is this vm or a copy running ahead of it
+	void PresentFrame(const VirtualMachine& source);
+
+	//turns this vm into a copy of parent (quirk profile included, frame sinks excluded) that shares the parent's memory
+	//pages until either side writes to them. The parent must not run while it is forked
+	void ForkFrom(const VirtualMachine& parent);
+
+	//flat copy of everything an instruction can change (not the quirk profile or frame sinks), used to fork machines.
+	//LoadState expects a state saved by a vm with the same memory size
+	void SaveState(std::vector<uint8_t>& state) const;
+	bool LoadState(const std::vector<uint8_t>& state);
+
+	//Frontends (SDL window, terminal, ...) get every presented frame, not owned by the vm
+	void AddFrameSink(FrameSink* pSink);
+	//nullptr --> plain instruction loop without any checks, not owned by the vm and not copied by ForkFrom
+	void SetDebugger(Debugger* pDebugger) { m_pDebugger = pDebugger; }
+	//key events applied right before the instruction of their cycle, nullptr --> only the key states as set before the frame.
+	//Not owned and not copied by ForkFrom
+	void SetInputQueue(InputEventQueue* pInputQueue) { m_pInputQueue = pInputQueue; }
+
+	//current resolution, 64x32 or 128x64 in SUPER-CHIP/XO-CHIP hires mode
+	uint16_t GetTextureWidth() const { return m_Framebuffer.GetWidth(); }
+	uint16_t GetTextureHeight() const { return m_Framebuffer.GetHeight(); }
+	bool IsDisplayUpdated() const { return m_Cpu.displayUpdated; }
+	//64 bit hash of the packed pixels of every plane, same picture --> same hash on every platform
+	uint64_t GetFrameHash() const;
+
+	//CXKK randomness, seeded per vm so runs are reproducible
+	uint8_t NextRandomByte();
+
+	uint8_t GetSP() const { return m_Cpu.sp; }
+	//stack index wraps at 16 levels instead of running past the stack
+	void SetSP(const uint8_t sp) { m_Cpu.sp = sp & 0x0F; }
+	void DecrementSP() { m_Cpu.sp = (m_Cpu.sp - 1) & 0x0F; }
+	void IncrementSP() { m_Cpu.sp = (m_Cpu.sp + 1) & 0x0F; }
+
+	uint16_t GetPC() const { return m_Cpu.pc; }
+	void SetPC(const uint16_t& memAddress) { m_Cpu.pc = memAddress; }
+	void IncrementPCByTwo() { m_Cpu.pc += 2; }
+	void DecrementPCByTwo() { m_Cpu.pc -= 2; }
+
+	const static uint32_t m_ClassicMemSize{ 0x1000 };
+	const static uint32_t m_MaxMemSize{ 0x10000 };
+	//opcodes access memory through these, addresses wrap around the address space
+	uint8_t ReadMemory(const uint16_t address) const { return m_Memory.Read(address & m_MemAddressMask); }
+	void WriteMemory(const uint16_t address, const uint8_t value) { m_Memory.Write(address & m_MemAddressMask, value); }
+
+	//Members are ordered by how often a frame touches them: registers (first 2 cache lines), what the dispatch loop
+	//reads per instruction, pixels and memory pages on their own lines, everything frontends and tools use last
+	CpuState m_Cpu;
+private:
+	//shared per profile, not owned
+	InstructionLib::OpcodeManagerBase* m_pOpcodeManager;
+public:
+	//sized per quirk profile (see SetQuirkProfile), pages are shared with forks and the power on template
+	uint32_t m_MemSize;
+	uint16_t m_MemAddressMask;
+private:
+	uint16_t m_InstructionsPerFrame;
+public:
+	const static uint8_t m_MaxIdleLoops{ 4 };
+private:
+	uint16_t m_IdleLoops[m_MaxIdleLoops];
+	uint8_t m_IdleLoopCount;
+	FrameEnd m_FrameEnd;
+	uint64_t m_Cycle;
+	uint64_t m_ExecutedInstructions;
+public:
+	//1 bit per pixel per plane, plain CHIP-8 only draws into plane 0
+	alignas(64) Framebuffer m_Framebuffer;
+	PagedMemory m_Memory;
 
-	bool m_IsPaused;
+	//keypad key --> CHIP-8 key the frontends report it as, per ROM (LoadROM resets it to 1:1)
+	uint8_t m_KeyMap[16];
 private:
 	//METHODS
-	void Init(const int& widthScale, const int& heightScale);
-	void InitSDL(const int& widthScale, const int& heightScale);
-	void InitFont();
-
-	void UpdateApp(const float elapsedSec);
-	//ScreenSize (native 64 x 32)
-	const uint16_t m_TextureWidth;
-	const uint16_t m_TextureHeight;
+	void Init();
+	static void InitFont(uint8_t* pMemory);
+	void AllocateMemory(const uint32_t memSize);
+	//memory image after power on per memory size, built once and its pages shared by all instances
+	static const PagedMemory& GetMemoryTemplate(const uint32_t memSize);
+
+	void UpdateApp();
+	//runs the frame's instructions from instruction up to end, the debugged copy asks m_pDebugger before every one.
+	//instruction is left at the first one not run, returns true when the frame ended early
+	template<bool isDebugged>
+	bool RunInstructions(uint16_t& instruction, const uint16_t end);
+	//applies queued key events due at or before the cycle of instruction, returns the instruction the next one is due at (or the frame end)
+	uint16_t ApplyInputEvents(const uint64_t frameCycle, const uint16_t instruction);
+public:
+	//font sprites: 5 byte digits 0-F (FX29) followed by 10 byte SUPER-CHIP digits 0-9 (FX30)
+	const static uint16_t m_FontAddress{ 0x050 };
+	const static uint16_t m_LargeFontAddress{ 0x0A0 };
+private:
 	//Most CHIP-8 programs start at location 0x200, everything below is for interpreter
 	const uint16_t m_ProgramMemStart{ 0x200 };
+	const static uint32_t m_RandomSeed{ 0x2545F491 };
 
-	//Program counter, holds currently executed address
-	uint16_t m_PC;
-
-	InstructionLib::OpcodeManager* m_pOpcodeManager;
+	uint64_t m_RomHash;
 
-	//SDL
-	SDL_Window* m_Window;
-	SDL_Renderer* m_Renderer;
-	SDL_Texture* m_Texture;
+	std::vector<FrameSink*> m_FrameSinks;
+	Debugger* m_pDebugger;
+	InputEventQueue* m_pInputQueue;
 };
 
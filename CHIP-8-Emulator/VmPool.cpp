@@ -0,0 +1,262 @@
+#include "VmPool.h"
+#include "VirtualMachine.h"
+#include <iostream>
+#include <new>
+#include <utility>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+	size_t RoundUp(const size_t value, const size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	//node of the cpu the calling thread runs on, -1 when unknown
+	int32_t GetCurrentNumaNode()
+	{
+#if defined(_WIN32)
+		PROCESSOR_NUMBER processor{};
+		GetCurrentProcessorNumberEx(&processor);
+		USHORT node = 0;
+		return GetNumaProcessorNodeEx(&processor, &node) ? int32_t(node) : -1;
+#elif defined(__linux__)
+		unsigned int cpu = 0;
+		unsigned int node = 0;
+		return syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ? int32_t(node) : -1;
+#else
+		return -1;
+#endif
+	}
+
+	//zeroed, huge page aligned memory on the node, nullptr on failure
+	uint8_t* MapArena(const size_t size, const int32_t numaNode, bool& isHugePageBacked)
+	{
+		isHugePageBacked = false;
+#if defined(_WIN32)
+		//large pages need the lock pages privilege, without it the allocation fails and normal pages are used
+		const DWORD node = numaNode >= 0 ? DWORD(numaNode) : NUMA_NO_PREFERRED_NODE;
+		const SIZE_T largePageSize = GetLargePageMinimum();
+		void* pMemory = nullptr;
+		if (largePageSize != 0 && size % largePageSize == 0)
+			pMemory = VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+		isHugePageBacked = pMemory != nullptr;
+		if (!pMemory)
+			pMemory = VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+		return static_cast<uint8_t*>(pMemory);
+#else
+		//one extra huge page to align the start, the unaligned ends are unmapped again
+		const size_t mappedSize = size + VmPool::m_HugePageSize;
+		void* pMapped = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (pMapped == MAP_FAILED)
+			return nullptr;
+		uint8_t* pMemory = reinterpret_cast<uint8_t*>(RoundUp(reinterpret_cast<uintptr_t>(pMapped), VmPool::m_HugePageSize));
+		const size_t headSize = size_t(pMemory - static_cast<uint8_t*>(pMapped));
+		if (headSize != 0)
+			munmap(pMapped, headSize);
+		if (mappedSize - headSize > size)
+			munmap(pMemory + size, mappedSize - headSize - size);
+#if defined(__linux__)
+		//before the first touch, pages land where they are bound. Preferred instead of bind: a full node falls back to another
+		if (numaNode >= 0 && numaNode < 64)
+		{
+			const unsigned long nodeMask = 1ul << numaNode;
+			syscall(SYS_mbind, pMemory, size, MPOL_PREFERRED, &nodeMask, sizeof(nodeMask) * 8, 0);
+		}
+#endif
+#if defined(MADV_HUGEPAGE)
+		isHugePageBacked = madvise(pMemory, size, MADV_HUGEPAGE) == 0;
+#endif
+		return pMemory;
+#endif
+	}
+
+	void UnmapArena(uint8_t* pMemory, const size_t size)
+	{
+#if defined(_WIN32)
+		(void)size;
+		VirtualFree(pMemory, 0, MEM_RELEASE);
+#else
+		munmap(pMemory, size);
+#endif
+	}
+}
+
+VmPool::VmPool(const uint32_t slotsPerArena)
+	:m_SlotSize{ RoundUp(sizeof(VirtualMachine), alignof(VirtualMachine)) }
+	, m_SlotsPerArena{ uint32_t(RoundUp(size_t(slotsPerArena ? slotsPerArena : 1) * m_SlotSize, m_HugePageSize) / m_SlotSize) }
+	, m_Arenas{}
+	, m_pFreeSlots{}
+	, m_PageChunks{}
+	, m_pChunkCursor{}
+	, m_pChunkEnd{}
+	, m_pFreePages{}
+	, m_pFreeTables{}
+	, m_Count{}
+	, m_NumaNode{ GetCurrentNumaNode() }
+	, m_IsHugePageBacked{}
+{
+}
+
+VmPool::~VmPool()
+{
+	for (Arena& arena : m_Arenas)
+	{
+		for (uint32_t slotIdx = 0; slotIdx < m_SlotsPerArena; ++slotIdx)
+		{
+			if ((arena.aliveBits[slotIdx >> 6] >> (slotIdx & 63)) & 1)
+				reinterpret_cast<VirtualMachine*>(arena.pMemory + slotIdx * m_SlotSize)->~VirtualMachine();
+		}
+		FreeArena(arena);
+	}
+	m_Arenas.clear();
+	m_pFreeSlots = nullptr;
+	//after the vms, they return their pages
+	for (uint8_t* pChunk : m_PageChunks)
+		UnmapArena(pChunk, m_HugePageSize);
+	m_PageChunks.clear();
+	m_pChunkCursor = nullptr;
+	m_pChunkEnd = nullptr;
+	m_pFreePages.store(nullptr, std::memory_order_relaxed);
+	m_pFreeTables = nullptr;
+	m_Count = 0;
+}
+
+void* VmPool::CarveBlock(const size_t size, const size_t alignment)
+{
+	uint8_t* pBlock = m_pChunkCursor ? reinterpret_cast<uint8_t*>(RoundUp(reinterpret_cast<uintptr_t>(m_pChunkCursor), alignment)) : nullptr;
+	if (!pBlock || size > size_t(m_pChunkEnd - pBlock))
+	{
+		//the rest of the old chunk is left unused, less than one table
+		bool isHugePageBacked = false;
+		uint8_t* pChunk = MapArena(m_HugePageSize, m_NumaNode, isHugePageBacked);
+		if (!pChunk)
+			return nullptr;
+		m_PageChunks.push_back(pChunk);
+		m_pChunkEnd = pChunk + m_HugePageSize;
+		pBlock = pChunk;
+	}
+	m_pChunkCursor = pBlock + size;
+	return pBlock;
+}
+
+void* VmPool::AllocatePage()
+{
+	FreeSlot* pPage = m_pFreePages.load(std::memory_order_acquire);
+	while (pPage && !m_pFreePages.compare_exchange_weak(pPage, pPage->pNext, std::memory_order_acquire, std::memory_order_acquire))
+	{
+	}
+	if (pPage)
+		return pPage;
+	return CarveBlock(PagedMemory::m_PageBlockSize, alignof(FreeSlot));
+}
+
+void VmPool::FreePage(void* pPage)
+{
+	FreeSlot* pSlot = new (pPage) FreeSlot{ m_pFreePages.load(std::memory_order_relaxed) };
+	while (!m_pFreePages.compare_exchange_weak(pSlot->pNext, pSlot, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+void* VmPool::AllocateTable()
+{
+	if (!m_pFreeTables)
+		return CarveBlock(sizeof(void*) * PagedMemory::m_MaxPageCount, 64);
+	FreeSlot* pTable = m_pFreeTables;
+	m_pFreeTables = pTable->pNext;
+	return pTable;
+}
+
+void VmPool::FreeTable(void* pTable)
+{
+	m_pFreeTables = new (pTable) FreeSlot{ m_pFreeTables };
+}
+
+bool VmPool::AddArena()
+{
+	Arena arena{};
+	arena.size = RoundUp(size_t(m_SlotsPerArena) * m_SlotSize, m_HugePageSize);
+	bool isHugePageBacked = false;
+	arena.pMemory = MapArena(arena.size, m_NumaNode, isHugePageBacked);
+	if (!arena.pMemory)
+	{
+		std::cerr << "Cant map a vm arena of " << arena.size << " bytes" << std::endl;
+		return false;
+	}
+	m_IsHugePageBacked = (m_Arenas.empty() || m_IsHugePageBacked) && isHugePageBacked;
+	arena.aliveBits.assign((m_SlotsPerArena + 63) / 64, 0);
+	//front to back, so vms created in a row sit next to each other
+	for (uint32_t slotIdx = m_SlotsPerArena; slotIdx-- > 0;)
+	{
+		FreeSlot* pSlot = new (arena.pMemory + slotIdx * m_SlotSize) FreeSlot{ m_pFreeSlots };
+		m_pFreeSlots = pSlot;
+	}
+	m_Arenas.push_back(std::move(arena));
+	return true;
+}
+
+void VmPool::FreeArena(Arena& arena)
+{
+	if (arena.pMemory)
+		UnmapArena(arena.pMemory, arena.size);
+	arena.pMemory = nullptr;
+	arena.size = 0;
+}
+
+bool VmPool::FindSlot(const VirtualMachine* pVM, uint32_t& arenaIdx, uint32_t& slotIdx) const
+{
+	const uint8_t* pSlot = reinterpret_cast<const uint8_t*>(pVM);
+	for (arenaIdx = 0; arenaIdx < m_Arenas.size(); ++arenaIdx)
+	{
+		const Arena& arena = m_Arenas[arenaIdx];
+		if (pSlot >= arena.pMemory && pSlot < arena.pMemory + size_t(m_SlotsPerArena) * m_SlotSize)
+		{
+			slotIdx = uint32_t(size_t(pSlot - arena.pMemory) / m_SlotSize);
+			return true;
+		}
+	}
+	return false;
+}
+
+VirtualMachine* VmPool::Create()
+{
+	if (!m_pFreeSlots && !AddArena())
+		return nullptr;
+	FreeSlot* pSlot = m_pFreeSlots;
+	m_pFreeSlots = pSlot->pNext;
+	VirtualMachine* pVM = new (pSlot) VirtualMachine();
+	pVM->m_Memory.SetAllocator(this);
+	uint32_t arenaIdx = 0;
+	uint32_t slotIdx = 0;
+	FindSlot(pVM, arenaIdx, slotIdx);
+	m_Arenas[arenaIdx].aliveBits[slotIdx >> 6] |= 1ull << (slotIdx & 63);
+	++m_Count;
+	return pVM;
+}
+
+void VmPool::Destroy(VirtualMachine* pVM)
+{
+	uint32_t arenaIdx = 0;
+	uint32_t slotIdx = 0;
+	if (!pVM || !FindSlot(pVM, arenaIdx, slotIdx))
+		return;
+	uint64_t& aliveBits = m_Arenas[arenaIdx].aliveBits[slotIdx >> 6];
+	if (!((aliveBits >> (slotIdx & 63)) & 1))
+		return;
+	aliveBits &= ~(1ull << (slotIdx & 63));
+	pVM->~VirtualMachine();
+	m_pFreeSlots = new (pVM) FreeSlot{ m_pFreeSlots };
+	--m_Count;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "PagedMemory.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+class VirtualMachine;
+//Slots for many vms carved out of large arenas instead of one heap block per vm. Arenas are asked for transparent
+//huge pages (fewer TLB misses when stepping thousands of vms in turn) and are placed on the NUMA node of the thread
+//that grows the pool, so a worker thread that owns its pool keeps its vms in local memory.
+//Create and Destroy only pop and push a free list and construct/destroy in place. Vms of 4 KB profiles share the power
+//on pages and the opcode dispatch of their profile, creating and destroying them allocates nothing.
+//Pages the vms copy on write (loading a ROM, running) and XO-CHIP page tables come from free lists carved out of
+//huge page chunks of the pool as well, the heap is only used when a chunk cant be mapped.
+//Not thread safe, meant to be used by the one worker thread running its vms. Vms elsewhere that forked from a vm of
+//the pool may share its pages (and drop them from their thread) but have to be gone before the pool.
+class VmPool final : private PagedMemory::Allocator
+{
+public:
+	//slotsPerArena is rounded up to fill the arena's last huge page
+	explicit VmPool(const uint32_t slotsPerArena);
+	//every vm still alive is destroyed
+	~VmPool();
+	VmPool(const VmPool& old) = delete;
+	VmPool(VmPool&& old) = delete;
+	VmPool& operator=(const VmPool& other) = delete;
+	VmPool& operator=(const VmPool&& other) = delete;
+
+	//power on vm like new VirtualMachine(), nullptr when no arena could be mapped
+	VirtualMachine* Create();
+	//pVM has to come from this pool
+	void Destroy(VirtualMachine* pVM);
+
+	uint32_t GetCount() const { return m_Count; }
+	uint32_t GetCapacity() const { return uint32_t(m_Arenas.size()) * m_SlotsPerArena; }
+	//-1 --> the OS decides (single node machines, no NUMA support)
+	int32_t GetNumaNode() const { return m_NumaNode; }
+	bool IsHugePageBacked() const { return m_IsHugePageBacked; }
+
+	const static size_t m_HugePageSize{ 2 * 1024 * 1024 };
+private:
+	struct Arena
+	{
+		uint8_t* pMemory;
+		size_t size;
+		//bit per slot, set while a vm lives in it
+		std::vector<uint64_t> aliveBits;
+	};
+	//free slots keep the next free slot in their first bytes
+	struct FreeSlot
+	{
+		FreeSlot* pNext;
+	};
+
+	void* AllocatePage() override;
+	void FreePage(void* pPage) override;
+	void* AllocateTable() override;
+	void FreeTable(void* pTable) override;
+	//size bytes at alignment from the current page chunk, a new chunk is mapped when it is used up
+	void* CarveBlock(const size_t size, const size_t alignment);
+
+	bool AddArena();
+	static void FreeArena(Arena& arena);
+	//arena index and slot index in it of a vm of this pool
+	bool FindSlot(const VirtualMachine* pVM, uint32_t& arenaIdx, uint32_t& slotIdx) const;
+
+	const size_t m_SlotSize;
+	uint32_t m_SlotsPerArena;
+	std::vector<Arena> m_Arenas;
+	FreeSlot* m_pFreeSlots;
+	//huge page chunks pages and page tables are carved from
+	std::vector<uint8_t*> m_PageChunks;
+	uint8_t* m_pChunkCursor;
+	uint8_t* m_pChunkEnd;
+	//pages are pushed from any thread that drops the last reference, only the pool's thread pops. With a single
+	//popper a node cant be popped and pushed again behind its back, so a plain CAS stack is safe
+	std::atomic<FreeSlot*> m_pFreePages;
+	FreeSlot* m_pFreeTables;
+	uint32_t m_Count;
+	int32_t m_NumaNode;
+	bool m_IsHugePageBacked;
+};
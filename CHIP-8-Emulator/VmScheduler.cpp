@@ -0,0 +1,146 @@
+#include "VmScheduler.h"
+#if defined(__cpp_impl_coroutine)
+#include "VirtualMachine.h"
+#include <exception>
+#include <utility>
+
+void VmScheduler::Task::promise_type::unhandled_exception()
+{
+	std::terminate();
+}
+
+VmScheduler::Task::~Task()
+{
+	if (m_Handle)
+		m_Handle.destroy();
+	m_Handle = nullptr;
+}
+
+VmScheduler::Task::Task(Task&& old) noexcept
+	:m_Handle{ std::exchange(old.m_Handle, nullptr) }
+{
+}
+
+VmScheduler::VmScheduler()
+	:m_Frame{}
+	, m_Instances{}
+	, m_Runnable{}
+	, m_Running{}
+	, m_SleepingCount{}
+	, m_TimerWheel{}
+{
+}
+
+VmScheduler::~VmScheduler()
+{
+	for (Instance& instance : m_Instances)
+	{
+		if (instance.isSleeping)
+			CatchUp(instance);
+	}
+}
+
+VmScheduler::Task VmScheduler::RunVm(const uint32_t vmIdx)
+{
+	for (;;)
+	{
+		VirtualMachine& vm = *m_Instances[vmIdx].pVM;
+		const uint16_t pc = vm.m_Cpu.pc;
+		const uint8_t dt = vm.m_Cpu.dt;
+		const uint64_t executedInstructions = vm.GetExecutedInstructions();
+		vm.Step();
+		//started at the idle loop and came back to it without the timer reaching 0: the frames until it does are the same pass
+		const bool isLoopPass = vm.GetFrameEnd() == VirtualMachine::FrameEnd::IdleLoop && vm.m_Cpu.pc == pc && dt > 1 && vm.m_Cpu.dt == dt - 1;
+		m_Instances[vmIdx].loopInstructions = isLoopPass ? uint32_t(vm.GetExecutedInstructions() - executedInstructions) : 0;
+		co_await FrameAwaiter{ *this, vmIdx };
+	}
+}
+
+uint32_t VmScheduler::Add(VirtualMachine& vm)
+{
+	const uint32_t vmIdx = uint32_t(m_Instances.size());
+	m_Instances.push_back(Instance{ &vm, RunVm(vmIdx), 0, 0, 0, false });
+	m_Runnable.push_back(vmIdx);
+	return vmIdx;
+}
+
+void VmScheduler::Suspend(const uint32_t vmIdx)
+{
+	Instance& instance = m_Instances[vmIdx];
+	const VirtualMachine::FrameEnd frameEnd = instance.pVM->GetFrameEnd();
+	//the timer reads 1 in the next frame's pass and 0 in the one after, that one leaves the loop
+	const uint8_t dt = instance.pVM->m_Cpu.dt;
+	const bool isTimerWait = instance.loopInstructions != 0 && dt > 1;
+	if (frameEnd != VirtualMachine::FrameEnd::KeyWait && frameEnd != VirtualMachine::FrameEnd::Halted && !isTimerWait)
+	{
+		m_Runnable.push_back(vmIdx);
+		return;
+	}
+	instance.stalledFrame = m_Frame;
+	instance.isSleeping = true;
+	++m_SleepingCount;
+	if (!isTimerWait)
+		return;
+	instance.dueFrame = m_Frame + dt;
+	m_TimerWheel[instance.dueFrame % m_TimerWheelSize].push_back(vmIdx);
+}
+
+void VmScheduler::CatchUp(Instance& instance)
+{
+	//stalled in frame stalledFrame, everything up to the one that just ended would have stalled the same way
+	const uint64_t frameCount = m_Frame - 1 - instance.stalledFrame;
+	if (instance.loopInstructions == 0)
+	{
+		instance.pVM->SkipStalledFrames(frameCount);
+		return;
+	}
+	if (frameCount == 0)
+		return;
+	//the last missed pass is stepped, it leaves the timer value in the register the loop reads it into
+	instance.pVM->SkipIdleFrames(frameCount - 1, instance.loopInstructions);
+	instance.pVM->Step();
+}
+
+void VmScheduler::Wake(Instance& instance, const uint32_t vmIdx)
+{
+	instance.isSleeping = false;
+	--m_SleepingCount;
+	m_Runnable.push_back(vmIdx);
+}
+
+void VmScheduler::SetKey(const uint32_t vmIdx, const uint8_t key, const bool isPressed)
+{
+	Instance& instance = m_Instances[vmIdx];
+	//skipped frames saw the keys as they were, catch up before the key changes
+	const bool isChanged = instance.pVM->m_Cpu.input[key & 0xF] != isPressed;
+	if (instance.isSleeping && (isPressed || (instance.loopInstructions != 0 && isChanged)))
+	{
+		CatchUp(instance);
+		Wake(instance, vmIdx);
+	}
+	instance.pVM->m_Cpu.input[key & 0xF] = isPressed;
+}
+
+uint32_t VmScheduler::RunFrame()
+{
+	//idle loop sleepers whose timer runs out this frame. The skipped passes are not stepped, this frame's pass overwrites
+	//what they would have left
+	std::vector<uint32_t>& dueVms = m_TimerWheel[m_Frame % m_TimerWheelSize];
+	for (const uint32_t vmIdx : dueVms)
+	{
+		Instance& instance = m_Instances[vmIdx];
+		if (!instance.isSleeping || instance.loopInstructions == 0 || instance.dueFrame != m_Frame)
+			continue;
+		instance.pVM->SkipIdleFrames(m_Frame - 1 - instance.stalledFrame, instance.loopInstructions);
+		Wake(instance, vmIdx);
+	}
+	dueVms.clear();
+	//vms queue themselves for the next frame while they are resumed
+	m_Running.swap(m_Runnable);
+	m_Runnable.clear();
+	for (const uint32_t vmIdx : m_Running)
+		m_Instances[vmIdx].task.Resume();
+	++m_Frame;
+	return uint32_t(m_Running.size());
+}
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+//needs C++20, builds without coroutine support leave the scheduler out
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+class VirtualMachine;
+//Runs many vms cooperatively on one thread, one scheduler per core. Every vm's frame loop is a coroutine that
+//suspends after each frame: vms that ran a full frame or yielded are queued for the next frame, vms that wait on FX0A
+//or jumped to themselves are not queued at all, a key press wakes those. A vm that spent a whole frame going once
+//around its idle loop with the delay timer running sleeps until the frame the timer runs out in (or a key changes).
+//The frames they slept through are applied at once (VirtualMachine::SkipStalledFrames/SkipIdleFrames), so the result
+//is the same as having stepped them. This takes the database's idle loops to wait for the delay timer to reach 0.
+//Frame cost follows the number of vms that can make progress, not the number hosted.
+//Vms are not owned, keys go through SetKey (not the vm's input queue), nothing is presented.
+class VmScheduler final
+{
+public:
+	VmScheduler();
+	//sleeping vms are brought up to the current frame
+	~VmScheduler();
+	VmScheduler(const VmScheduler& old) = delete;
+	VmScheduler(VmScheduler&& old) = delete;
+	VmScheduler& operator=(const VmScheduler& other) = delete;
+	VmScheduler& operator=(const VmScheduler&& other) = delete;
+
+	//the vm runs from the next frame on, returns its index for SetKey
+	uint32_t Add(VirtualMachine& vm);
+	//between frames. A press wakes a vm sleeping on FX0A (or halted), releases are only stored. Any change wakes a vm
+	//sleeping on its idle loop
+	void SetKey(const uint32_t vmIdx, const uint8_t key, const bool isPressed);
+	//resumes every vm due this frame, returns how many ran
+	uint32_t RunFrame();
+
+	uint64_t GetFrame() const { return m_Frame; }
+	uint32_t GetCount() const { return uint32_t(m_Instances.size()); }
+	uint32_t GetSleepingCount() const { return m_SleepingCount; }
+private:
+	class Task
+	{
+	public:
+		struct promise_type
+		{
+			Task get_return_object() { return Task{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+			//Add only queues the vm, the first frame runs in RunFrame
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception();
+		};
+
+		explicit Task(const std::coroutine_handle<promise_type> handle) : m_Handle{ handle } {}
+		~Task();
+		Task(const Task& old) = delete;
+		Task(Task&& old) noexcept;
+		Task& operator=(const Task& other) = delete;
+		Task& operator=(Task&& other) = delete;
+
+		void Resume() const { m_Handle.resume(); }
+	private:
+		std::coroutine_handle<promise_type> m_Handle;
+	};
+
+	//co_await after a frame: queues the vm for the next frame or puts it to sleep
+	struct FrameAwaiter
+	{
+		VmScheduler& scheduler;
+		uint32_t vmIdx;
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<>) const { scheduler.Suspend(vmIdx); }
+		void await_resume() const noexcept {}
+	};
+
+	struct Instance
+	{
+		VirtualMachine* pVM;
+		Task task;
+		//frame the vm stalled in and the frame it has to run again in (idle loop sleep only), only meaningful while isSleeping
+		uint64_t stalledFrame;
+		uint64_t dueFrame;
+		//instructions of the last frame when it was exactly one pass of the idle loop with the timer running, 0 otherwise
+		uint32_t loopInstructions;
+		bool isSleeping;
+	};
+
+	Task RunVm(const uint32_t vmIdx);
+	void Suspend(const uint32_t vmIdx);
+	//applies the frames a sleeping vm missed up to the one that just ended
+	void CatchUp(Instance& instance);
+	//the vm is due next frame again
+	void Wake(Instance& instance, const uint32_t vmIdx);
+
+	uint64_t m_Frame;
+	std::vector<Instance> m_Instances;
+	//indices of the vms due next frame and of the ones being resumed, swapped every frame
+	std::vector<uint32_t> m_Runnable;
+	std::vector<uint32_t> m_Running;
+	uint32_t m_SleepingCount;
+	//vms sleeping on their idle loop by the frame they are due in. The delay timer is 8 bit, so a vm is never due more
+	//than 255 frames ahead and a slot holds one frame. Entries of vms a key woke early are dropped when their slot comes up
+	const static uint32_t m_TimerWheelSize{ 256 };
+	std::vector<uint32_t> m_TimerWheel[m_TimerWheelSize];
+};
+#endif